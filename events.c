@@ -0,0 +1,214 @@
+/******************************************************************************/
+/*!
+ * @file   events.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Lock-free single-producer/single-consumer stream of the gameplay events
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include "events.h"
+
+#ifdef EVENTS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Size of the ring, it must be a power of two. When the ring is full new events are dropped
+#define RING_SIZE (1 << 12)
+// Pause of the consumer when the ring is empty
+#define IDLE_NS   2000000
+
+static GameEvent         ring[RING_SIZE];
+static _Atomic uint64_t  head    = 0; /**<Written only by the producer (game thread) */
+static _Atomic uint64_t  tail    = 0; /**<Written only by the consumer thread */
+static _Atomic uint64_t  dropped = 0;
+static atomic_int        running = 0;
+static pthread_t         consumer;
+static EventSink         sink;
+
+/**
+ * Appends an event to the ring. It never blocks: if the consumer is late the event is dropped and counted
+ * @param  event The event to append
+ * @return       TRUE if the event has been queued, FALSE if it has been dropped
+ */
+int eventsEmit(const GameEvent* event)
+{
+    uint64_t h = atomic_load_explicit(&head, memory_order_relaxed);
+
+    if (h - atomic_load_explicit(&tail, memory_order_acquire) == RING_SIZE)
+    {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return 0;
+    }
+
+    ring[h % RING_SIZE] = *event;
+    atomic_store_explicit(&head, h + 1, memory_order_release);
+    return 1;
+}
+
+/**
+ * Passes to the sink every event published by the producer, in contiguous slices of the ring
+ * @return The number of events drained
+ */
+static size_t drain()
+{
+    uint64_t t     = atomic_load_explicit(&tail, memory_order_relaxed);
+    uint64_t h     = atomic_load_explicit(&head, memory_order_acquire);
+    size_t   total = h - t;
+
+    while (t < h)
+    {
+        size_t count = h - t;
+        if (count > RING_SIZE - t % RING_SIZE)
+            count = RING_SIZE - t % RING_SIZE;
+
+        sink.write(sink.ctx, &ring[t % RING_SIZE], count);
+        t += count;
+        atomic_store_explicit(&tail, t, memory_order_release);
+    }
+    return total;
+}
+
+static void* consumerLoop(void* arg)
+{
+    struct timespec idle = {0, IDLE_NS};
+    (void)arg;
+
+    while (atomic_load(&running))
+        if (drain() == 0)
+            nanosleep(&idle, NULL);
+
+    drain();
+    return NULL;
+}
+
+/**
+ * Starts the consumer thread which will pass the events to the given sink
+ * @param new_sink Where the events will be written
+ */
+void eventsStart(EventSink new_sink)
+{
+    sink = new_sink;
+    atomic_store(&running, 1);
+
+    if (pthread_create(&consumer, NULL, consumerLoop, NULL) != 0)
+    {
+        fprintf(stderr, "\nImpossibile avviare il thread degli eventi di gioco.\n");
+        exit(-1);
+    }
+}
+
+/**
+ * Stops the consumer thread after the last events have been drained, then closes the sink
+ */
+void eventsStop()
+{
+    if (!atomic_exchange(&running, 0))
+        return;
+
+    pthread_join(consumer, NULL);
+    if (sink.close != NULL)
+        sink.close(sink.ctx);
+}
+
+/**
+ * Generates the identifier of a new session
+ * @return A 32 bit identifier, different for each process and call
+ */
+uint32_t eventsNewGame()
+{
+    static uint32_t counter = 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    uint64_t x = (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec + ((uint64_t)getpid() << 32) + counter++;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9u;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebu;
+    return (uint32_t)(x ^ (x >> 31));
+}
+
+/**
+ * @return The number of events dropped because the ring was full
+ */
+uint64_t eventsDropped()
+{
+    return atomic_load(&dropped);
+}
+
+// ---------------------------------FILE SINK-----------------------------------
+typedef struct {
+    int           fd;
+    unsigned char block[sizeof(uint32_t) + RING_SIZE * sizeof(GameEvent)];
+} FileSink;
+
+/**
+ * Writes a batch as a single length-prefixed block. The file is opened in append mode,
+ * so blocks coming from different processes are never interleaved
+ */
+static void fileSinkWrite(void* ctx, const GameEvent* events, size_t count)
+{
+    FileSink* fs  = (FileSink*)ctx;
+    uint32_t  len = count;
+
+    memcpy(fs->block, &len, sizeof(len));
+    memcpy(fs->block + sizeof(len), events, count * sizeof(GameEvent));
+
+    if (write(fs->fd, fs->block, sizeof(len) + count * sizeof(GameEvent)) < 0)
+        fprintf(stderr, "Errore nella scrittura del file degli eventi.\n");
+}
+
+static void fileSinkClose(void* ctx)
+{
+    FileSink* fs = (FileSink*)ctx;
+
+    close(fs->fd);
+    free(fs);
+}
+
+/**
+ * Creates a sink which appends the events to a file, writing the header if the file is new
+ * @param  path The file where the events will be appended
+ * @return      The sink
+ */
+EventSink eventsFileSink(const char* path)
+{
+    FileSink* fs = (FileSink*)malloc(sizeof(FileSink));
+    if (fs == NULL)
+    {
+        fprintf(stderr, "\nImpossibile allocare la memoria per il file degli eventi.\n");
+        exit(-1);
+    }
+
+    fs->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fs->fd < 0)
+    {
+        fprintf(stderr, "Errore nell'apertura del file degli eventi.\n");
+        exit(-1);
+    }
+
+    struct stat st;
+    if (fstat(fs->fd, &st) == 0 && st.st_size == 0)
+    {
+        unsigned char header[8];
+        uint16_t      version = EVENTS_VERSION, size = sizeof(GameEvent);
+
+        memcpy(header,     EVENTS_MAGIC, 4);
+        memcpy(header + 4, &version,     2);
+        memcpy(header + 6, &size,        2);
+        if (write(fs->fd, header, sizeof(header)) < 0)
+            fprintf(stderr, "Errore nella scrittura del file degli eventi.\n");
+    }
+
+    EventSink new_sink = {fs, fileSinkWrite, fileSinkClose};
+    return new_sink;
+}
+
+#endif
@@ -0,0 +1,83 @@
+/******************************************************************************/
+/*!
+ * @file   events.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Header file of events.c
+ *
+ * Binary stream of the gameplay events, written by the game thread into a
+ * single-producer/single-consumer ring and drained by a consumer thread into a sink.
+ * The stream is compiled only when the EVENTS macro is defined (gcc -D EVENTS ... -pthread).
+ *
+ * Layout of the files written by the file sink:
+ *   header: "GEVT", uint16 version, uint16 size of a record
+ *   blocks: uint32 number of records, followed by the records (GameEvent)
+ */
+/******************************************************************************/
+
+#ifndef EVENTS_H_INCLUDED
+#define EVENTS_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EVENTS_FILE    "GameEvents.gevt"
+#define EVENTS_MAGIC   "GEVT"
+#define EVENTS_VERSION 1
+
+typedef enum {
+    EV_GAME_START,       /**<zone_id: number of zones of the map */
+    EV_ZONE_ADVANCED,    /**<zone: the zone reached */
+    EV_OBJECT_FOUND,     /**<object: what the rummage found, NOTHING included */
+    EV_OBJECT_TAKEN,
+    EV_BANDAGE_USED,
+    EV_ADRENALINE_USED,
+    EV_CRAFT,            /**<object: the crafted item, or JUNK if the craft failed */
+    EV_GIESON_APPEARED,
+    EV_GIESON_RESOLVED,  /**<object: item used against Gieson, NOTHING if none */
+    EV_VICTORY,
+    EV_GAME_OVER,
+    EV_TYPES
+} EventType;
+
+typedef enum {OUT_NONE, OUT_SUCCESS, OUT_FAILURE, OUT_DIED} EventOutcome;
+
+#define EV_NO_ZONE 0xFF
+
+// Fixed size record of 16 bytes. The enums of gamelib.h are stored as single bytes
+typedef struct {
+    uint32_t game;           /**<Identifier of the session */
+    uint16_t zone_id;        /**<ID of the zone where the event happened, 0 if none */
+    uint8_t  type;           /**<EventType */
+    uint8_t  player;         /**<1 for Giacomo, 2 for Marzia, 0 for the whole game */
+    uint8_t  zone_type;      /**<TypeZone, EV_NO_ZONE if none */
+    uint8_t  object;         /**<ObjType */
+    uint8_t  state;          /**<PlayerState after the event */
+    uint8_t  outcome;        /**<EventOutcome */
+    uint8_t  gasoline_turns; /**<Turns left under the protection of the gasoline */
+    uint8_t  reserved[3];
+} GameEvent;
+
+// A sink receives the events in batches from the consumer thread
+typedef struct {
+    void*  ctx;
+    void (*write)(void* ctx, const GameEvent* events, size_t count);
+    void (*close)(void* ctx);
+} EventSink;
+
+#ifdef EVENTS
+    void      eventsStart    (EventSink);
+    void      eventsStop     ();
+    int       eventsEmit     (const GameEvent*);
+    uint32_t  eventsNewGame  ();
+    uint64_t  eventsDropped  ();
+    EventSink eventsFileSink (const char*);
+
+    #define EVENTS_START() eventsStart(eventsFileSink(EVENTS_FILE))
+    #define EVENTS_STOP()  eventsStop()
+#else
+    #define EVENTS_START()
+    #define EVENTS_STOP()
+#endif
+
+#endif
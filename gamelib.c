@@ -6,29 +6,84 @@
    * @brief  Core of the project
    */
 /******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <poll.h>
+#include <unistd.h>
+
 #include "gamelib.h"
+#include "tables.h"
+#include "metrics.h"
+#include "trace.h"
+#include "events.h"
+#include "savestore.h"
+#include "saveparse.h"
+#include "history.h"
+#include "spectator.h"
+#include "harness.h"
+#include "preview.h"
+#include "stats.h"
+
+#ifdef HARNESS
+// Nothing is printed and the random numbers come from the harness, see harness.h
+static int harnessQuiet(const char* format, ...)
+{
+    (void)format;
+    return 0;
+}
+    #define printf(...) harnessQuiet(__VA_ARGS__)
+    #define rand()      harnessRand()
+#endif
 
 // ------------------------------SETTING VARIABLES------------------------------
 static Zone* first_zone = NULL;
 static Zone* last_zone  = NULL;
-
-#define MAX_LANDS 7
-
-static int const object_prop [6][6] = {
-    {30,20,40, 0, 0,10},
-    {20,10,10,30, 0,30},
-    {20,10,30, 0,30,10},
-    {80, 0,10, 0,10, 0},
-    {70, 0,10, 0,20, 0},
-    {90, 0,10, 0, 0, 0}
-};
+static Zone* map_block  = NULL; /**<All the zones of a loaded map, allocated together */
 
 static Player P1, P2;
 
-#define BACKPACK_SIZE 4
 static unsigned int gasoline_turns = 0;
 static unsigned int turn_check     = 0;
 
+static unsigned int turn_count     = 0; /**<Turns played since the start or the load of the game, for the history */
+static int          rewound_check  = -1; /**<turn_check after the turn a player went back to in doTurn, -1 if none */
+static unsigned int crafted        = 0; /**<Items crafted since the start or the load of the game, for the statistics */
+
+// The state of the game in the cells of the history: the objects of the zones come first, one for each ID
+enum {
+    H_STATE, H_POS, H_BACKPACK, H_OBJ_COUNT = H_BACKPACK + 6, H_SEARCHED, H_PLAYER_CELLS
+};
+#define H_ZONES          0
+#define H_PLAYER(p, f)   (hist_zones + (p) * H_PLAYER_CELLS + (f))
+#define H_GASOLINE       (hist_zones + 2 * H_PLAYER_CELLS)
+#define H_TURN_CHECK     (H_GASOLINE + 1)
+#define H_PLAYING        (H_GASOLINE + 2) /**<1 or 2, the player of the turn */
+#define H_MOVES          (H_GASOLINE + 3) /**<Moves left to the player of the turn */
+#define H_CELLS          (H_GASOLINE + 4)
+
+static Zone* zone_at[SAVE_MAX_ZONES + 1]; /**<The zones by ID, to give back the positions and the objects */
+static int   hist_zones = 0;
+
+static char   in_buf[1 << 16];         /**<Input read from stdin and not used yet, see getValue */
+static size_t in_pos      = 0;
+static size_t in_len      = 0;
+static int    script_mode = FALSE;   /**<TRUE when the input comes from a script, see setScriptMode */
+
+static int      hibernate_after = 0;     /**<Seconds of idle before hibernating the game, 0 to never, see setHibernation */
+static int      idle_point      = FALSE; /**<TRUE while doTurn waits for a choice: no Zone is referenced by the stack */
+static uint8_t* hibernated      = NULL;  /**<The game while it is hibernated, see hibernate */
+static uint8_t* hib_history     = NULL;  /**<The history while the game is hibernated, see packHistory */
+static size_t   hib_len = 0, hib_cap = 0;
+
+static char          session[SAVE_KEY_LEN] = "";    /**<ID of the player, it names the save of the game */
+static unsigned char legacy_save           = FALSE; /**<TRUE when the game has been loaded from SAVE_LEGACY */
+
+char  g_ans;
+int   g_menu;
+
 // TAGS USED FOR PRINTING ENUMS
 static const char* tags_state[3] = {
     "Morto",
@@ -53,6 +108,31 @@ static const char* tags_obj[7] = {
     "Nessuno"
 };
 
+// Narration of the encounters with Gieson, by EncounterText. The subtitles receive the turns of the gasoline
+static const struct {
+    const char* story;
+    const char* sub[2];
+} tags_encounter[5] = {
+    [ENC_TEXT_NO_ITEM]      = {"\nBen presto ti rendi conto che non hai modo di affrontarlo né di scappare. Per te è Game Over.\nPremi INVIO.", {NULL, NULL}},
+    [ENC_TEXT_KNIFE]        = {"\nTi aggredisce provocandoti un'importante ferita. Cominci a sanguinare, ma riesci a contrattaccare estraendo\n"
+                               "un coltello dallo zaino e piantandoglielo nel corpo. Riesci così a rallentarlo e ad allontanarti.\n", {"Coltello -1", "Sei ferito!"}},
+    [ENC_TEXT_KNIFE_FATAL]  = {"\nLe tue ferite purtroppo sono molto gravi e non riesci a trovare le forze neppure per tentare\n"
+                               "di difenderti con quel coltello rimasto nel tuo zaino. Per te è Game Over.\nPremi INVIO.", {NULL, NULL}},
+    [ENC_TEXT_GUN]          = {"\nImpugni la tua pistola e spari un colpo contro di lui. Sai che non basterà a fermarlo, ma riesci a scappare via completamente illeso.\n", {"Pistola -1", NULL}},
+    [ENC_TEXT_GASOLINE]     = {"\nAfferri con rapidità la tua tanica di benzina e la svuoti su Gieson, per poi dargli fuoco.\nHai come l'impressione che per un po' non si farà vivo.\n",
+                               {"%d Turni al sicuro da Gieson", "Benzina -1"}}
+};
+#ifdef TRACE
+static const char* tags_action[6] = {
+    "progressZone",
+    "rummage",
+    "takeItem",
+    "heal",
+    "useAdrenaline",
+    "craft"
+};
+#endif
+
 // PROTOTYPES OF FUNCTIONS
 static void    createMap     ();
 static ObjType randomObject  (TypeZone);
@@ -64,7 +144,7 @@ static void    closeMap      ();
 static void    deleteMap     ();
 
 static void    shiftManager  ();
-static void    doTurn        (Player*);
+static int     doTurn        (Player*, int);
 static void    progressZone  (Player*);
 static void    rummage       (Player*, int*);
 static void    takeItem      (Player*, int*);
@@ -77,8 +157,180 @@ static void    victory       (Player*, int*);
 static void    gameOver      (Player*, int*);
 
 static void    setValues     (Player*, Player*, unsigned int, unsigned int);
+static void    startHistory  ();
+static void    recordHistory (Player*, int);
+static int     rewindHistory (int);
+static int     askSession    ();
 static void    saveGame      ();
+static int     chooseSave    (char*, size_t);
+static int     loadPrevious  (const char*, SaveData*, SaveError*);
 static void    deleteSave    ();
+static void    recordStats   ();
+static void    hibernate     ();
+static void    wake          ();
+
+// ---------------------------------GAME EVENTS---------------------------------
+#ifdef EVENTS
+static uint32_t game_id = 0;
+
+/**
+ * Publishes a gameplay event on the events stream
+ * @param type    The type of the event
+ * @param myP     The player involved, NULL if the event concerns the whole game
+ * @param zone    The zone where the event happened, NULL if none
+ * @param object  The object involved in the event
+ * @param outcome The outcome of the event
+ */
+static void emitEvent(EventType type, Player* myP, Zone* zone, ObjType object, EventOutcome outcome)
+{
+    GameEvent event = {0};
+
+    event.game           = game_id;
+    event.type           = type;
+    event.player         = myP == &P1 ? 1 : (myP == &P2 ? 2 : 0);
+    event.zone_id        = zone == NULL ? 0 : zone->ID;
+    event.zone_type      = zone == NULL ? EV_NO_ZONE : zone->type;
+    event.object         = object;
+    event.state          = myP == NULL ? ALIVE : myP->state;
+    event.outcome        = outcome;
+    event.gasoline_turns = gasoline_turns;
+
+    eventsEmit(&event);
+}
+    #define EMIT_EVENT(...) emitEvent(__VA_ARGS__)
+#else
+    #define EMIT_EVENT(...)
+#endif
+
+// --------------------------------SPECTATOR FEED-------------------------------
+#ifdef SPECTATOR
+/**
+ * Publishes the state of the game to the spectators, see spectator.h
+ * @param myP   The player of the turn
+ * @param moves The moves left to him
+ * @param ended TRUE for the last state of the game
+ */
+static void publishState(Player* myP, int moves, int ended)
+{
+    SpectatorState* s = spectatorBegin();
+    Player*         players[2] = {&P1, &P2};
+
+    if (s == NULL)
+        return;
+
+    s->turn           = turn_count;
+    s->playing        = myP == &P1 ? 1 : 2;
+    s->moves          = moves;
+    s->gasoline_turns = gasoline_turns;
+    s->ended          = ended;
+    s->zones          = 0;
+    for (Zone* current = first_zone; current != NULL && s->zones < SPECTATOR_MAX_ZONES; current = current->next_zone)
+    {
+        s->type  [s->zones] = current->type;
+        s->object[s->zones] = current->object;
+        s->zones++;
+    }
+    for (int p = 0; p < 2; p++)
+    {
+        s->player[p].state     = players[p]->state;
+        s->player[p].pos       = players[p]->pos == NULL ? 0 : players[p]->pos->ID;
+        s->player[p].searched  = players[p]->searched;
+        s->player[p].obj_count = players[p]->obj_count;
+        memcpy(s->player[p].backpack, players[p]->backpack, sizeof(s->player[p].backpack));
+    }
+    spectatorEnd();
+}
+    #define PUBLISH_STATE(...)  publishState(__VA_ARGS__)
+    #define SPECTATOR_OPEN()    spectatorOpen(legacy_save ? "legacy" : session)
+    #define SPECTATOR_CLOSE()   spectatorClose()
+#else
+    #define PUBLISH_STATE(...)
+    #define SPECTATOR_OPEN()
+    #define SPECTATOR_CLOSE()
+#endif
+
+// -----------------------------------HARNESS-----------------------------------
+#ifdef HARNESS
+static int harness_choice = 0; /**<Answer of the next getValue, given by the harness */
+
+/**
+ * Copies the state of the game for the harness
+ * @param myP   The player of the turn
+ * @param moves The moves left to him
+ * @param s     Where the state will be copied
+ */
+static void harnessSnapshot(Player* myP, int moves, HarnessState* s)
+{
+    Player* players[2] = {&P1, &P2};
+
+    memset(s, 0, sizeof(*s));
+    for (int p = 0; p < 2; p++)
+    {
+        s->player[p].state     = players[p]->state;
+        s->player[p].pos       = players[p]->pos == NULL ? HARNESS_OUT : players[p]->pos->ID - 1;
+        s->player[p].obj_count = players[p]->obj_count;
+        s->player[p].searched  = players[p]->searched;
+        memcpy(s->player[p].backpack, players[p]->backpack, sizeof(s->player[p].backpack));
+    }
+    s->gasoline_turns = gasoline_turns;
+    s->turn_check     = turn_check;
+    s->turns          = turn_count - 1; // shiftManager counts the turn before playing it
+    s->playing        = myP == &P1 ? 0 : 1;
+    s->moves          = moves;
+    for (Zone* current = first_zone; current != NULL && s->zones < HARNESS_MAX_ZONES; current = current->next_zone)
+        s->object[s->zones++] = current->object;
+}
+
+static void harnessAction(Player* myP, int moves)
+{
+    HarnessState s;
+
+    harnessSnapshot(myP, moves, &s);
+    harness_choice = harnessOnAction(&s);
+}
+
+/**
+ * Turns the item chosen by the harness into the answer to the menu of chooseItem.
+ * An item which is not in the menu is replaced by the one chooseItem would give without a choice, like sim.c does
+ */
+static void harnessItem(unsigned short* backpack, const ObjType* item_choice, int count)
+{
+    HarnessState s;
+    ObjType      fallback = backpack[GASOLINE] > 0 ? GASOLINE : (backpack[GUN] > 0 ? GUN : KNIFE);
+
+    harnessSnapshot(backpack == P1.backpack ? &P1 : &P2, 0, &s);
+    ObjType choice = harnessOnItem(&s);
+
+    harness_choice = 0;
+    for (int i = 1; i < count; i++)
+        if (item_choice[i] == choice || (harness_choice == 0 && item_choice[i] == fallback))
+            harness_choice = i;
+}
+
+/**
+ * Plays a whole game on a map, with the choices of the harness
+ * @param type   Type of each zone, the last one has to be EXIT_CAMPING
+ * @param object Object of each zone, HARNESS_RANDOM to draw it with randomObject
+ * @param zones  Number of zones, at most HARNESS_MAX_ZONES
+ * @param end    Where the state at the end of the game will be copied
+ */
+void harnessPlay(const uint8_t* type, const uint8_t* object, int zones, HarnessState* end)
+{
+    for (int i = 0; i < zones && i < HARNESS_MAX_ZONES; i++)
+        addZone(type[i], object[i] == HARNESS_RANDOM ? (ObjType)-1 : object[i]);
+    setValues(NULL, NULL, 0, 0);
+    shiftManager();
+
+    harnessSnapshot(&P1, 0, end);
+    end->turns = turn_count;
+    deleteMap();
+}
+    #define HARNESS_ACTION(myP, moves)           harnessAction(myP, moves)
+    #define HARNESS_ITEM(backpack, items, count) harnessItem(backpack, items, count)
+#else
+    #define HARNESS_ACTION(myP, moves)
+    #define HARNESS_ITEM(backpack, items, count)
+#endif
 
 // ---------------------------MAP BUILDING FUNCTIONS----------------------------
 /**
@@ -91,9 +343,10 @@ static void    deleteSave    ();
  */
 void createMap()
 {
+    previewReset();
     do
     {
-        system("clear");
+        clearScreen();
 
         textFramed("Menù Creazione Mappa");
 
@@ -112,11 +365,19 @@ void createMap()
         g_menu = getValue(0,3);
         switch(g_menu)
         {
-            case 1: // New zone
+            case 1: // New zone, leaving room for the exit
+                if (last_zone != NULL && last_zone->ID >= SAVE_MAX_ZONES - 1)
+                {
+                    printf("\nLa mappa può contenere al massimo %d zone, compresa l'uscita del campeggio.\nPremi INVIO.", SAVE_MAX_ZONES);
+                    waitEnter();
+                    break;
+                }
                 addZone(-1,-1);
+                previewPush(last_zone->type, last_zone->object);
                 break;
             case 2: // Deletes zone
                 deleteLastZone();
+                previewTruncate(last_zone == NULL ? 0 : last_zone->ID);
                 break;
             case 3: // Closes the route and start the game
                 closeMap();
@@ -126,11 +387,13 @@ void createMap()
         }
 
     } while(g_menu != -1);
+    previewFree();
     deleteMap();
 }
 
 /**
- * Generates a random object for the zone
+ * Generates a random object for the zone, following the probabilities of the OBJECT_PROP table.
+ * The rows of the table are validated to sum to 100 when loaded, so a single lookup is enough
  * @param  i Type of the zone for which we have to generate a random object
  * @return   An int value indicating the object choosen
  *
@@ -141,20 +404,7 @@ void createMap()
  */
 ObjType randomObject(TypeZone i)
 {
-    int row       = (sizeof(object_prop)/sizeof(object_prop[0][0])) / (sizeof(object_prop)/sizeof(object_prop[0]));
-    int rand_prop = rand()%100 + 1;
-    int sum       = 0;
-
-    for(int j = 0; j < row; j++)
-    {
-        sum += object_prop[i][j];
-        if (rand_prop > sum-object_prop[i][j] && rand_prop <= sum && object_prop[i][j] != 0)
-            return j;
-    }
-    // If the function ever reaches this point, there is an error
-    fprintf(stderr, "\nSi è verificato un errore imprevisto all'interno della funzione randomObject().\n");
-    waitEnter();
-    return NOTHING;
+    return tablesCurrent()->spawn[i][rand()%100];
 }
 
 /**
@@ -171,6 +421,13 @@ ObjType randomObject(TypeZone i)
  */
 void addZone(TypeZone type_zone, ObjType object_type)
 {
+    // The ID of a zone is an unsigned char, and the saves hold at most SAVE_MAX_ZONES zones
+    if(last_zone != NULL && last_zone->ID >= SAVE_MAX_ZONES)
+    {
+        fprintf(stderr, "\nLa mappa non può contenere più di %d zone.\n", SAVE_MAX_ZONES);
+        exit(-1);
+    }
+
     Zone* new_zone = (Zone*)malloc(sizeof(Zone));
 
     if(new_zone == NULL)
@@ -180,7 +437,7 @@ void addZone(TypeZone type_zone, ObjType object_type)
     }
 
     // Filling new_zone->type
-    if(type_zone == -1) // If we want to take the type of the zone from the user
+    if(type_zone == (TypeZone)-1) // If we want to take the type of the zone from the user
     {
         printf("\n");
         textFramedSub("Creazione Nuova Zona");
@@ -198,7 +455,7 @@ void addZone(TypeZone type_zone, ObjType object_type)
         new_zone->type = type_zone;
 
     // Filling new_zone->object
-    if(object_type == -1) // If we want to generate the object randomly
+    if(object_type == (ObjType)-1) // If we want to generate the object randomly
         new_zone->object = randomObject(new_zone->type);
     else
         new_zone->object = object_type;
@@ -276,8 +533,14 @@ void closeMap()
             addZone(EXIT_CAMPING,-1);
             // Setting the players initial pos and the global variables for the game
             setValues(NULL, NULL, 0, 0);
+            #ifdef EVENTS
+                game_id = eventsNewGame();
+            #endif
+            EMIT_EVENT(EV_GAME_START, NULL, last_zone, NOTHING, OUT_NONE);
             // First save of the game
             saveGame();
+            // The estimate of the map is not needed while playing
+            previewFree();
             // Starting the shift manager
             shiftManager(P1, P2);
         }
@@ -301,36 +564,57 @@ void printZone(Zone* zone, unsigned char obj_vis)
     printf("-> TIPO: %-16s ", tags_zone[zone->type]);
 
     if(obj_vis)
-        printf("| OGGETTO: %s\n", tags_obj[zone->object]);
+        printf("| OGGETTO: %-13s ", tags_obj[zone->object]);
     else
-        printf("| OGGETTO: ???\n");
+        printf("| OGGETTO: %-13s ", "???");
 }
 
 /**
- * Prints a graphical visualization of the linked list, starting from first_zone and calling printZone to print each zone
+ * Prints a graphical visualization of the linked list, starting from first_zone and calling printZone to print each zone.
+ * Next to each zone is printed the estimated probability of dying in it, and at the end the
+ * estimated probability of escape of the two players once the exit is added
  * @see printZone
+ * @see previewDanger
+ * @see previewEscape
  */
 void printMap()
 {
-    Zone* current = first_zone;
+    Zone*  current = first_zone;
+    double escape[2];
 
     printf("\nINIZIO-----------------------------------------------\n");
     while(current != NULL)
     {
         printf("%-2d", current->ID);
         printZone(current, TRUE);
+        printf("| PERICOLO: %5.1f%%\n", 100 * previewDanger(current->ID - 1));
         current = current->next_zone;
     }
-    printf("FINE-------------------------------------------------\n\n");
+    printf("FINE-------------------------------------------------\n");
+
+    if (first_zone != NULL)
+    {
+        previewEscape(escape);
+        printf("Stima della fuga (esplorando ogni zona): Giacomo %.1f%%, Marzia %.1f%%\n",
+               100 * escape[0], 100 * escape[1]);
+    }
+    printf("\n");
 }
 
 /**
- * Does the free() for each zone of the map which was previously allocated with malloc()
+ * Does the free() for each zone of the map which was previously allocated with malloc(),
+ * or frees the block of the zones of a loaded map
  */
 void deleteMap()
 {
     Zone* temp = first_zone;
 
+    if (map_block != NULL)
+    {
+        free(map_block);
+        map_block  = NULL;
+        first_zone = NULL;
+    }
     while (first_zone != NULL)
     {
         temp       = first_zone;
@@ -341,51 +625,97 @@ void deleteMap()
 }
 
 // --------------------------------GAME FUNCTIONS-------------------------------
+/**
+ * The value of turn_check after a turn of myP starting from the current state: the first turn of a pair
+ * drawn at random tells which player plays the second one, see shiftManager
+ */
+static unsigned int nextCheck(Player* myP)
+{
+    return (turn_check == 0 && P1.pos != NULL && P2.pos != NULL) ? (myP == &P1 ? 1 : 2) : 0;
+}
+
 /**
  * Manages the turns of the two players, calling myTurn() when a player has to make some choices
  * @see doTurn
  * @see saveGame
+ * @see recordStats
  * @see deleteSave
  */
 static void shiftManager()
 {
+    int resumed = FALSE; // TRUE when the history has gone back to a turn of the other player
+    Player* myP = &P1;
+
+    SPECTATOR_OPEN();
     do
     {
-        if(turn_check == 0 && P1.pos != NULL && P2.pos != NULL)
+        TRACE_BEGIN(t_turn);
+        int          moves = 1;
+        unsigned int next_check;
+
+        if(resumed)
+        {
+            myP        = historyGet(H_PLAYING) == 1 ? &P1 : &P2;
+            moves      = historyGet(H_MOVES);
+            next_check = nextCheck(myP);
+        }
+        else if(turn_check == 0 && P1.pos != NULL && P2.pos != NULL)
         {
             int rand_turn = rand()%100 + 1;
 
             if (rand_turn > 50)
             {
-                doTurn(&P1);
-                turn_check = 1;
+                myP        = &P1;
+                next_check = 1;
             }
             else
             {
-                doTurn(&P2);
-                turn_check = 2;
+                myP        = &P2;
+                next_check = 2;
             }
         }
         else if (turn_check == 2 || P2.pos == NULL)
         {
-            doTurn(&P1);
-            turn_check = 0;
+            myP        = &P1;
+            next_check = 0;
         }
-        else if (turn_check == 1 || P1.pos == NULL)
+        else
+        {
+            myP        = &P2;
+            next_check = 0;
+        }
+
+        if(!resumed)
         {
-            doTurn(&P2);
-            turn_check = 0;
+            turn_count++;
+            recordHistory(myP, moves);
         }
+        PUBLISH_STATE(myP, moves, FALSE);
+        rewound_check = -1;
+        resumed       = doTurn(myP, moves);
+        if(!resumed)
+            turn_check = rewound_check >= 0 ? (unsigned int)rewound_check : next_check;
+
         saveGame();
+        tablesPoll(TABLES_FILE); // Picking up the new tables if a reload has been requested
+        TRACE_END(t_turn, "shiftManager turn");
     } while(P1.pos != NULL || P2.pos != NULL);
 
+    PUBLISH_STATE(myP, 0, TRUE);
+    SPECTATOR_CLOSE();
     g_menu = -1;
+    recordStats();
     deleteSave();
+    METRICS_EXPORT();
+    TRACE_DUMP();
 }
 
 /**
- * Prints some useful info for the game and manages the actions that the players can do, calling the respective functions
- * @param myP The player who is currently playing
+ * Prints some useful info for the game and manages the actions that the players can do, calling the respective functions.
+ * After every action the state of the game is recorded in the history, so that it can be undone
+ * @param  myP   The player who is currently playing
+ * @param  moves The moves of the player, less than 1 when resuming a turn from the history
+ * @return       TRUE if the player went back to a turn of the other player, which shiftManager has to resume
  *
  * @see progressZone
  * @see rummage
@@ -397,14 +727,15 @@ static void shiftManager()
  * @see victory
  * @see gameOver
  */
-void doTurn(Player* myP)
+int doTurn(Player* myP, int moves)
 {
-    int moves   = 1;
-    int p_moves = 1;
+    int p_moves = moves;
     while (moves > 0)
     {
+        TRACE_BEGIN(t_iteration);
         p_moves = moves;
-        system("clear");
+        METRICS_START(t_render);
+        clearScreen();
 
         // Printing stats and inventory
         char gas_info [50], player_name[10];
@@ -432,6 +763,7 @@ void doTurn(Player* myP)
         // Printing zone
         printf("ZONA CORRENTE--------------------------------------\n");
         printZone(myP->pos, myP->searched);
+        printf("\n");
         printf("---------------------------------------------------\n\n");
 
         printf("1) Avanza alla prossima zona           \n"
@@ -439,44 +771,81 @@ void doTurn(Player* myP)
                "3) Raccogli l'oggetto                  \n"
                "4) Curati con le bende                 \n"
                "5) Usa una scarica di adrenalina       \n"
-               "6) Tenta di utilizzare le cianfrusaglie\n\n");
+               "6) Tenta di utilizzare le cianfrusaglie\n"
+               "7) Annulla l'ultima azione             \n"
+               "8) Torna a un turno precedente         \n\n");
 
         printf("La tua scelta: ");
+        METRICS_RECORD(M_RENDER, t_render);
 
-        g_menu = getValue(1,6);
+        HARNESS_ACTION(myP, moves);
+        idle_point = TRUE;
+        g_menu     = getValue(1,8);
+        idle_point = FALSE;
         printf("__________________________________________________________________________________________________\n\n");
-        switch(g_menu)
+
+        if(g_menu >= 7)
         {
-            case 1:
-                progressZone(myP);
-                break;
-            case 2:
-                rummage(myP, &moves);
-                break;
-            case 3:
-                takeItem(myP, &moves);
-                break;
-            case 4:
-                heal(myP, &moves);
-                break;
-            case 5:
-                useAdrenaline(myP, &moves);
-                break;
-            case 6:
-                craft(myP, &moves);
-                break;
+            if(rewindHistory(g_menu == 7))
+            {
+                if((historyGet(H_PLAYING) == 1 ? &P1 : &P2) != myP)
+                {
+                    TRACE_END(t_iteration, "doTurn");
+                    return TRUE;
+                }
+                // The turn gone back to may not be the one shiftManager started, nor follow the same order
+                moves         = historyGet(H_MOVES);
+                rewound_check = nextCheck(myP);
+                PUBLISH_STATE(myP, moves, FALSE);
+            }
         }
-        moves--;
+        else
+        {
+            METRICS_START(t_action);
+            TRACE_BEGIN(t_action_span);
+            switch(g_menu)
+            {
+                case 1:
+                    progressZone(myP);
+                    break;
+                case 2:
+                    rummage(myP, &moves);
+                    break;
+                case 3:
+                    takeItem(myP, &moves);
+                    break;
+                case 4:
+                    heal(myP, &moves);
+                    break;
+                case 5:
+                    useAdrenaline(myP, &moves);
+                    break;
+                case 6:
+                    craft(myP, &moves);
+                    break;
+            }
+            METRICS_RECORD(M_PROGRESS_ZONE + g_menu - 1, t_action);
+            TRACE_END(t_action_span, tags_action[g_menu - 1]);
+            moves--;
+
+            // If the player selects an action that he can't do, Gieson will not appear
+            if(p_moves != moves)
+                callGieson(myP, &moves);
 
-        // If the player selects an action that he can't do, Gieson will not appear
-        if(p_moves != moves)
-            callGieson(myP, &moves);
+            if (myP->pos == NULL && myP->state != DEAD)
+                victory(myP, &moves);
+            else if (myP->state == DEAD)
+                gameOver(myP, &moves);
 
-        if (myP->pos == NULL && myP->state != DEAD)
-            victory(myP, &moves);
-        else if (myP->state == DEAD)
-            gameOver(myP, &moves);
+            if(moves > 0)
+            {
+                recordHistory(myP, moves);
+                PUBLISH_STATE(myP, moves, FALSE);
+            }
+        }
+        TRACE_END(t_iteration, "doTurn");
     }
+    return FALSE;
 }
 
 /**
@@ -489,6 +858,7 @@ void progressZone(Player* myP)
     {
         myP->pos = myP->pos->next_zone;
         myP->searched = FALSE;
+        EMIT_EVENT(EV_ZONE_ADVANCED, myP, myP->pos, myP->pos->object, OUT_SUCCESS);
         printf("Avanzi di una zona, recandoti in %s.\nPremi INVIO.", tags_zone[myP->pos->type]);
         waitEnter();
     }
@@ -526,6 +896,7 @@ void rummage(Player* myP, int* moves)
         waitEnter();
 
         myP->searched = TRUE;
+        EMIT_EVENT(EV_OBJECT_FOUND, myP, myP->pos, myP->pos->object, OUT_SUCCESS);
     }
     else if(myP->searched == FALSE)
     {
@@ -533,6 +904,7 @@ void rummage(Player* myP, int* moves)
         waitEnter();
 
         myP->searched = TRUE;
+        EMIT_EVENT(EV_OBJECT_FOUND, myP, myP->pos, NOTHING, OUT_FAILURE);
     }
     else
     {
@@ -554,7 +926,7 @@ void takeItem(Player* myP, int* moves)
 {
     if(myP->pos->object != NOTHING && myP->searched == TRUE)
     {
-        if (myP->obj_count > BACKPACK_SIZE)
+        if (myP->obj_count > tablesCurrent()->backpack_size)
         {
             printf("Il tuo zaino è pieno. Devi consumare qualche oggetto prima di raccoglierne un altro.\n");
             (*moves)++;
@@ -570,6 +942,7 @@ void takeItem(Player* myP, int* moves)
 
             myP->backpack[myP->pos->object]++;
             myP->obj_count++;
+            EMIT_EVENT(EV_OBJECT_TAKEN, myP, myP->pos, myP->pos->object, OUT_SUCCESS);
             myP->pos->object = NOTHING;
         }
     }
@@ -613,6 +986,7 @@ void heal(Player* myP, int* moves)
             myP->state = ALIVE;
             myP->backpack[BANDAGE]--;
             myP->obj_count--;
+            EMIT_EVENT(EV_BANDAGE_USED, myP, myP->pos, BANDAGE, OUT_SUCCESS);
         }
         printf("Premi INVIO.");
         waitEnter();
@@ -644,6 +1018,7 @@ void useAdrenaline(Player* myP, int* moves)
 
         myP->backpack[ADRENALINE]--;
         myP->obj_count--;
+        EMIT_EVENT(EV_ADRENALINE_USED, myP, myP->pos, ADRENALINE, OUT_SUCCESS);
         if (*moves == 1)
             *moves+=2;
         else
@@ -669,35 +1044,36 @@ void craft(Player* myP, int* moves)
 {
     if (myP->backpack[JUNK] > 0)
     {
-        if(rand()%100 + 1 >= 30)
+        const GameTables* t = tablesCurrent();
+
+        if(rand()%100 + 1 >= t->craft_fail)
         {
-            int random_craft;
-            switch(myP->backpack[JUNK])
-            {
-                case 1:
-                    random_craft = rand()%3 + 1;
-                    break;
-                case 2:
-                    random_craft = rand()%2 + 2;
-                    break;
-                default: // If we have more than 3 junks
-                    random_craft = 3;
-                    break;
-            }
+            // The odds depend on the number of junks: 1, 2, 3 or more
+            int     spread       = myP->backpack[JUNK] < 3 ? myP->backpack[JUNK] - 1 : 2;
+            ObjType random_craft = t->craft_item[spread][t->craft_total[spread] > 1 ? rand()%t->craft_total[spread] : 0];
 
             switch(random_craft)
             {
-                case 1:
+                case KNIFE:
                     printf("Riesci a trovare parte di una lama ormai poco affilata ed un legnetto, creandoti un coltello.\n");
                     myP->backpack[KNIFE]++;
+                    crafted++;
+                    METRICS_COUNT(C_CRAFT_KNIFE);
+                    EMIT_EVENT(EV_CRAFT, myP, myP->pos, KNIFE, OUT_SUCCESS);
                     break;
-                case 2:
+                case GUN:
                     printf("Riassembli una pistola caricandoci l'unico proiettile che hai trovato.\n");
                     myP->backpack[GUN]++;
+                    crafted++;
+                    METRICS_COUNT(C_CRAFT_GUN);
+                    EMIT_EVENT(EV_CRAFT, myP, myP->pos, GUN, OUT_SUCCESS);
                     break;
-                case 3:
+                case GASOLINE:
                     printf("Noti che tra le numerose cianfrusaglie in tuo possesso non avevi notato prima una tanica di benzina, seppur non proprio piena.\n");
                     myP->backpack[GASOLINE]++;
+                    crafted++;
+                    METRICS_COUNT(C_CRAFT_GASOLINE);
+                    EMIT_EVENT(EV_CRAFT, myP, myP->pos, GASOLINE, OUT_SUCCESS);
                     break;
                 default:
                     printf("An error has occurred. Please check the craft() function in gamelib.c\n");
@@ -712,6 +1088,8 @@ void craft(Player* myP, int* moves)
             textFramedSub("Cianfrusaglia -1");
             myP->backpack[JUNK]--;
             myP->obj_count--;
+            METRICS_COUNT(C_CRAFT_FAILED);
+            EMIT_EVENT(EV_CRAFT, myP, myP->pos, JUNK, OUT_FAILURE);
         }
     }
     else
@@ -729,7 +1107,7 @@ void craft(Player* myP, int* moves)
  * @param  backpack The backpack of the current player
  * @return          The object that the can player can use (returns nothing, an enum, in case of no useful object detected)
  */
-ObjType chooseItem(unsigned short backpack[6])
+ObjType chooseItem(unsigned short* backpack)
 {
     if((backpack[GASOLINE]>0 && backpack[GUN]>0) || (backpack[GASOLINE]>0 && backpack[KNIFE]>0) || (backpack[KNIFE]>0 && backpack[GUN]>0))
     {
@@ -747,6 +1125,7 @@ ObjType chooseItem(unsigned short backpack[6])
             }
         }
         printf("\nLa tua scelta: ");
+        HARNESS_ITEM(backpack, item_choice, count);
         return item_choice[getValue(1,count-1)];
     }
     else if(backpack[GASOLINE] > 0)
@@ -767,82 +1146,66 @@ ObjType chooseItem(unsigned short backpack[6])
  */
 void callGieson(Player* myP, int* moves)
 {
-    unsigned int        rand_arrival   = rand()%100 + 1;
-    unsigned char       gieson_has_to_appear;
+    METRICS_START(t_gieson);
+    TRACE_BEGIN(t_gieson_span);
+    const EncounterTable* enc            = &tablesCurrent()->encounter;
+    unsigned int          rand_arrival   = rand()%100 + 1;
+    unsigned int          key            = ENC_KEY(gasoline_turns, P1.state == DEAD || P2.state == DEAD, myP->pos == NULL);
 
     // Checking if Gieson has to appear
     if(gasoline_turns > 0)
-    {
         gasoline_turns--;
-        gieson_has_to_appear = FALSE;
-    }
-    else if ( (P1.state != DEAD && P2.state != DEAD && myP->pos == NULL && rand_arrival <= 75) ||
-            ( (P1.state == DEAD || P2.state == DEAD) && rand_arrival <= 50) ||
-              (rand_arrival <= 30) )
-        gieson_has_to_appear = TRUE;
-    else
-        gieson_has_to_appear = FALSE;
 
-    if(gieson_has_to_appear)
+    if(rand_arrival <= enc->appear[key])
     {
+        METRICS_COUNT(C_GIESON_APPEARANCES);
+        EMIT_EVENT(EV_GIESON_APPEARED, myP, myP->pos, NOTHING, OUT_NONE);
         printf("\nSenti i pesanti passi di Gieson farsi sempre più vicini finché non lo vedi. Lui è qui.");
-        ObjType choice = chooseItem(myP->backpack);
+        ObjType                 choice = chooseItem(myP->backpack);
+        const EncounterOutcome* o      = &encounter_outcome[choice][myP->state];
+        #ifdef EVENTS
+            Zone* encounter_zone = myP->pos; // The zone is lost if the player dies
+        #endif
 
-        switch(choice)
+        printf("%s", tags_encounter[o->text].story);
+        if(!o->died)
         {
-            case GASOLINE:
-                printf("\nAfferri con rapidità la tua tanica di benzina e la svuoti su Gieson, per poi dargli fuoco.\nHai come l'impressione che per un po' non si farà vivo.\n");
-                textFramedSub("4 Turni al sicuro da Gieson");
-                textFramedSub("Benzina -1");
-                printf("Premi INVIO.");
-                myP->backpack[GASOLINE]--;
-                myP->obj_count--;
-                gasoline_turns = 4;
-                break;
-
-            case GUN:
-                printf("\nImpugni la tua pistola e spari un colpo contro di lui. Sai che non basterà a fermarlo, ma riesci a scappare via completamente illeso.\n");
-                textFramedSub("Pistola -1");
-                printf("Premi INVIO.");
-                myP->backpack[GUN]--;
-                myP->obj_count--;
-                break;
-
-            case KNIFE:
-                if(myP->state > INJURED)
-                {
-                    printf("\nTi aggredisce provocandoti un'importante ferita. Cominci a sanguinare, ma riesci a contrattaccare estraendo\n"
-                           "un coltello dallo zaino e piantandoglielo nel corpo. Riesci così a rallentarlo e ad allontanarti.\n");
-                    textFramedSub("Coltello -1");
-                    textFramedSub("Sei ferito!");
-                    printf("Premi INVIO.");
-                    myP->state = INJURED;
-                    myP->backpack[KNIFE]--;
-                    myP->obj_count--;
-                }
-                else
-                {
-                    printf("\nLe tue ferite purtroppo sono molto gravi e non riesci a trovare le forze neppure per tentare\n"
-                           "di difenderti con quel coltello rimasto nel tuo zaino. Per te è Game Over.\nPremi INVIO.");
-                    myP->state = DEAD;
-                    myP->pos   = NULL;
-                    *moves     = 0;
-                }
-                break;
+            char line[64];
+            for (int i = 0; i < 2 && tags_encounter[o->text].sub[i] != NULL; i++)
+            {
+                snprintf(line, sizeof(line), tags_encounter[o->text].sub[i], enc->gasoline_turns);
+                textFramedSub(line);
+            }
+            printf("Premi INVIO.");
+        }
 
-            default:
-                printf("\nBen presto ti rendi conto che non hai modo di affrontarlo né di scappare. Per te è Game Over.\nPremi INVIO.");
-                myP->state = DEAD;
-                myP->pos   = NULL;
-                *moves     = 0;
+        myP->backpack[o->slot] -= o->consume;
+        myP->obj_count         -= o->consume;
+        myP->state              = o->state;
+        gasoline_turns          = o->gasoline * enc->gasoline_turns;
+        if(o->died)
+        {
+            myP->pos = NULL;
+            *moves   = 0;
+            if(o->text == ENC_TEXT_KNIFE_FATAL)
+            {
+                METRICS_COUNT(C_DEATH_KNIFE_INJURED);
+            }
+            else
+            {
+                METRICS_COUNT(C_DEATH_NO_ITEM);
+            }
         }
+        EMIT_EVENT(EV_GIESON_RESOLVED, myP, encounter_zone, choice, o->died ? OUT_DIED : OUT_SUCCESS);
         waitEnter();
     }
-    else if (rand_arrival <= 40 && gasoline_turns == 0) // Small percentage to get a little surprise from Gieson
+    else if (rand_arrival <= enc->rustle[key]) // Small percentage to get a little surprise from Gieson
     {
         printf("\nSenti un fruscio vicino a te e cominci a correre. Dopodiché ti giri indietro ma non vedi niente.\nPremi INVIO.");
         waitEnter();
     }
+    METRICS_RECORD(M_CALL_GIESON, t_gieson);
+    TRACE_END(t_gieson_span, "callGieson");
 }
 
 /**
@@ -852,8 +1215,9 @@ void callGieson(Player* myP, int* moves)
  */
 void victory(Player* myP, int* moves)
 {
-    system("clear");
+    clearScreen();
     *moves = 0;
+    EMIT_EVENT(EV_VICTORY, myP, NULL, NOTHING, OUT_SUCCESS);
 
     char end_game [70];
     if (myP == &P1 && (P2.pos != NULL || P2.state == DEAD) )
@@ -894,8 +1258,10 @@ void victory(Player* myP, int* moves)
  */
 void gameOver(Player* myP, int* moves)
 {
-    system("clear");
+    (void)myP; // Only used by the events
+    clearScreen();
     *moves = 0;
+    EMIT_EVENT(EV_GAME_OVER, myP, NULL, NOTHING, OUT_DIED);
 
     printf("                                   _----..................___            \n"
            " __,,..,-====>       _,.--''------'' |   _____  ______________`''--._    \n"
@@ -909,6 +1275,327 @@ void gameOver(Player* myP, int* moves)
     waitEnter();
 }
 
+// --------------------------------TURN HISTORY---------------------------------
+/**
+ * Starts the history of a new or loaded game from the current map, which then can not change anymore
+ */
+static void startHistory()
+{
+    hist_zones = 0;
+    for (Zone* current = first_zone; current != NULL; current = current->next_zone)
+        zone_at[++hist_zones] = current;
+
+    historyInit(H_CELLS);
+    for (int id = 1; id <= hist_zones; id++)
+        historySet(H_ZONES + id - 1, zone_at[id]->object);
+    turn_count = 0;
+}
+
+/**
+ * Records a version of the game. Only the objects under the players can have been taken since the last one
+ * @param myP   The player of the turn
+ * @param moves The moves left to him
+ */
+static void recordHistory(Player* myP, int moves)
+{
+    Player* players[2] = {&P1, &P2};
+
+    for (int p = 0; p < 2; p++)
+    {
+        const Player* pl = players[p];
+
+        if (pl->pos != NULL)
+            historySet(H_ZONES + pl->pos->ID - 1, pl->pos->object);
+        historySet(H_PLAYER(p, H_STATE), pl->state);
+        historySet(H_PLAYER(p, H_POS),   pl->pos == NULL ? 0 : pl->pos->ID);
+        for (ObjType i = JUNK; i < NOTHING; i++)
+            historySet(H_PLAYER(p, H_BACKPACK + i), pl->backpack[i]);
+        historySet(H_PLAYER(p, H_OBJ_COUNT), pl->obj_count);
+        historySet(H_PLAYER(p, H_SEARCHED),  pl->searched);
+    }
+    historySet(H_GASOLINE,   gasoline_turns);
+    historySet(H_TURN_CHECK, turn_check);
+    historySet(H_PLAYING,    myP == &P1 ? 1 : 2);
+    historySet(H_MOVES,      moves);
+    historyCommit(turn_count);
+}
+
+/**
+ * Gives back to the game a cell of the version restored
+ */
+static void applyHistory(int cell, int32_t value)
+{
+    if (cell < hist_zones)
+    {
+        zone_at[cell + 1]->object = value;
+        return;
+    }
+    if (cell >= H_GASOLINE)
+    {
+        if (cell == H_GASOLINE)
+            gasoline_turns = value;
+        else if (cell == H_TURN_CHECK)
+            turn_check = value;
+        return; // The player and the moves of the turn are read by shiftManager and doTurn
+    }
+
+    Player* pl = (cell - hist_zones) / H_PLAYER_CELLS == 0 ? &P1 : &P2;
+    int     f  = (cell - hist_zones) % H_PLAYER_CELLS;
+    if (f == H_STATE)
+        pl->state = value;
+    else if (f == H_POS)
+        pl->pos = value == 0 ? NULL : zone_at[value];
+    else if (f == H_OBJ_COUNT)
+        pl->obj_count = value;
+    else if (f == H_SEARCHED)
+        pl->searched = value;
+    else
+        pl->backpack[f - H_BACKPACK] = value;
+}
+
+/**
+ * Takes the game back to the state before the last action, or to the start of a turn chosen by the player
+ * @param  undo TRUE to undo the last action
+ * @return      TRUE if the game has gone back
+ */
+static int rewindHistory(int undo)
+{
+    int version;
+
+    if (undo)
+    {
+        if (historyCount() < 2)
+        {
+            printf("Non ci sono azioni da annullare.\nPremi INVIO.");
+            waitEnter();
+            return FALSE;
+        }
+        version = historyCount() - 2;
+    }
+    else
+    {
+        if (turn_count < 2)
+        {
+            printf("Non ci sono turni precedenti a cui tornare.\nPremi INVIO.");
+            waitEnter();
+            return FALSE;
+        }
+        printf("Sei al turno %u. A quale turno vuoi tornare? (1-%u, 0 per annullare): ", turn_count, turn_count - 1);
+        int turn = getValue(0, turn_count - 1);
+        if (turn == 0)
+            return FALSE;
+        version = historyFindTurn(turn);
+    }
+
+    historyRestore(version, applyHistory);
+    turn_count = historyTurn(version);
+    printf("Torni al turno %u, con %s e %d %s.\nPremi INVIO.", turn_count,
+           historyGet(H_PLAYING) == 1 ? "Giacomo" : "Marzia", historyGet(H_MOVES), historyGet(H_MOVES) == 1 ? "mossa" : "mosse");
+    waitEnter();
+    return TRUE;
+}
+
+// ---------------------------------HIBERNATION---------------------------------
+/**
+ * Writes the lowest width bits of value into buf, starting from the bit *pos
+ */
+static void putBits(uint8_t* buf, size_t* pos, uint32_t value, int width)
+{
+    for (int i = 0; i < width; i++, (*pos)++)
+        if (value >> i & 1)
+            buf[*pos / 8] |= 1 << (*pos % 8);
+}
+
+static uint32_t getBits(const uint8_t* buf, size_t* pos, int width)
+{
+    uint32_t value = 0;
+
+    for (int i = 0; i < width; i++, (*pos)++)
+        value |= (uint32_t)(buf[*pos / 8] >> (*pos % 8) & 1) << i;
+    return value;
+}
+
+/**
+ * Appends a value to hib_history, 7 bits per byte (the highest bit tells that another byte follows)
+ */
+static void packVarint(uint32_t value)
+{
+    if (hib_len + 5 > hib_cap)
+    {
+        hib_cap     = hib_cap == 0 ? 1024 : 2 * hib_cap;
+        hib_history = (uint8_t*)realloc(hib_history, hib_cap);
+        if (hib_history == NULL)
+        {
+            fprintf(stderr, "\nImpossibile allocare la memoria per l'ibernazione.\n");
+            exit(-1);
+        }
+    }
+    do
+    {
+        hib_history[hib_len++] = (value & 127) | (value > 127 ? 128 : 0);
+        value >>= 7;
+    } while (value > 0);
+}
+
+static uint32_t unpackVarint(size_t* pos)
+{
+    uint32_t value = 0;
+
+    for (int shift = 0; ; shift += 7)
+    {
+        uint8_t byte = hib_history[(*pos)++];
+        value |= (uint32_t)(byte & 127) << shift;
+        if (byte < 128)
+            return value;
+    }
+}
+
+// A changed cell: its index + 1 (0 ends a version), then its value with the sign in the lowest bit
+static void packCell(int cell, int32_t value)
+{
+    packVarint(cell + 1);
+    packVarint((uint32_t)value << 1 ^ (uint32_t)(value >> 31));
+}
+
+/**
+ * Packs the history into hib_history and frees it: the number of versions, then for each version
+ * its turn and the cells changed since the version before, see packCell
+ */
+static void packHistory()
+{
+    hib_len = 0;
+    packVarint(historyCount());
+    for (int v = 0; v < historyCount(); v++)
+    {
+        packVarint(historyTurn(v));
+        historyDelta(v, packCell);
+        packVarint(0);
+    }
+    historyFree();
+}
+
+/**
+ * Builds again the history packed by packHistory, committing the versions one after the other
+ */
+static void unpackHistory()
+{
+    size_t pos      = 0;
+    int    versions = unpackVarint(&pos);
+
+    historyInit(H_CELLS);
+    for (int v = 0; v < versions; v++)
+    {
+        uint32_t turn = unpackVarint(&pos);
+        uint32_t cell;
+
+        while ((cell = unpackVarint(&pos)) != 0)
+        {
+            uint32_t value = unpackVarint(&pos);
+            historySet(cell - 1, (int32_t)(value >> 1) ^ -(int32_t)(value & 1));
+        }
+        historyCommit(turn);
+    }
+    free(hib_history);
+    hib_history = NULL;
+    hib_len     = hib_cap = 0;
+}
+
+/**
+ * Packs the game left idle into a blob and frees the map and the history (see packHistory):
+ *   the number of zones (16 bits), then 3 bits for the type and 3 for the object of each zone
+ *   (NOTHING once taken), then for each player the state (2), the ID of the zone (8, 0 when out),
+ *   searched (1), the backpack (16 each) and obj_count (16), then gasoline_turns, turn_check,
+ *   turn_count and crafted (32 each).
+ * The IDs fit in 8 bits since a map holds at most SAVE_MAX_ZONES zones
+ */
+void hibernate()
+{
+    METRICS_START(t_hibernate);
+    Player* players[2] = {&P1, &P2};
+    size_t  bits       = 16 + 6 * hist_zones + 2 * (2 + 8 + 1 + 6 * 16 + 16) + 4 * 32;
+    size_t  pos        = 0;
+
+    if ((hibernated = (uint8_t*)calloc((bits + 7) / 8, 1)) == NULL)
+        return; // The game just stays awake
+
+    putBits(hibernated, &pos, hist_zones, 16);
+    for (int id = 1; id <= hist_zones; id++)
+    {
+        putBits(hibernated, &pos, zone_at[id]->type,   3);
+        putBits(hibernated, &pos, zone_at[id]->object, 3);
+    }
+    for (int p = 0; p < 2; p++)
+    {
+        putBits(hibernated, &pos, players[p]->state, 2);
+        putBits(hibernated, &pos, players[p]->pos == NULL ? 0 : players[p]->pos->ID, 8);
+        putBits(hibernated, &pos, players[p]->searched, 1);
+        for (ObjType i = JUNK; i < NOTHING; i++)
+            putBits(hibernated, &pos, players[p]->backpack[i], 16);
+        putBits(hibernated, &pos, (uint16_t)players[p]->obj_count, 16);
+        memset(players[p], 0, sizeof(Player));
+    }
+    putBits(hibernated, &pos, gasoline_turns, 32);
+    putBits(hibernated, &pos, turn_check,     32);
+    putBits(hibernated, &pos, turn_count,     32);
+    putBits(hibernated, &pos, crafted,        32);
+
+    packHistory();
+    deleteMap();
+#ifdef __GLIBC__
+    malloc_trim(0); // Most of the chunks freed are in the middle of the heap, which free() does not give back
+#endif
+    METRICS_RECORD(M_HIBERNATE, t_hibernate);
+}
+
+/**
+ * Rebuilds the game packed by hibernate, with all the zones in a single block like a loaded map
+ */
+void wake()
+{
+    METRICS_START(t_wake);
+    Player* players[2] = {&P1, &P2};
+    size_t  pos        = 0;
+    int     zones      = getBits(hibernated, &pos, 16);
+
+    map_block = (Zone*)calloc(zones, sizeof(Zone));
+    if(map_block == NULL)
+    {
+        fprintf(stderr, "\nImpossibile allocare la memoria per la mappa.\n");
+        exit(-1);
+    }
+    for (int i = 0; i < zones; i++)
+    {
+        map_block[i].ID        = i + 1;
+        map_block[i].type      = getBits(hibernated, &pos, 3);
+        map_block[i].object    = getBits(hibernated, &pos, 3);
+        map_block[i].next_zone = i + 1 < zones ? &map_block[i + 1] : NULL;
+        zone_at[i + 1]         = &map_block[i];
+    }
+    first_zone = &map_block[0];
+    last_zone  = &map_block[zones - 1];
+
+    for (int p = 0; p < 2; p++)
+    {
+        players[p]->state     = getBits(hibernated, &pos, 2);
+        int id                = getBits(hibernated, &pos, 8);
+        players[p]->pos       = id == 0 ? NULL : zone_at[id];
+        players[p]->searched  = getBits(hibernated, &pos, 1);
+        for (ObjType i = JUNK; i < NOTHING; i++)
+            players[p]->backpack[i] = getBits(hibernated, &pos, 16);
+        players[p]->obj_count = (int16_t)getBits(hibernated, &pos, 16);
+    }
+    gasoline_turns = getBits(hibernated, &pos, 32);
+    turn_check     = getBits(hibernated, &pos, 32);
+    turn_count     = getBits(hibernated, &pos, 32);
+    crafted        = getBits(hibernated, &pos, 32);
+
+    hist_zones = zones;
+    unpackHistory();
+    free(hibernated);
+    hibernated = NULL;
+    METRICS_RECORD(M_WAKE, t_wake);
+}
+
 // ------------------------------SYSTEM FUNCTIONS-------------------------------
 /**
  * Sets the values for the game
@@ -935,22 +1622,17 @@ void setValues(Player* t_P1, Player* t_P2, unsigned int t_gasoline_turns, unsign
             P2.obj_count = -100;
             P2.searched  = FALSE;
         #else
-            P1.backpack[JUNK]       = 0;
-            P1.backpack[BANDAGE]    = 0;
-            P1.backpack[KNIFE]      = 1;
-            P1.backpack[GUN]        = 0;
-            P1.backpack[GASOLINE]   = 0;
-            P1.backpack[ADRENALINE] = 0;
-            P1.obj_count = 1;
+            const GameTables* t = tablesCurrent();
+
+            for (ObjType i = JUNK; i < NOTHING; i++)
+            {
+                P1.backpack[i] = t->start[0][i];
+                P2.backpack[i] = t->start[1][i];
+            }
+            P1.obj_count = t->start_count[0];
             P1.searched  = FALSE;
 
-            P2.backpack[JUNK]       = 0;
-            P2.backpack[BANDAGE]    = 0;
-            P2.backpack[KNIFE]      = 0;
-            P2.backpack[GUN]        = 0;
-            P2.backpack[GASOLINE]   = 0;
-            P2.backpack[ADRENALINE] = 2;
-            P2.obj_count = 2;
+            P2.obj_count = t->start_count[1];
             P2.searched  = FALSE;
         #endif
     }
@@ -961,77 +1643,228 @@ void setValues(Player* t_P1, Player* t_P2, unsigned int t_gasoline_turns, unsign
     }
     gasoline_turns = t_gasoline_turns;
     turn_check     = t_turn_check;
+    crafted        = 0;
+    startHistory();
 }
 
 /**
- * Saves the current game printing all the important variables into GameSave.save
+ * Asks the ID of the player, which names the save of the new game
+ * @return TRUE if the game can start, FALSE if the player doesn't want to overwrite the save with the same ID
+ */
+int askSession()
+{
+    printf("\nInserisci il tuo ID giocatore (lettere, numeri, '_' e '-', al massimo %d caratteri): ", SAVE_KEY_LEN - 1);
+    while(!getLine(session, SAVE_KEY_LEN) || !saveStoreValidKey(session))
+        printf("ID non valido, riprova: ");
+
+    legacy_save = FALSE;
+    if(saveStoreFind(session, NULL))
+    {
+        printf("Esiste già una partita salvata con l'ID %s, che verrà sovrascritta. Vuoi continuare? (s/n): ", session);
+        g_ans = getAns();
+        return g_ans == 's';
+    }
+    return TRUE;
+}
+
+/**
+ * Saves the current game printing all the important variables into the save of the session
  */
 void saveGame()
 {
+#ifndef HARNESS // The harness plays millions of games, none of them is saved
+    METRICS_START(t_save);
+    TRACE_BEGIN(t_save_span);
     if(first_zone != NULL)
     {
-        FILE* fptr;
-        fptr = fopen("GameSave.save", "w");
-        if(fptr == NULL)
+        char   path[600];
+        char   text[4096]; // 255 zones of at most 6 characters, the players and the variables
+        size_t len = 0;
+
+        if(legacy_save)
+            snprintf(path, sizeof(path), "%s", SAVE_LEGACY);
+        else if(!saveStorePath(session, path, sizeof(path)))
         {
-            fprintf(stderr, "Errore nell'apertura del file di salvataggio automatico.\n");
+            fprintf(stderr, "Errore nella creazione della cartella dei salvataggi %s.\n", SAVE_DIR);
             exit(-1);
         }
 
-        fprintf(fptr, "LINKED LIST:\n");
+        len += snprintf(text + len, sizeof(text) - len, "FORMAT: %d\n", SAVE_FORMAT);
+        len += snprintf(text + len, sizeof(text) - len, "LINKED LIST:\n");
         Zone* current = first_zone;
         while(current != NULL)
         {
-            fprintf(fptr, "%d-%d", current->type, current->object);
-            if(current->next_zone != NULL)
-                fprintf(fptr, ",");
-            else
-                fprintf(fptr, "#");
-
+            len += snprintf(text + len, sizeof(text) - len, "%d-%d%c", current->type, current->object,
+                            current->next_zone != NULL ? ',' : '#');
             current = current->next_zone;
         }
 
-        fprintf(fptr, "\nPLAYERS:\n");
-        fprintf(fptr, "P1-%d-%4d-|%4d-%4d-%4d-%4d-%4d-%4d|-%4d-%d\n",
-                P1.state, P1.pos == NULL ? 0 : P1.pos->ID,
-                P1.backpack[0], P1.backpack[1], P1.backpack[2], P1.backpack[3], P1.backpack[4], P1.backpack[5],
-                P1.obj_count, P1.searched);
-        fprintf(fptr, "P2-%d-%4d-|%4d-%4d-%4d-%4d-%4d-%4d|-%4d-%d\n",
-                P2.state, P2.pos == NULL ? 0 : P2.pos->ID,
-                P2.backpack[0], P2.backpack[1], P2.backpack[2], P2.backpack[3], P2.backpack[4], P2.backpack[5],
-                P2.obj_count, P2.searched);
-
-        fprintf(fptr, "GAME VARIABLES:\n");
-        fprintf(fptr, "%d, %d", turn_check, gasoline_turns);
-
-        fclose(fptr);
+        len += snprintf(text + len, sizeof(text) - len, "\nPLAYERS:\n");
+        len += snprintf(text + len, sizeof(text) - len, "P1-%d-%4d-|%4d-%4d-%4d-%4d-%4d-%4d|-%4d-%d\n",
+                        P1.state, P1.pos == NULL ? 0 : P1.pos->ID,
+                        P1.backpack[0], P1.backpack[1], P1.backpack[2], P1.backpack[3], P1.backpack[4], P1.backpack[5],
+                        P1.obj_count, P1.searched);
+        len += snprintf(text + len, sizeof(text) - len, "P2-%d-%4d-|%4d-%4d-%4d-%4d-%4d-%4d|-%4d-%d\n",
+                        P2.state, P2.pos == NULL ? 0 : P2.pos->ID,
+                        P2.backpack[0], P2.backpack[1], P2.backpack[2], P2.backpack[3], P2.backpack[4], P2.backpack[5],
+                        P2.obj_count, P2.searched);
+
+        len += snprintf(text + len, sizeof(text) - len, "GAME VARIABLES:\n");
+        len += snprintf(text + len, sizeof(text) - len, "%d, %d", turn_check, gasoline_turns);
+        len += snprintf(text + len, sizeof(text) - len, "\nCHECKSUM: %08x\n", (unsigned)saveChecksum(text, len));
+
+        // Written into a temporary file which then replaces the old save and is recorded in the index, see saveStoreWrite
+        if(!saveStoreWrite(path, legacy_save ? NULL : session, text, len))
+        {
+            fprintf(stderr, "Errore nella scrittura del file di salvataggio automatico.\n");
+            exit(-1);
+        }
     }
     else
         printf("Non è possibile salvare in questo momento.");
+    METRICS_RECORD(M_SAVE_GAME, t_save);
+    TRACE_END(t_save_span, "saveGame");
+#endif
+}
+
+/**
+ * Builds the map of a save, allocating all the zones with a single calloc
+ * @param data The parsed save
+ */
+static void buildMap(const SaveData* data)
+{
+    map_block = (Zone*)calloc(data->zones, sizeof(Zone));
+    if(map_block == NULL)
+    {
+        fprintf(stderr, "\nImpossibile allocare la memoria per la mappa.\n");
+        exit(-1);
+    }
+
+    for (int i = 0; i < data->zones; i++)
+    {
+        map_block[i].ID        = i + 1;
+        map_block[i].type      = data->type[i];
+        map_block[i].object    = data->object[i];
+        map_block[i].next_zone = i + 1 < data->zones ? &map_block[i + 1] : NULL;
+    }
+    first_zone = &map_block[0];
+    last_zone  = &map_block[data->zones - 1];
 }
 
 /**
- * Moves the player to the position of the map specified
- * @param myP         The player of which we have to assign the position
- * @param my_cur_zone A very small number representing the current position of the player
+ * Copies a player of a save, converting the ID of his zone into its pointer (0 means out of the map)
  */
-static void assignPosition(Player* myP, unsigned char my_cur_zone)
+static void loadPlayer(Player* myP, const SavePlayer* saved)
 {
-    Zone* current = first_zone;
+    myP->state     = saved->state;
+    myP->pos       = saved->pos == 0 ? NULL : &map_block[saved->pos - 1];
+    myP->obj_count = saved->obj_count;
+    myP->searched  = saved->searched;
+    memcpy(myP->backpack, saved->backpack, sizeof(myP->backpack));
+}
 
-    if (my_cur_zone == 0)
-        current = NULL;
+/**
+ * Lists the saved games and lets the player choose one, by ID or searching the IDs by their beginning
+ * @param  path Where the path of the save will be written
+ * @param  size Size of path
+ * @return      TRUE if a save has been chosen
+ */
+int chooseSave(char* path, size_t size)
+{
+    SaveEntry found[20];
+    char      input[SAVE_KEY_LEN] = "";
+    FILE*     legacy              = fopen(SAVE_LEGACY, "r");
+    int       has_legacy          = legacy != NULL;
+    int       total;
+
+    if(has_legacy)
+        fclose(legacy);
+
+    while(TRUE)
+    {
+        int n = saveStoreList(input, found, 20, &total);
+
+        if(total == 0 && input[0] == '\0' && !has_legacy)
+        {
+            fprintf(stderr, "\nAttualmente non è presente alcun salvataggio.\nPremi INVIO.");
+            waitEnter();
+            return FALSE;
+        }
+        if(n > 0 && strcmp(found[0].key, input) == 0)
+            break;
+
+        if(total == 0 && input[0] != '\0')
+        {
+            printf("\nNessuna partita salvata ha un ID che comincia con \"%s\".\n", input);
+            input[0] = '\0';
+            continue;
+        }
+
+        printf("\nPARTITE SALVATE: %d\n", total);
+        for (int i = 0; i < n; i++)
+        {
+            char      date[32];
+            time_t    updated = found[i].updated;
+            strftime(date, sizeof(date), "%d/%m/%Y %H:%M", localtime(&updated));
+            printf("- %-31s %6u turni, ultimo salvataggio: %s\n", found[i].key, found[i].saves, date);
+        }
+        if(total > n)
+            printf("... e altre %d. Scrivi l'inizio dell'ID per restringere la ricerca.\n", total - n);
+        if(has_legacy)
+            printf("Premi INVIO senza scrivere nulla per caricare %s.\n", SAVE_LEGACY);
+
+        printf("\nInserisci l'ID della partita, o l'inizio dell'ID per cercarla (0 per tornare al menù): ");
+        getLine(input, SAVE_KEY_LEN);
+
+        if(strcmp(input, "0") == 0)
+            return FALSE;
+        if(input[0] == '\0' && has_legacy)
+        {
+            snprintf(path, size, "%s", SAVE_LEGACY);
+            legacy_save = TRUE;
+            return TRUE;
+        }
+    }
+
+    snprintf(session, SAVE_KEY_LEN, "%s", input);
+    legacy_save = FALSE;
+    return saveStorePath(session, path, size);
+}
+
+/**
+ * Falls back to the snapshot before the last save, when the last one is damaged or missing (a crash during the save).
+ * The damaged save is removed, so that the next save does not put it in place of the good snapshot
+ * @param  path The save which could not be read
+ * @param  data Where the snapshot will be written
+ * @param  err  The error of the save, left unchanged if the snapshot can not be read too
+ * @return      TRUE if the snapshot has been read
+ */
+static int loadPrevious(const char* path, SaveData* data, SaveError* err)
+{
+    char      prev[620];
+    SaveError prev_err;
+
+    snprintf(prev, sizeof(prev), "%s%s", path, SAVE_PREV);
+    if(!saveParseFile(prev, data, &prev_err))
+        return FALSE;
+
+    if(err->line == 0)
+        fprintf(stderr, "\nImpossibile caricare il salvataggio %s: %s.\n", path, err->message);
     else
-        for(int i = 1; i<my_cur_zone; i++)
-            current = current->next_zone;
+        fprintf(stderr, "\nIl salvataggio %s non è valido (riga %d, colonna %d): %s.\n", path, err->line, err->column, err->message);
+    fprintf(stderr, "Viene caricato il salvataggio del turno precedente. Premi INVIO.");
+    waitEnter();
 
-    myP->pos = current;
+    remove(path);
+    return TRUE;
 }
 
 /**
- * Reads the GameSave.save file, reallocates the memory for the linked list and starts a new game.
- * It also call assignPosition to set the pos of the players given the ID of the zone where they currently are
- * @see assignPosition
+ * Reads the save chosen by the player, reallocates the memory for the linked list and starts a new game.
+ * The save is parsed by saveParseFile, which refuses the malformed files
+ * @see chooseSave
+ * @see loadPrevious
+ * @see buildMap
  * @see setValues
  * @see shiftManager
  */
@@ -1039,62 +1872,73 @@ void loadGame()
 {
     deleteMap(); // Just to prevent some errors I do another clear of the map
 
-    Player t_P1, t_P2;
-    unsigned char t_cur_zone;
-    unsigned int  t_gasoline_turns, t_turn_check;
-    FILE* fptr;
+    Player    t_P1, t_P2;
+    SaveData  data;
+    SaveError err;
+    char      path[600];
 
-    fptr = fopen("GameSave.save", "r");
-    if(fptr == NULL)
-    {
-        fprintf(stderr, "\nAttualmente non è presente alcun salvataggio.\nPremi INVIO.");
-        waitEnter();
+    if(!chooseSave(path, sizeof(path)))
         return;
-    }
 
-    // READING LINKED LIST
-    fscanf(fptr, "LINKED LIST:");
-    while(getc(fptr) != '#')
+    METRICS_START(t_load);
+    TRACE_BEGIN(t_load_span);
+    if(!saveParseFile(path, &data, &err) && !loadPrevious(path, &data, &err))
     {
-        int z_type,z_obj;
-        fscanf(fptr, "%d-%d", &z_type, &z_obj);
-        addZone(z_type, z_obj);
+        if(err.line == 0)
+            fprintf(stderr, "\nImpossibile caricare il salvataggio %s: %s.\nPremi INVIO.", path, err.message);
+        else
+            fprintf(stderr, "\nIl salvataggio %s non è valido (riga %d, colonna %d): %s.\nPremi INVIO.", path, err.line, err.column, err.message);
+        waitEnter();
+        return;
     }
 
-    // READING PLAYERS
-    while(getc(fptr) != ':');
-    while(getc(fptr) != '\n');
-
-    fscanf(fptr, "P1-%u-%hhd-|%4hd-%4hd-%4hd-%4hd-%4hd-%4hd|-%4d-%hhd\n",
-        &t_P1.state, &t_cur_zone,
-        &t_P1.backpack[0], &t_P1.backpack[1], &t_P1.backpack[2], &t_P1.backpack[3], &t_P1.backpack[4], &t_P1.backpack[5],
-        &t_P1.obj_count, &t_P1.searched);
-    assignPosition(&t_P1, t_cur_zone);
-
-    fscanf(fptr, "P2-%u-%hhd-|%4hd-%4hd-%4hd-%4hd-%4hd-%4hd|-%4d-%hhd\n",
-        &t_P2.state, &t_cur_zone,
-        &t_P2.backpack[0], &t_P2.backpack[1], &t_P2.backpack[2], &t_P2.backpack[3], &t_P2.backpack[4], &t_P2.backpack[5],
-        &t_P2.obj_count, &t_P2.searched);
-    assignPosition(&t_P2, t_cur_zone);
-
-    // READING GAME VARIABLES
-    while(getc(fptr) != ':');
-    while(getc(fptr) != '\n');
-    fscanf(fptr, "%d, %d", &t_turn_check, &t_gasoline_turns);
-
-    fclose(fptr);
+    buildMap(&data);
+    loadPlayer(&t_P1, &data.player[0]);
+    loadPlayer(&t_P2, &data.player[1]);
+    METRICS_RECORD(M_LOAD_GAME, t_load);
+    TRACE_END(t_load_span, "loadGame");
 
     // Setting values and starting the game
-    setValues(&t_P1, &t_P2, t_gasoline_turns, t_turn_check);
+    setValues(&t_P1, &t_P2, data.gasoline_turns, data.turn_check);
+    #ifdef EVENTS
+        game_id = eventsNewGame(); // A resumed game is recorded as a new session, without EV_GAME_START
+    #endif
     shiftManager();
 }
 
 /**
- * Simple alias to the remove function. It deletes the GameSave.save file
+ * Deletes the save of the session
  */
 void deleteSave()
 {
-    remove("GameSave.save");
+#ifndef HARNESS
+    if(legacy_save)
+        saveStoreDelete(SAVE_LEGACY);
+    else
+        saveStoreRemove(session);
+#endif
+}
+
+/**
+ * Records the finished game in the statistics. The turns are the saves of the session, which
+ * also count the ones played before a load; a game loaded from SAVE_LEGACY has no ID and is not recorded
+ */
+void recordStats()
+{
+#ifndef HARNESS
+    SaveEntry entry;
+    uint32_t  turns   = turn_count;
+    uint8_t   escaped = (P1.state != DEAD ? STATS_GIACOMO : 0) | (P2.state != DEAD ? STATS_MARZIA : 0);
+
+    if(legacy_save || !saveStoreValidKey(session))
+        return;
+    saveStoreFlush(); // The last saves reach the index once in place
+    if(saveStoreFind(session, &entry) && entry.saves > 1)
+        turns = entry.saves - 1; // The first save is the one of closeMap
+
+    if(!statsRecord(session, turns, hist_zones, crafted, escaped))
+        fprintf(stderr, "Impossibile registrare la partita in %s.\n", STATS_FILE);
+#endif
 }
 
 // -----------------------------MAIN MENU FUNCTIONS-----------------------------
@@ -1123,20 +1967,128 @@ void newGame()
     printf("Vuoi aiutarli a scappare vivi dal campeggio? (s/n): ");
     g_ans = getAns();
 
-    if(g_ans == 's')
+    if(g_ans == 's' && askSession())
         createMap();
 }
 
+/**
+ * Reloads the tables of the rules from TABLES_FILE, telling the player whether they have been accepted
+ */
+void reloadTables()
+{
+    if (tablesReload(TABLES_FILE))
+        printf("\nRegole di gioco ricaricate da %s.\nPremi INVIO.", TABLES_FILE);
+    else
+        printf("\nIl file %s è assente o non valido, restano in uso le regole precedenti.\nPremi INVIO.", TABLES_FILE);
+    waitEnter();
+}
+
+/**
+ * Prints the leaderboards, reading first the games finished by the other processes,
+ * then the lifetime statistics of a player, if he wants to see them
+ */
+void showStats()
+{
+#ifndef HARNESS
+    static const char* titles[STATS_BOARDS] = {
+        "Fughe più veloci",
+        "Vittorie consecutive",
+        "Oggetti creati"
+    };
+    static const char* units[STATS_BOARDS] = {"turni", "vittorie", "oggetti"};
+    StatsRank          top[STATS_TOP];
+    StatsPlayer        stats;
+    char               key[SAVE_KEY_LEN];
+
+    clearScreen();
+    textFramed("Classifiche");
+    statsRefresh();
+
+    for (int b = 0; b < STATS_BOARDS; b++)
+    {
+        int n = statsTop(b, top, STATS_TOP);
+
+        printf("\n%s\n", titles[b]);
+        if (n == 0)
+            printf("   Ancora nessun risultato.\n");
+        for (int i = 0; i < n; i++)
+        {
+            char   date[32];
+            time_t when = top[i].time;
+
+            strftime(date, sizeof(date), "%d/%m/%Y", localtime(&when));
+            printf("%2d) %-31s %6lld %-8s %s\n", i + 1, top[i].key, (long long)top[i].score, units[b], date);
+        }
+    }
+
+    printf("\nInserisci il tuo ID giocatore per vedere le tue statistiche (INVIO per tornare al menù): ");
+    if (getLine(key, SAVE_KEY_LEN) && key[0] != '\0')
+    {
+        if (statsPlayer(key, &stats))
+        {
+            printf("\nPartite giocate: %u, vinte: %u\n"
+                   "Vittorie consecutive: %u (record: %u)\n"
+                   "Oggetti creati: %u\n", stats.games, stats.wins, stats.streak, stats.best_streak, stats.crafted);
+            if (stats.best_turns > 0)
+                printf("Fuga più veloce: %u turni\n", stats.best_turns);
+        }
+        else
+            printf("\nNessuna partita conclusa con l'ID %s.\n", key);
+        printf("Premi INVIO.");
+        waitEnter();
+    }
+#endif
+}
+
 /**
  * Simply closes the game by clearing the screen and printing a message.
  */
 void closeGame()
 {
-    system("clear");
+    clearScreen();
     printf("Chiusura del programma...\n\n");
+    EVENTS_STOP();
+    SPECTATOR_CLOSE(); // The spectators of a game left in progress stop waiting for it
+    historyFree();
+#ifndef HARNESS
+    statsClose();
+#endif
+    METRICS_EXPORT();
+    TRACE_DUMP();
 }
 
 // ------------------------------UTILITY FUNCTIONS------------------------------
+/**
+ * Script mode, for the drivers which play through stdin: the screen is never cleared and the pauses
+ * do not wait for enter, so the input only contains the answers to the menus and to the questions
+ * @param on TRUE to enable it
+ */
+void setScriptMode(int on)
+{
+    script_mode = on;
+}
+
+/**
+ * Hibernation of the game left idle: when the player does not choose an action for the given time,
+ * the game is packed into a blob of a few bytes and the map is freed, until the next input
+ * @param seconds The idle time, 0 to never hibernate
+ */
+void setHibernation(int seconds)
+{
+    hibernate_after = seconds;
+}
+
+/**
+ * Clears the terminal. Every screen of the game starts from here
+ */
+void clearScreen()
+{
+#ifndef HARNESS
+    if(!script_mode)
+        system("clear");
+#endif
+}
+
 /**
  * Writes a text inside a frame
  * @param text The text that we want to write
@@ -1182,12 +2134,105 @@ void textFramedSub(const char* text)
 }
 
 /**
- * Captures everything inside the stdin and simply delete all this things by exiting from the function
+ * Reads the next chunk of stdin, after having shown what the game has printed so far.
+ * A game idle for longer than the time of setHibernation sleeps until the input arrives
+ * @return FALSE when the input is over
+ */
+static int fillInput()
+{
+    ssize_t n;
+
+    fflush(stdout);
+    if(idle_point && hibernate_after > 0)
+    {
+        struct pollfd in = {STDIN_FILENO, POLLIN, 0};
+        int           ready;
+
+        do
+            ready = poll(&in, 1, hibernate_after * 1000);
+        while(ready < 0 && errno == EINTR);
+        if(ready == 0)
+            hibernate();
+    }
+    do
+        n = read(STDIN_FILENO, in_buf, sizeof(in_buf));
+    while(n < 0 && errno == EINTR);
+
+    if(hibernated != NULL)
+        wake();
+
+    if(n <= 0)
+        return FALSE;
+    in_pos = 0;
+    in_len = n;
+    return TRUE;
+}
+
+/**
+ * @return The next char of the input, EOF when it is over
+ */
+static int nextChar()
+{
+    if(in_pos == in_len && !fillInput())
+        return EOF;
+    return (unsigned char)in_buf[in_pos++];
+}
+
+/**
+ * Skips the rest of the line, however long it is
+ * @param c The last char read
  */
-static void clear_stdin()
+static void skipLine(int c)
 {
-   char unwanted[50];
-   fgets(unwanted, sizeof(unwanted), stdin);
+    while(c != '\n' && c != EOF)
+    {
+        char* nl = memchr(in_buf + in_pos, '\n', in_len - in_pos);
+
+        if(nl != NULL)
+        {
+            in_pos = nl - in_buf + 1;
+            return;
+        }
+        in_pos = in_len;
+        c = nextChar();
+    }
+}
+
+/**
+ * When the input is over nobody can answer anymore: the game is closed, the save of a game in progress stays
+ */
+static void endOfInput()
+{
+    closeGame();
+    exit(0);
+}
+
+/**
+ * Reads a number at the start of the first line which is not empty, ignoring the rest of the line
+ * @param  value Where the number will be written
+ * @return       FALSE if the line does not start with a number
+ */
+static int readInt(int* value)
+{
+    int  c, digits = 0, negative = FALSE;
+    long v = 0;
+
+    while((c = nextChar()) == ' ' || c == '\t' || c == '\r' || c == '\n');
+    if(c == '-' || c == '+')
+    {
+        negative = c == '-';
+        c = nextChar();
+    }
+    for(; c >= '0' && c <= '9'; c = nextChar(), digits++)
+        if(v < 100000000) // Longer numbers stay out of any range
+            v = v * 10 + (c - '0');
+
+    if(c == EOF && digits == 0)
+        endOfInput();
+    skipLine(c);
+
+    *value = negative ? -v : v;
+    return digits > 0;
 }
 
 /**
@@ -1198,39 +2243,91 @@ static void clear_stdin()
  */
 int getValue(int inf_l, int sup_l)
 {
+#ifdef HARNESS
+    return harness_choice;
+#endif
     int opt;
 
-    while( (scanf("%d", &opt) != 1)
+    METRICS_WAIT_BEGIN();
+    TRACE_BEGIN(t_wait);
+    while( !readInt(&opt)
           || (opt < inf_l)
           || (opt > sup_l) )
     {
-        clear_stdin();
         printf("Il valore inserito non corrisponde a nessuna delle scelte proposte.\n\n");
         printf("La tua scelta: ");
     }
-    clear_stdin();
+    TRACE_END(t_wait, "getValue");
+    METRICS_WAIT_END();
 
     return opt;
 }
 
+/**
+ * Reads a line written by the user, without the '\n'
+ * @param  buf  Where the line will be written
+ * @param  size Size of buf
+ * @return      FALSE if the line was too long and it has been cut
+ */
+int getLine(char* buf, int size)
+{
+    int fits = TRUE, len = 0, c;
+
+    METRICS_WAIT_BEGIN();
+    TRACE_BEGIN(t_wait);
+    while((c = nextChar()) != '\n' && c != EOF && len < size - 1)
+        buf[len++] = c;
+    buf[len] = '\0';
+
+    if(c == EOF && len == 0)
+        endOfInput();
+    if(c != '\n' && c != EOF)
+    {
+        skipLine(c);
+        fits = FALSE;
+    }
+    TRACE_END(t_wait, "getLine");
+    METRICS_WAIT_END();
+
+    return fits;
+}
+
 /**
  * Utility function to check if the char taken by the user is correct or not
- * @return The char taken by the user
+ * @return The char taken by the user, '\n' for an empty line
  */
 char getAns()
 {
-    char opt;
+    int c;
 
-    scanf("%c", &opt);
-    clear_stdin();
+    METRICS_WAIT_BEGIN();
+    TRACE_BEGIN(t_wait);
+    if((c = nextChar()) == EOF)
+        endOfInput();
+    skipLine(c);
+    TRACE_END(t_wait, "getAns");
+    METRICS_WAIT_END();
 
-    return opt;
+    return c;
 }
 
 /**
- * A kind of alias for getchar. This function will be used to wait for the pressing of enter by the user
+ * Waits for the pressing of enter by the user. In script mode there is nobody to wait for
  */
 void waitEnter()
 {
-    while( getchar() != '\n' );
+#ifndef HARNESS
+    int c;
+
+    if(script_mode)
+        return;
+
+    METRICS_WAIT_BEGIN();
+    TRACE_BEGIN(t_wait);
+    if((c = nextChar()) == EOF)
+        endOfInput();
+    skipLine(c);
+    TRACE_END(t_wait, "waitEnter");
+    METRICS_WAIT_END();
+#endif
 }
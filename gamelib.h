@@ -19,6 +19,9 @@
 #define FALSE 0
 #define TRUE  !(FALSE)
 
+#define MAX_LANDS     7 /**<Minimum number of zones of a map, exit excluded */
+#define BACKPACK_SIZE 4 /**<Default size of the backpack, see tables.h */
+
 // Enums used to improve the code readability
 typedef enum {DEAD, INJURED, ALIVE}                                         PlayerState;
 typedef enum {KITCHEN, LIVING_ROOM, SHED, STREET, ALONG_LAKE, EXIT_CAMPING} TypeZone;
@@ -42,15 +45,21 @@ typedef struct player {
 // Main menu functions
 void newGame();
 void loadGame();
+void reloadTables();
+void showStats();
 void closeGame();
 
-char  g_ans;  /**<Global variable used to take an answer s/n from the user. */
-int   g_menu; /**<Global variable used to navigate through the menues. */
+extern char g_ans;  /**<Global variable used to take an answer s/n from the user. */
+extern int  g_menu; /**<Global variable used to navigate through the menues. */
 
 char* concat   (const char*, const char*);
 int   getValue (int, int);
 char  getAns   ();
+int   getLine  (char*, int);
 void  waitEnter();
+void  clearScreen();
+void  setScriptMode(int on);
+void  setHibernation(int seconds);
 
 void  textFramed(const char* text);
 void  textFramedSub(const char* text);
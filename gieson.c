@@ -0,0 +1,161 @@
+/******************************************************************************/
+/*!
+ * @file   gieson.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  libgieson: the interface of gieson.h over the headless engine of sim.c
+ *
+ * A batch checks its arguments and picks the engine once, then plays the games one
+ * after the other writing each result straight into the buffers of the caller: the cost
+ * of a call is paid once per batch, not once per game. The built-in policy runs without
+ * any adapter; a policy of the caller is called through a GiesonView of the game.
+ */
+/******************************************************************************/
+#include "gieson.h"
+#include "sim.h"
+#include "tables.h"
+
+// The values of gieson.h are part of the ABI, they can not follow the enums of gamelib.h silently
+_Static_assert(GIESON_ALIVE == (int)ALIVE && GIESON_EXIT_CAMPING == (int)EXIT_CAMPING && GIESON_NOTHING == (int)NOTHING,
+               "gieson.h is out of sync with gamelib.h");
+_Static_assert(GIESON_ADVANCE == (int)SIM_ADVANCE && GIESON_CRAFT == (int)SIM_CRAFT, "gieson.h is out of sync with sim.h");
+_Static_assert(GIESON_MAX_ZONES == SIM_MAX_ZONES && GIESON_RANDOM_OBJ == SIM_RANDOM_OBJ && GIESON_OUT == SIM_OUT,
+               "gieson.h is out of sync with sim.h");
+
+static void fillView(GiesonView* view, const SimGame* g)
+{
+    view->turns          = g->turns;
+    view->gasoline_turns = g->gasoline_turns;
+    view->zones          = g->zones;
+    view->backpack_size  = g->rules->backpack_size;
+    view->type           = g->type;
+    view->object         = g->object;
+    for (int p = 0; p < 2; p++)
+    {
+        GiesonPlayer* out = &view->player[p];
+
+        out->state     = g->p[p].state;
+        out->pos       = g->p[p].pos;
+        memcpy(out->backpack, g->p[p].backpack, sizeof(out->backpack));
+        out->obj_count = g->p[p].obj_count;
+        out->searched  = g->p[p].searched;
+        memset(out->reserved, 0, sizeof(out->reserved));
+    }
+}
+
+static SimAction adaptAction(const SimGame* g, int player, int moves, void* ctx)
+{
+    const GiesonPolicy* policy = ctx;
+    GiesonView          view;
+
+    fillView(&view, g);
+    return (SimAction)policy->action(&view, player, moves, policy->ctx);
+}
+
+static ObjType adaptItem(const SimGame* g, int player, void* ctx)
+{
+    const GiesonPolicy* policy = ctx;
+    GiesonView          view;
+
+    if (policy->item == NULL)
+        return sim_policy_default.item(g, player, NULL);
+    fillView(&view, g);
+    return (ObjType)policy->item(&view, player, policy->ctx);
+}
+
+/**
+ * Version of the interface the library was built with, to be compared with GIESON_ABI_VERSION of the caller
+ */
+uint32_t gieson_abi_version(void)
+{
+    return GIESON_ABI_VERSION;
+}
+
+/**
+ * Loads the tables of the game from a file in the format of GameTables.cfg.
+ * Until then the default tables are in use
+ * @return 1 on success, 0 if the file can not be read or is not valid (the old tables stay in use)
+ */
+int32_t gieson_load_tables(const char* path)
+{
+    return tablesReload(path) ? 1 : 0;
+}
+
+int32_t gieson_rules_count(void)
+{
+    return sim_variants_count;
+}
+
+/**
+ * Name of a rule set, to be passed to gieson_simulate_batch
+ * @return The name, NULL if the index is out of range
+ */
+const char* gieson_rules_name(int32_t index)
+{
+    return index >= 0 && index < sim_variants_count ? sim_variants[index].rules->name : NULL;
+}
+
+/**
+ * Plays a batch of games on the same map. The i-th game has the seed of the game first+i of a run of mapgen
+ * and abtest with the same seed, so a run split in more batches gives the same results
+ * @param  rules  Name of the rule set (see gieson_rules_name), NULL for the rules of the tables in use
+ * @param  map    The map
+ * @param  policy The policy, NULL for the built-in one
+ * @param  seed   Seed of the run
+ * @param  first  Index in the run of the first game of the batch
+ * @param  n      Number of games
+ * @param  out    Buffers of the results, entry i for the game first+i
+ * @return        The number of games played, or a GIESON_E_* error
+ */
+int64_t gieson_simulate_batch(const char* rules, const GiesonMap* map, const GiesonPolicy* policy,
+                              uint64_t seed, uint64_t first, int64_t n, const GiesonResults* out)
+{
+    const SimVariant* variant = NULL;
+    SimPolicy         adapter = {"ffi", adaptAction, adaptItem, (void*)policy, NULL};
+    SimMap            m;
+
+    if (map == NULL || out == NULL || n < 0 || map->type == NULL)
+        return GIESON_E_ARGS;
+    if (rules != NULL && (variant = simFindVariant(rules)) == NULL)
+        return GIESON_E_RULES;
+    if (map->zones < 1 || map->zones > SIM_MAX_ZONES || map->type[map->zones - 1] != EXIT_CAMPING)
+        return GIESON_E_MAP;
+
+    m.zones = map->zones;
+    for (int i = 0; i < map->zones; i++)
+    {
+        m.type[i]   = map->type[i];
+        m.object[i] = map->object == NULL ? SIM_RANDOM_OBJ : map->object[i];
+        if (m.type[i] > EXIT_CAMPING || (m.type[i] == EXIT_CAMPING && i + 1 < map->zones) ||
+            (m.object[i] > NOTHING && m.object[i] != SIM_RANDOM_OBJ))
+            return GIESON_E_MAP;
+    }
+
+    const SimPolicy* p = policy == NULL || policy->action == NULL ? &sim_policy_default : &adapter;
+    for (int64_t i = 0; i < n; i++)
+    {
+        SimResult res;
+        uint64_t  game_seed = simGameSeed(seed, first + i);
+
+        if (variant == NULL)
+            simPlay(&m, p, game_seed, &res);
+        else
+            variant->play(variant->rules, &m, p, game_seed, &res);
+
+        if (out->state != NULL)
+        {
+            out->state[2 * i]     = res.state[0];
+            out->state[2 * i + 1] = res.state[1];
+        }
+        if (out->escaped != NULL)
+        {
+            out->escaped[2 * i]     = res.escaped[0];
+            out->escaped[2 * i + 1] = res.escaped[1];
+        }
+        if (out->turns != NULL)
+            out->turns[i] = res.turns;
+        if (out->finished != NULL)
+            out->finished[i] = res.finished;
+    }
+    return n;
+}
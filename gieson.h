@@ -0,0 +1,114 @@
+/******************************************************************************/
+/*!
+ * @file   gieson.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Public header of libgieson, the headless engine as a library
+ *
+ * Stable C interface for the programs (and the FFIs of the other languages) which play
+ * games in batch: only fixed-width types and plain structs, none of the internal headers.
+ * The layout of the structs and the meaning of the functions only change together with
+ * GIESON_ABI_VERSION; new functions can be added without changing it.
+ *
+ * The results are written by struct of arrays into the buffers of the caller, e.g. the
+ * memory of numpy arrays, without any copy. The functions are reentrant: more threads can
+ * play the games of the same run together, each one with its own range of games.
+ *
+ * Static library: gcc -O2 -c -fvisibility=hidden gieson.c sim.c tables.c -std=c11 && ar rcs libgieson.a gieson.o sim.o tables.o
+ * Shared library: gcc -O2 -shared -fPIC -fvisibility=hidden -o libgieson.so gieson.c sim.c tables.c -std=c11
+ */
+/******************************************************************************/
+
+#ifndef GIESON_H_INCLUDED
+#define GIESON_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+    #define GIESON_API __attribute__((visibility("default")))
+#else
+    #define GIESON_API
+#endif
+
+#define GIESON_ABI_VERSION 1
+#define GIESON_MAX_ZONES   1024
+#define GIESON_RANDOM_OBJ  0xFF /**<Object of a zone drawn at the start of every game */
+#define GIESON_OUT         -1   /**<Position of a player who left the map */
+
+// Errors returned by gieson_simulate_batch
+#define GIESON_E_RULES     -1   /**<No rule set with the given name */
+#define GIESON_E_MAP       -2   /**<Map too long, too short, or not ending with the exit */
+#define GIESON_E_ARGS      -3   /**<Missing map or results, or negative number of games */
+
+// Same values of the enums of gamelib.h
+enum {GIESON_DEAD, GIESON_INJURED, GIESON_ALIVE};
+enum {GIESON_KITCHEN, GIESON_LIVING_ROOM, GIESON_SHED, GIESON_STREET, GIESON_ALONG_LAKE, GIESON_EXIT_CAMPING};
+enum {GIESON_JUNK, GIESON_BANDAGE, GIESON_KNIFE, GIESON_GUN, GIESON_GASOLINE, GIESON_ADRENALINE, GIESON_NOTHING};
+enum {GIESON_ADVANCE = 1, GIESON_RUMMAGE, GIESON_TAKE, GIESON_HEAL, GIESON_USE_ADRENALINE, GIESON_CRAFT};
+
+typedef struct {
+    int32_t  zones;            /**<Number of zones, exit included */
+    const uint8_t* type;       /**<Type of each zone, the last one has to be GIESON_EXIT_CAMPING */
+    const uint8_t* object;     /**<Object of each zone or GIESON_RANDOM_OBJ, NULL for all random */
+} GiesonMap;
+
+typedef struct {
+    int32_t  state;
+    int32_t  pos;              /**<Index of the zone, GIESON_OUT when out of the map */
+    uint16_t backpack[6];
+    int32_t  obj_count;
+    uint8_t  searched;
+    uint8_t  reserved[3];
+} GiesonPlayer;
+
+// What a policy sees of the game. It is valid only during the call
+typedef struct {
+    uint32_t       turns;
+    uint32_t       gasoline_turns;
+    int32_t        zones;
+    int32_t        backpack_size;
+    const uint8_t* type;
+    const uint8_t* object;     /**<Objects left in the zones */
+    GiesonPlayer   player[2];  /**<player[0] is Giacomo, player[1] is Marzia */
+} GiesonView;
+
+/**
+ * Action of a player, GIESON_ADVANCE ... GIESON_CRAFT. An action which can not be done is asked again,
+ * as in the menu of the game, and after too many of them the player advances
+ */
+typedef int32_t (*GiesonActionFn)(const GiesonView* view, int32_t player, int32_t moves, void* ctx);
+/**
+ * Item used against Gieson (GIESON_KNIFE, GIESON_GUN or GIESON_GASOLINE), asked only when there is a choice
+ */
+typedef int32_t (*GiesonItemFn)  (const GiesonView* view, int32_t player, void* ctx);
+
+typedef struct {
+    GiesonActionFn action;     /**<NULL for the built-in policy, which plays without any callback */
+    GiesonItemFn   item;       /**<NULL for the choice of the built-in policy */
+    void*          ctx;        /**<Passed back to the callbacks */
+} GiesonPolicy;
+
+// Buffers of the results, one entry for each game (two for state and escaped, P1 then P2). NULL to skip a field
+typedef struct {
+    uint8_t*  state;
+    uint8_t*  escaped;
+    uint32_t* turns;
+    uint8_t*  finished;        /**<0 if the game was stopped after too many turns */
+} GiesonResults;
+
+GIESON_API uint32_t    gieson_abi_version   (void);
+GIESON_API int32_t     gieson_load_tables   (const char* path);
+GIESON_API int32_t     gieson_rules_count   (void);
+GIESON_API const char* gieson_rules_name    (int32_t index);
+GIESON_API int64_t     gieson_simulate_batch(const char* rules, const GiesonMap* map, const GiesonPolicy* policy,
+                                             uint64_t seed, uint64_t first, int64_t n, const GiesonResults* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,55 @@
+/******************************************************************************/
+/*!
+ * @file   harness.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Hooks of gamelib.c for the differential tests of the headless engines
+ *
+ * Compiled with -D HARNESS, gamelib.c plays a whole game without any input/output:
+ * the screen is never drawn, the pauses return at once, nothing is saved and rand() is
+ * replaced by harnessRand. Before every choice of the menu of doTurn, and of chooseItem,
+ * the game passes its state to the harness, which answers in place of the player.
+ * The game logic (doTurn, the actions, callGieson, shiftManager) is the one of the game.
+ *
+ * The hooks below marked "provided by the harness" have to be defined by the program
+ * linked with gamelib.c, see tools/harness.c.
+ */
+/******************************************************************************/
+
+#ifndef HARNESS_H_INCLUDED
+#define HARNESS_H_INCLUDED
+
+#include <stdint.h>
+
+#define HARNESS_MAX_ZONES 255
+#define HARNESS_RANDOM    0xFF /**<Object of a zone drawn by randomObject */
+#define HARNESS_OUT       -1   /**<Position of a player out of the map */
+
+typedef struct {
+    int32_t  state;
+    int32_t  pos;                     /**<Index of the zone, HARNESS_OUT when out of the map */
+    uint16_t backpack[6];
+    int32_t  obj_count;
+    int32_t  searched;
+} HarnessPlayer;
+
+// The whole state of a game, as it is before a choice of the player
+typedef struct {
+    HarnessPlayer player[2];          /**<player[0] is Giacomo, player[1] is Marzia */
+    uint32_t      gasoline_turns;
+    uint32_t      turn_check;
+    uint32_t      turns;              /**<Turns completed */
+    int32_t       playing;            /**<0 or 1, the player of the turn */
+    int32_t       moves;
+    int32_t       zones;
+    uint8_t       object[HARNESS_MAX_ZONES];
+} HarnessState;
+
+void harnessPlay     (const uint8_t* type, const uint8_t* object, int zones, HarnessState* end);
+
+// Provided by the harness
+int  harnessRand     (void);
+int  harnessOnAction (const HarnessState* s);  /**<Returns the choice of the menu of doTurn, 1-6 */
+int  harnessOnItem   (const HarnessState* s);  /**<Returns the ObjType to use against Gieson */
+
+#endif
@@ -0,0 +1,256 @@
+/******************************************************************************/
+/*!
+ * @file   history.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Persistent history of a game, with structural sharing between the versions
+ *
+ * The versions are kept in order in an array: undoing an action is going back by one,
+ * a turn is found with a binary search over the turns of the versions. Going from a version
+ * to another one visits only the subtrees which are not shared by the two, so only the
+ * cells that differ are given back to the game.
+ */
+/******************************************************************************/
+#include "gamelib.h"
+#include "history.h"
+
+#define HISTORY_BLOCK 512 /**<Nodes allocated together */
+
+typedef struct histNode {
+    uint32_t epoch; /**<The version being built when the node was made: only that version can change it */
+    union {
+        struct histNode* child[HISTORY_FANOUT];
+        int32_t          cell [HISTORY_FANOUT];
+    };
+} HistNode;
+
+typedef struct nodeBlock {
+    struct nodeBlock* next;
+    HistNode          nodes[HISTORY_BLOCK];
+} NodeBlock;
+
+typedef struct {
+    HistNode* root;
+    uint32_t  turn;
+} Version;
+
+static NodeBlock* blocks     = NULL;
+static int        block_used = HISTORY_BLOCK;
+static size_t     nodes      = 0;
+
+static Version*   versions   = NULL;
+static int        count      = 0;
+static int        capacity   = 0;
+
+static HistNode*  work       = NULL; /**<Root of the version being built, shared with the last one until a cell changes */
+static HistNode*  zero       = NULL; /**<Root of the tree of zeros made by historyInit */
+static uint32_t   epoch      = 0;
+static int        depth      = 0;
+static int        cells      = 0;
+
+static HistNode* newNode(const HistNode* from)
+{
+    if (block_used == HISTORY_BLOCK)
+    {
+        NodeBlock* block = malloc(sizeof(NodeBlock));
+        if (block == NULL)
+        {
+            fprintf(stderr, "Memoria esaurita per la cronologia della partita.\n");
+            exit(-1);
+        }
+        block->next = blocks;
+        blocks      = block;
+        block_used  = 0;
+    }
+
+    HistNode* node = &blocks->nodes[block_used++];
+    if (from != NULL)
+        *node = *from;
+    else
+        memset(node, 0, sizeof(*node));
+    node->epoch = epoch;
+    nodes++;
+    return node;
+}
+
+/**
+ * Frees the whole history
+ */
+void historyFree()
+{
+    while (blocks != NULL)
+    {
+        NodeBlock* next = blocks->next;
+        free(blocks);
+        blocks = next;
+    }
+    free(versions);
+    versions   = NULL;
+    block_used = HISTORY_BLOCK;
+    nodes      = 0;
+    count      = capacity = 0;
+    work       = NULL;
+    zero       = NULL;
+}
+
+/**
+ * Starts a new history, freeing the old one. All the cells start from 0, in a version not committed yet
+ * @param n_cells Number of cells of the state of the game
+ */
+void historyInit(int n_cells)
+{
+    historyFree();
+    cells = n_cells;
+    for (depth = 1; (1L << (HISTORY_BITS * depth)) < n_cells; depth++)
+        ;
+
+    // A tree of zeros made of a single node for each level
+    epoch = 0;
+    work  = newNode(NULL);
+    for (int l = 1; l < depth; l++)
+    {
+        HistNode* parent = newNode(NULL);
+        for (int i = 0; i < HISTORY_FANOUT; i++)
+            parent->child[i] = work;
+        work = parent;
+    }
+    zero  = work;
+    epoch = 1;
+}
+
+/**
+ * Reads a cell of the version being built
+ */
+int32_t historyGet(int cell)
+{
+    const HistNode* node = work;
+
+    for (int l = depth - 1; l > 0; l--)
+        node = node->child[(cell >> (HISTORY_BITS * l)) & (HISTORY_FANOUT - 1)];
+    return node->cell[cell & (HISTORY_FANOUT - 1)];
+}
+
+/**
+ * Changes a cell of the version being built, copying the nodes on its path the first time they change
+ */
+void historySet(int cell, int32_t value)
+{
+    if (historyGet(cell) == value)
+        return;
+
+    HistNode** slot = &work;
+    for (int l = depth - 1; ; l--)
+    {
+        if ((*slot)->epoch != epoch)
+            *slot = newNode(*slot);
+        if (l == 0)
+        {
+            (*slot)->cell[cell & (HISTORY_FANOUT - 1)] = value;
+            return;
+        }
+        slot = &(*slot)->child[(cell >> (HISTORY_BITS * l)) & (HISTORY_FANOUT - 1)];
+    }
+}
+
+/**
+ * Commits the version being built. Nothing is added when no cell has changed since the last version of the same turn
+ * @param  turn The turn of the game of the version
+ * @return      The index of the version
+ */
+int historyCommit(uint32_t turn)
+{
+    if (count > 0 && versions[count - 1].root == work && versions[count - 1].turn == turn)
+        return count - 1;
+
+    if (count == capacity)
+    {
+        capacity = capacity == 0 ? 64 : capacity * 2;
+        versions = realloc(versions, capacity * sizeof(Version));
+        if (versions == NULL)
+        {
+            fprintf(stderr, "Memoria esaurita per la cronologia della partita.\n");
+            exit(-1);
+        }
+    }
+    versions[count].root = work;
+    versions[count].turn = turn;
+    epoch++; // From now on the nodes of the version are shared, not changed
+    return count++;
+}
+
+int historyCount()
+{
+    return count;
+}
+
+uint32_t historyTurn(int version)
+{
+    return versions[version].turn;
+}
+
+/**
+ * Binary search of the first version of a turn
+ * @return The index of the version, the last version if the turn has not been reached yet
+ */
+int historyFindTurn(uint32_t turn)
+{
+    int lo = 0, hi = count - 1;
+
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (versions[mid].turn < turn)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * Number of nodes allocated, a measure of the memory of the history
+ */
+size_t historyNodes()
+{
+    return nodes;
+}
+
+static void diff(const HistNode* from, const HistNode* to, int level, int base, void (*apply)(int, int32_t))
+{
+    if (from == to)
+        return;
+
+    int span = 1 << (HISTORY_BITS * level);
+    for (int i = 0; i < HISTORY_FANOUT && base + i * span < cells; i++)
+    {
+        if (level > 0)
+            diff(from->child[i], to->child[i], level - 1, base + i * span, apply);
+        else if (from->cell[i] != to->cell[i])
+            apply(base + i, to->cell[i]);
+    }
+}
+
+/**
+ * Tells the changes made by a version
+ * @param version The index of the version
+ * @param apply   Called for every cell which differs from the version before (from 0 for the first one),
+ *                with the value of the version
+ */
+void historyDelta(int version, void (*apply)(int, int32_t))
+{
+    diff(version > 0 ? versions[version - 1].root : zero, versions[version].root, depth - 1, 0, apply);
+}
+
+/**
+ * Goes back to a version, dropping the versions after it
+ * @param version The index of the version
+ * @param apply   Called for every cell which differs between the version being built and the one restored,
+ *                with the value of the restored one
+ */
+void historyRestore(int version, void (*apply)(int, int32_t))
+{
+    diff(work, versions[version].root, depth - 1, 0, apply);
+    work  = versions[version].root;
+    count = version + 1;
+    epoch++;
+}
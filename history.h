@@ -0,0 +1,38 @@
+/******************************************************************************/
+/*!
+ * @file   history.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Header file of history.c
+ *
+ * Persistent history of a game, one version for every action of the players.
+ * The state of the game is flattened into cells (the objects of the zones, the fields of
+ * the players, the global variables), kept in a tree with HISTORY_FANOUT children per node.
+ * A new version copies only the paths to the cells it changes and shares all the rest
+ * with the version before, so the memory grows with the number of changes and not with
+ * the size of the map.
+ */
+/******************************************************************************/
+
+#ifndef HISTORY_H_INCLUDED
+#define HISTORY_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HISTORY_BITS   3
+#define HISTORY_FANOUT (1 << HISTORY_BITS)
+
+void     historyInit   (int);
+void     historyFree   ();
+void     historySet    (int, int32_t);
+int32_t  historyGet    (int);
+int      historyCommit (uint32_t);
+int      historyCount  ();
+uint32_t historyTurn   (int);
+int      historyFindTurn(uint32_t);
+void     historyRestore(int, void (*)(int, int32_t));
+void     historyDelta  (int, void (*)(int, int32_t));
+size_t   historyNodes  ();
+
+#endif
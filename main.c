@@ -7,12 +7,33 @@
   */
 /******************************************************************************/
 #include "gamelib.h"
+#include "tables.h"
+#include "events.h"
+#include "savestore.h"
+#include "server.h"
 
 int main(int argc, char const *argv[])
 {
+    int port = 0;
+
     srand(time(NULL)); // Starting my random generator, generating the seed
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--script") == 0) // Input from a script, see setScriptMode
+            setScriptMode(TRUE);
+        else if(strcmp(argv[i], "--hibernate") == 0 && i + 1 < argc) // Idle seconds, see setHibernation
+            setHibernation(atoi(argv[++i]));
+        else if(strcmp(argv[i], "--serve") == 0 && i + 1 < argc) // One game for every connection, see serveGames
+            port = atoi(argv[++i]);
+    }
+    saveStoreOpen(); // Removing the temporary files of the saves left by the processes killed
+    if(port > 0 && !serveGames(port)) // Only the process of a connection goes on
+        return -1;
+    EVENTS_START();
+    tablesReload(TABLES_FILE); // If the file is missing the default rules are used
+    tablesWatchSignal();
     do {
-        system("clear");
+        clearScreen();
 
         printf("   ___ _                         ___           _ _            \n"
                "  / _ (_) ___  ___  ___  _ __   / __\\_ _ _   _| | |_         \n"
@@ -22,10 +43,12 @@ int main(int argc, char const *argv[])
 
         printf("1) Nuova Partita     \n"
                "2) Carica Partita    \n"
+               "3) Ricarica regole   \n"
+               "4) Classifiche       \n"
                "0) Esci dal gioco\n\n");
 
         printf("La tua scelta: ");
-        g_menu = getValue(0,2);
+        g_menu = getValue(0,4);
 
         switch(g_menu)
         {
@@ -35,6 +58,12 @@ int main(int argc, char const *argv[])
             case 2:
                 loadGame();
                 break;
+            case 3:
+                reloadTables();
+                break;
+            case 4:
+                showStats();
+                break;
         }
     } while(g_menu != 0);
     closeGame();
@@ -0,0 +1,285 @@
+/******************************************************************************/
+/*!
+ * @file   metrics.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Low-overhead latency histograms and counters, exported in the Prometheus text format
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include "metrics.h"
+
+#ifdef METRICS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <time.h>
+
+// Log-linear buckets (HDR-style): 16 linear sub-buckets for each power of two,
+// giving ~6% precision on every value from 1ns up to 2^40ns (~18 minutes)
+#define SUB_BITS    4
+#define SUB_BUCKETS (1 << SUB_BITS)
+#define MAX_BITS    40
+#define BUCKETS     ((MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS)
+
+// Every thread records into its own shard, so recording never needs a lock.
+// The values are atomics only to let metricsExport() read them from another thread.
+typedef struct shard {
+    _Atomic uint64_t hist    [M_TIMERS][BUCKETS];
+    _Atomic uint64_t sum     [M_TIMERS];
+    _Atomic uint64_t counter [C_COUNTERS];
+    uint64_t         wait_ns;
+    uint64_t         wait_start;
+    struct shard*    next;
+} Shard;
+
+static _Atomic(Shard*)        shards   = NULL;
+static _Thread_local Shard*   my_shard = NULL;
+
+static const char* tags_timer[M_TIMERS] = {
+    "progress_zone",
+    "rummage",
+    "take_item",
+    "heal",
+    "use_adrenaline",
+    "craft",
+    "call_gieson",
+    "save_game",
+    "load_game",
+    "render",
+    "hibernate",
+    "wake"
+};
+
+/**
+ * Returns the shard of the calling thread, allocating and registering it on first use
+ */
+static Shard* getShard()
+{
+    if (my_shard == NULL)
+    {
+        my_shard = (Shard*)calloc(1, sizeof(Shard));
+        if (my_shard == NULL)
+        {
+            fprintf(stderr, "\nImpossibile allocare la memoria per le metriche.\n");
+            exit(-1);
+        }
+
+        // Lock-free push on the list of shards
+        my_shard->next = atomic_load(&shards);
+        while (!atomic_compare_exchange_weak(&shards, &my_shard->next, my_shard));
+    }
+    return my_shard;
+}
+
+/**
+ * Adds a value to a counter owned by the calling thread (single writer, no locked instruction needed)
+ */
+static inline void bump(_Atomic uint64_t* cnt, uint64_t value)
+{
+    atomic_store_explicit(cnt, atomic_load_explicit(cnt, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+static inline unsigned bucketOf(uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+        return value;
+
+    unsigned msb = 63 - __builtin_clzll(value);
+    if (msb >= MAX_BITS)
+        return BUCKETS - 1;
+
+    return (msb - SUB_BITS + 1) * SUB_BUCKETS + ((value >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1));
+}
+
+/**
+ * Upper bound (exclusive) in nanoseconds of a bucket
+ */
+static uint64_t bucketLimit(unsigned bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket + 1;
+
+    unsigned msb = bucket / SUB_BUCKETS + SUB_BITS - 1;
+    return (uint64_t)(SUB_BUCKETS + bucket % SUB_BUCKETS + 1) << (msb - SUB_BITS);
+}
+
+/**
+ * Monotonic clock in nanoseconds, waits included
+ */
+static uint64_t clockNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/**
+ * Monotonic clock in nanoseconds, from which the time spent waiting for the user is removed.
+ * This way a span measured around an action only counts the time spent by the program.
+ * @return The current time of the active clock
+ * @see metricsWaitBegin
+ */
+uint64_t metricsNow()
+{
+    return clockNow() - getShard()->wait_ns;
+}
+
+/**
+ * Records the time elapsed since start into the histogram of the timer
+ * @param timer The timer to update
+ * @param start Value returned by metricsNow() at the beginning of the span
+ */
+void metricsRecord(MetricTimer timer, uint64_t start)
+{
+    uint64_t elapsed = metricsNow() - start;
+    Shard*   shard   = getShard();
+
+    bump(&shard->hist[timer][bucketOf(elapsed)], 1);
+    bump(&shard->sum[timer], elapsed);
+}
+
+/**
+ * Increments by 1 a counter
+ * @param counter The counter to increment
+ */
+void metricsCount(MetricCounter counter)
+{
+    bump(&getShard()->counter[counter], 1);
+}
+
+/**
+ * Marks the beginning of a wait for user input, stopping the active clock
+ */
+void metricsWaitBegin()
+{
+    getShard()->wait_start = clockNow();
+}
+
+/**
+ * Marks the end of a wait for user input, restarting the active clock
+ */
+void metricsWaitEnd()
+{
+    Shard* shard = getShard();
+    shard->wait_ns += clockNow() - shard->wait_start;
+}
+
+/**
+ * Finds the value under which falls the given fraction of the samples
+ */
+static double quantile(const uint64_t hist[BUCKETS], uint64_t count, double q)
+{
+    uint64_t rank = (uint64_t)(q * count);
+    uint64_t seen = 0;
+
+    for (unsigned b = 0; b < BUCKETS; b++)
+    {
+        seen += hist[b];
+        if (seen > rank)
+            return bucketLimit(b) / 1e9;
+    }
+    return bucketLimit(BUCKETS - 1) / 1e9;
+}
+
+/**
+ * Merges the shards of all threads and writes them in the Prometheus text format.
+ * The file is written aside and then renamed, so a scraper never reads a half-written file.
+ * @param path The file where the metrics will be written
+ */
+void metricsExport(const char* path)
+{
+    static uint64_t hist [M_TIMERS][BUCKETS];
+    uint64_t        sum  [M_TIMERS]   = {0};
+    uint64_t        count[C_COUNTERS] = {0};
+
+    for (int t = 0; t < M_TIMERS; t++)
+        for (int b = 0; b < BUCKETS; b++)
+            hist[t][b] = 0;
+
+    for (Shard* s = atomic_load(&shards); s != NULL; s = s->next)
+    {
+        for (int t = 0; t < M_TIMERS; t++)
+        {
+            for (int b = 0; b < BUCKETS; b++)
+                hist[t][b] += atomic_load_explicit(&s->hist[t][b], memory_order_relaxed);
+            sum[t] += atomic_load_explicit(&s->sum[t], memory_order_relaxed);
+        }
+        for (int c = 0; c < C_COUNTERS; c++)
+            count[c] += atomic_load_explicit(&s->counter[c], memory_order_relaxed);
+    }
+
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* fptr = fopen(tmp_path, "w");
+    if (fptr == NULL)
+    {
+        fprintf(stderr, "Errore nell'apertura del file delle metriche.\n");
+        return;
+    }
+
+    // LATENCIES
+    fprintf(fptr, "# HELP gieson_latency_seconds Time spent by the program in each operation, waits for input excluded.\n"
+                  "# TYPE gieson_latency_seconds histogram\n");
+    for (int t = 0; t < M_TIMERS; t++)
+    {
+        uint64_t cumulative = 0;
+        for (unsigned b = 0; b < BUCKETS; b++)
+        {
+            cumulative += hist[t][b];
+
+            // Only the powers of two starting from ~1us are exported as "le" boundaries
+            uint64_t limit = bucketLimit(b);
+            if (limit >= 1024 && (limit & (limit - 1)) == 0)
+                fprintf(fptr, "gieson_latency_seconds_bucket{op=\"%s\",le=\"%.9g\"} %llu\n",
+                        tags_timer[t], limit / 1e9, (unsigned long long)cumulative);
+        }
+        fprintf(fptr, "gieson_latency_seconds_bucket{op=\"%s\",le=\"+Inf\"} %llu\n", tags_timer[t], (unsigned long long)cumulative);
+        fprintf(fptr, "gieson_latency_seconds_sum{op=\"%s\"} %.9f\n",            tags_timer[t], sum[t] / 1e9);
+        fprintf(fptr, "gieson_latency_seconds_count{op=\"%s\"} %llu\n",          tags_timer[t], (unsigned long long)cumulative);
+    }
+
+    fprintf(fptr, "# HELP gieson_latency_quantile_seconds Quantiles of gieson_latency_seconds computed on the full resolution histogram.\n"
+                  "# TYPE gieson_latency_quantile_seconds gauge\n");
+    for (int t = 0; t < M_TIMERS; t++)
+    {
+        uint64_t total = 0;
+        for (unsigned b = 0; b < BUCKETS; b++)
+            total += hist[t][b];
+
+        if (total == 0)
+            continue;
+
+        fprintf(fptr, "gieson_latency_quantile_seconds{op=\"%s\",quantile=\"0.5\"} %.9g\n",   tags_timer[t], quantile(hist[t], total, 0.5));
+        fprintf(fptr, "gieson_latency_quantile_seconds{op=\"%s\",quantile=\"0.99\"} %.9g\n",  tags_timer[t], quantile(hist[t], total, 0.99));
+        fprintf(fptr, "gieson_latency_quantile_seconds{op=\"%s\",quantile=\"0.999\"} %.9g\n", tags_timer[t], quantile(hist[t], total, 0.999));
+    }
+
+    // COUNTERS
+    fprintf(fptr, "# HELP gieson_appearances_total Encounters with Gieson.\n"
+                  "# TYPE gieson_appearances_total counter\n"
+                  "gieson_appearances_total %llu\n", (unsigned long long)count[C_GIESON_APPEARANCES]);
+
+    fprintf(fptr, "# HELP gieson_deaths_total Players killed by Gieson, by cause.\n"
+                  "# TYPE gieson_deaths_total counter\n"
+                  "gieson_deaths_total{cause=\"no_item\"} %llu\n"
+                  "gieson_deaths_total{cause=\"knife_while_injured\"} %llu\n",
+                  (unsigned long long)count[C_DEATH_NO_ITEM], (unsigned long long)count[C_DEATH_KNIFE_INJURED]);
+
+    fprintf(fptr, "# HELP gieson_crafts_total Results of the craft action.\n"
+                  "# TYPE gieson_crafts_total counter\n"
+                  "gieson_crafts_total{result=\"knife\"} %llu\n"
+                  "gieson_crafts_total{result=\"gun\"} %llu\n"
+                  "gieson_crafts_total{result=\"gasoline\"} %llu\n"
+                  "gieson_crafts_total{result=\"failed\"} %llu\n",
+                  (unsigned long long)count[C_CRAFT_KNIFE],    (unsigned long long)count[C_CRAFT_GUN],
+                  (unsigned long long)count[C_CRAFT_GASOLINE], (unsigned long long)count[C_CRAFT_FAILED]);
+
+    fclose(fptr);
+    rename(tmp_path, path);
+}
+
+#endif
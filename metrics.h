@@ -0,0 +1,59 @@
+/******************************************************************************/
+/*!
+ * @file   metrics.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Header file of metrics.c
+ *
+ * Latency histograms and counters for the hot paths of the game.
+ * Everything here is compiled only when the METRICS macro is defined
+ * (gcc -D METRICS ...), otherwise the macros below expand to nothing.
+ */
+/******************************************************************************/
+
+#ifndef METRICS_H_INCLUDED
+#define METRICS_H_INCLUDED
+
+#include <stdint.h>
+
+#define METRICS_FILE "GameMetrics.prom"
+
+// The first six timers follow the order of the actions in the doTurn menu
+typedef enum {
+    M_PROGRESS_ZONE, M_RUMMAGE, M_TAKE_ITEM, M_HEAL, M_USE_ADRENALINE, M_CRAFT,
+    M_CALL_GIESON, M_SAVE_GAME, M_LOAD_GAME, M_RENDER, M_HIBERNATE, M_WAKE,
+    M_TIMERS
+} MetricTimer;
+
+typedef enum {
+    C_GIESON_APPEARANCES,
+    C_DEATH_NO_ITEM, C_DEATH_KNIFE_INJURED,
+    C_CRAFT_KNIFE, C_CRAFT_GUN, C_CRAFT_GASOLINE, C_CRAFT_FAILED,
+    C_COUNTERS
+} MetricCounter;
+
+#ifdef METRICS
+    uint64_t metricsNow      ();
+    void     metricsRecord   (MetricTimer, uint64_t);
+    void     metricsCount    (MetricCounter);
+    void     metricsWaitBegin();
+    void     metricsWaitEnd  ();
+    void     metricsExport   (const char*);
+
+    #define METRICS_START(var)       uint64_t var = metricsNow()
+    #define METRICS_RECORD(tim, var) metricsRecord((tim), (var))
+    #define METRICS_COUNT(cnt)       metricsCount(cnt)
+    #define METRICS_WAIT_BEGIN()     metricsWaitBegin()
+    #define METRICS_WAIT_END()       metricsWaitEnd()
+    #define METRICS_EXPORT()         metricsExport(METRICS_FILE)
+#else
+    // Statements that do nothing, so that they stay single statements (e.g. in an if without braces)
+    #define METRICS_START(var)
+    #define METRICS_RECORD(tim, var) do { } while (0)
+    #define METRICS_COUNT(cnt)       do { } while (0)
+    #define METRICS_WAIT_BEGIN()     do { } while (0)
+    #define METRICS_WAIT_END()       do { } while (0)
+    #define METRICS_EXPORT()         do { } while (0)
+#endif
+
+#endif
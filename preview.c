@@ -0,0 +1,457 @@
+/******************************************************************************/
+/*!
+ * @file   preview.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Incremental estimate of the difficulty of a map, while it is being created
+ *
+ * The state of a player is packed in a key: INJURED or not, the bandages, knives, guns,
+ * gasolines and junk (up to 3 each), obj_count (from -4 to 11, it can go below zero since
+ * the crafted items are not counted) and the turns of gasoline left. A zone is played
+ * expanding every random event (the appearance of Gieson, the crafting) into the
+ * distribution of the entry of the next zone, merged in a hash table by key.
+ */
+/******************************************************************************/
+#include "gamelib.h"
+#include "tables.h"
+#include "preview.h"
+#ifdef __GLIBC__ // Defined by the headers of the C library
+#include <malloc.h>
+#endif
+
+#define PREVIEW_ZONES 256       /**<The zones of a map, the exit included */
+#define ACC_BITS      20        /**<The hash table holds every possible key */
+#define ACC_SIZE      (1 << ACC_BITS)
+#define ITEM_MAX      3
+#define OBJ_MIN       -4
+#define OBJ_MAX       11
+#define OBJECT_SHARE  0.5       /**<Probability that the object of a zone is still there when the player arrives */
+#define PRUNE         1e-5      /**<States less likely than this, among the ones alive, are dropped */
+
+typedef struct {
+    int injured;
+    int item[6];                /**<Only JUNK, BANDAGE, KNIFE, GUN and GASOLINE are kept */
+    int obj;
+    int prot;                   /**<Turns of gasoline left */
+} PState;
+
+typedef struct {
+    uint32_t key;
+    double   p;
+} Mass;
+
+// The distribution of a player at the entry of a zone, and the probability of dying inside it
+typedef struct {
+    Mass*  mass;
+    int    n;
+    double alive;
+    double deaths;
+    double shielded;            /**<Fraction of the calls of Gieson inside the zone with the gasoline active */
+} Level;
+
+static Level             levels[2][PREVIEW_ZONES + 1];
+static uint8_t           types  [PREVIEW_ZONES];
+static uint8_t           objects[PREVIEW_ZONES];
+static int               zones  = 0;
+static GameTables        tables;            /**<Copy of the tables in use: a map can outlive TABLES_RETIRED reloads */
+static long              tables_gen = -1;   /**<tablesGeneration of the copy, -1 when there's none */
+
+// Hash table where the distribution of the next zone is built, allocated by previewReset and freed by previewFree
+static uint32_t* acc_key  = NULL; /**<key + 1, 0 for an empty slot */
+static double*   acc_p    = NULL;
+static uint32_t* acc_used = NULL; /**<Slots used, to empty them afterwards */
+static int       acc_n    = 0;
+
+// -------------------------------------STATE-----------------------------------
+static int clamp(int v, int lo, int hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static uint32_t pack(const PState* s)
+{
+    uint32_t key = s->injured;
+
+    for (int i = JUNK; i <= GASOLINE; i++)
+        key = key << 2 | clamp(s->item[i], 0, ITEM_MAX);
+    key = key << 4 | (clamp(s->obj, OBJ_MIN, OBJ_MAX) - OBJ_MIN);
+    return key << 4 | clamp(s->prot, 0, 15);
+}
+
+static PState unpack(uint32_t key)
+{
+    PState s = {0};
+
+    s.prot = key & 15;
+    key  >>= 4;
+    s.obj  = (int)(key & 15) + OBJ_MIN;
+    key  >>= 4;
+    for (int i = GASOLINE; i >= JUNK; i--, key >>= 2)
+        s.item[i] = key & 3;
+    s.injured = key & 1;
+    return s;
+}
+
+static void accumulate(const PState* s, double p)
+{
+    uint32_t key  = pack(s);
+    uint32_t slot = (key * 2654435761u) >> (32 - ACC_BITS);
+
+    while (acc_key[slot] != 0 && acc_key[slot] != key + 1)
+        slot = (slot + 1) & (ACC_SIZE - 1);
+    if (acc_key[slot] == 0)
+    {
+        acc_key[slot]     = key + 1;
+        acc_p[slot]       = 0;
+        acc_used[acc_n++] = slot;
+    }
+    acc_p[slot] += p;
+}
+
+// -------------------------------------ZONE------------------------------------
+typedef struct {
+    const GameTables* t;
+    int               exit;       /**<TRUE for the exit: advancing leaves the map */
+    double            other_dead; /**<Probability that the other player died before reaching the zone */
+    double            other_gas;  /**<Probability that the gasoline of the other player keeps Gieson away */
+    double            deaths;
+    double            rolls;      /**<Calls of Gieson, and the ones with the gasoline active */
+    double            rolls_gas;
+} Step;
+
+static void act(Step* st, PState s, double m, int searched, int avail);
+
+static void next(Step* st, const PState* s, double m, int searched, int avail, int advanced)
+{
+    if (advanced)
+        accumulate(s, m);
+    else
+        act(st, *s, m, searched, avail);
+}
+
+/**
+ * Like callGieson after a valid action, then the turn of the other player, who only uses up the gasoline
+ */
+static void roll(Step* st, PState s, double m, int searched, int avail, int advanced)
+{
+    const uint8_t* appear = st->t->encounter.appear;
+    int            out    = advanced && st->exit;
+    double         a      = ((1 - st->other_dead) * appear[ENC_KEY(s.prot, 0, out)] * (1 - st->other_gas) +
+                             st->other_dead * appear[ENC_KEY(s.prot, 1, out)]) / 100.0;
+    st->rolls     += m;
+    st->rolls_gas += s.prot > 0 ? m : 0;
+    s.prot        -= s.prot > 0;
+
+    for (int appears = 0; appears < 2; appears++)
+    {
+        double p = m * (appears ? a : 1 - a);
+        PState n = s;
+
+        if (p <= 0)
+            continue;
+        if (appears)
+        {
+            int item = s.item[GASOLINE] > 0 ? GASOLINE : (s.item[GUN] > 0 ? GUN : (s.item[KNIFE] > 0 ? KNIFE : NOTHING));
+            const EncounterOutcome* o = &encounter_outcome[item][s.injured ? INJURED : ALIVE];
+
+            if (o->died)
+            {
+                st->deaths += p;
+                continue;
+            }
+            n.item[o->slot] -= o->consume;
+            n.obj           -= o->consume;
+            n.injured        = o->state == INJURED;
+            n.prot           = o->gasoline * st->t->encounter.gasoline_turns;
+        }
+        if (n.prot > 0 && st->other_dead > 0) // Alone, the gasoline lasts twice as long
+        {
+            next(st, &n, p * st->other_dead, searched, avail, advanced);
+            p *= 1 - st->other_dead;
+        }
+        n.prot -= n.prot > 0;
+        if (p > 0)
+            next(st, &n, p, searched, avail, advanced);
+    }
+}
+
+/**
+ * The next action of the default policy of sim.c
+ */
+static void act(Step* st, PState s, double m, int searched, int avail)
+{
+    const GameTables* t = st->t;
+
+    if (s.injured && s.item[BANDAGE] > 0)
+    {
+        s.injured = FALSE;
+        s.item[BANDAGE]--;
+        s.obj--;
+        roll(st, s, m, searched, avail, FALSE);
+    }
+    else if (!searched)
+        roll(st, s, m, TRUE, avail, FALSE);
+    else if (avail != NOTHING && s.obj <= t->backpack_size)
+    {
+        if (avail != ADRENALINE) // Never used by the policy, it only fills the backpack
+            s.item[avail] = clamp(s.item[avail] + 1, 0, ITEM_MAX);
+        s.obj++;
+        roll(st, s, m, TRUE, NOTHING, FALSE);
+    }
+    else if (s.item[JUNK] > 0)
+    {
+        double ok     = clamp(101 - t->craft_fail, 0, 100) / 100.0;
+        int    spread = s.item[JUNK] < 3 ? s.item[JUNK] - 1 : 2;
+        PState failed = s;
+
+        failed.item[JUNK]--;
+        failed.obj--;
+        if (ok < 1)
+            roll(st, failed, m * (1 - ok), TRUE, avail, FALSE);
+
+        for (int item = KNIFE; item <= GASOLINE && ok > 0; item++)
+        {
+            int weight = 0;
+            for (int i = 0; i < t->craft_total[spread]; i++)
+                weight += t->craft_item[spread][i] == item;
+            if (weight == 0)
+                continue;
+
+            PState crafted = s;
+            crafted.obj       -= s.item[JUNK];
+            crafted.item[JUNK] = 0;
+            crafted.item[item] = clamp(crafted.item[item] + 1, 0, ITEM_MAX);
+            roll(st, crafted, m * ok * weight / t->craft_total[spread], TRUE, avail, FALSE);
+        }
+    }
+    else
+        roll(st, s, m, TRUE, avail, TRUE);
+}
+
+/**
+ * Plays a zone from the distribution of its entry
+ * @param from   The distribution at the entry of the zone, whose deaths are filled
+ * @param to     Where the distribution at the entry of the next zone will be written, NULL to only sum it
+ * @param other  The other player
+ * @param type   Type of the zone
+ * @param object Object of the zone, -1 if it is still to be drawn
+ * @return       The probability of getting out of the zone alive
+ */
+static double playZone(const GameTables* t, Level* from, Level* to, int other, int type, int object)
+{
+    int    zone  = from - levels[!other];
+    Step   st    = {t, type == EXIT_CAMPING, 1 - levels[other][zone].alive, zone > 0 ? levels[other][zone - 1].shielded : 0, 0, 0, 0};
+    double share = OBJECT_SHARE * (1 - st.other_dead) + st.other_dead; // A dead player takes nothing
+    double out   = 0;
+    double keep  = from->alive * PRUNE;
+
+    for (int i = 0; i < from->n; i++)
+    {
+        PState s = unpack(from->mass[i].key);
+        double m = from->mass[i].p;
+
+        if (m < keep)
+            continue;
+
+        for (int o = JUNK; o <= NOTHING; o++)
+        {
+            double p = 0;
+            if (object >= 0)
+                p = o == object;
+            else
+                for (int k = 0; k < 100; k++)
+                    p += (t->spawn[type][k] == o) / 100.0;
+            if (p <= 0)
+                continue;
+
+            if (o == NOTHING)
+                act(&st, s, m * p, FALSE, NOTHING);
+            else
+            {
+                act(&st, s, m * p * share, FALSE, o);
+                act(&st, s, m * p * (1 - share), FALSE, NOTHING);
+            }
+        }
+    }
+    from->deaths   = st.deaths;
+    from->shielded = st.rolls > 0 ? st.rolls_gas / st.rolls : 0;
+
+    if (to != NULL)
+    {
+        to->mass = malloc((acc_n + 1) * sizeof(Mass));
+        if (to->mass == NULL)
+        {
+            fprintf(stderr, "Impossibile allocare la memoria per la stima della mappa.\n");
+            exit(-1);
+        }
+        to->n = acc_n;
+    }
+    for (int i = 0; i < acc_n; i++)
+    {
+        uint32_t slot = acc_used[i];
+        if (to != NULL)
+            to->mass[i] = (Mass){acc_key[slot] - 1, acc_p[slot]};
+        out          += acc_p[slot];
+        acc_key[slot] = 0;
+    }
+    acc_n = 0;
+
+    if (to != NULL)
+    {
+        to->alive    = out;
+        to->shielded = 0;
+    }
+    return out;
+}
+
+// --------------------------------------MAP------------------------------------
+/**
+ * Forgets the zones, keeping only the initial backpacks of the tables in use
+ */
+void previewReset()
+{
+    if (acc_key == NULL)
+    {
+        acc_key  = calloc(ACC_SIZE, sizeof(uint32_t));
+        acc_p    = malloc(ACC_SIZE * sizeof(double));
+        acc_used = malloc(ACC_SIZE * sizeof(uint32_t));
+        if (acc_key == NULL || acc_p == NULL || acc_used == NULL)
+        {
+            fprintf(stderr, "Impossibile allocare la memoria per la stima della mappa.\n");
+            exit(-1);
+        }
+    }
+    tables_gen = tablesGeneration(); // Before the copy: a reload in between only makes the zones be played again
+    tables     = *tablesCurrent();
+    for (int p = 0; p < 2; p++)
+    {
+        for (int i = 0; i <= zones; i++)
+        {
+            free(levels[p][i].mass);
+            levels[p][i].mass = NULL;
+        }
+
+        PState s = {0};
+#ifdef DEBUG
+        for (int i = JUNK; i <= GASOLINE; i++)
+            s.item[i] = ITEM_MAX;
+        s.obj = OBJ_MIN;
+#else
+        for (int i = JUNK; i <= GASOLINE; i++)
+            s.item[i] = tables.start[p][i];
+        s.obj = tables.start_count[p];
+#endif
+        levels[p][0].mass = malloc(sizeof(Mass));
+        if (levels[p][0].mass == NULL)
+        {
+            fprintf(stderr, "Impossibile allocare la memoria per la stima della mappa.\n");
+            exit(-1);
+        }
+        levels[p][0].mass[0] = (Mass){pack(&s), 1.0};
+        levels[p][0].n       = 1;
+        levels[p][0].alive   = 1.0;
+    }
+    zones = 0;
+}
+
+/**
+ * Appends a zone, playing only that zone
+ * @param type   Type of the zone
+ * @param object Object of the zone
+ */
+void previewPush(TypeZone type, ObjType object)
+{
+    if (tables_gen < 0 || zones == PREVIEW_ZONES)
+        return;
+
+    types  [zones] = type;
+    objects[zones] = object;
+    for (int p = 0; p < 2; p++)
+        playZone(&tables, &levels[p][zones], &levels[p][zones + 1], !p, type, object);
+    zones++;
+}
+
+/**
+ * Removes the last zones, whose results are just dropped
+ * @param n The zones left
+ */
+void previewTruncate(int n)
+{
+    for (; zones > n; zones--)
+        for (int p = 0; p < 2; p++)
+        {
+            free(levels[p][zones].mass);
+            levels[p][zones].mass = NULL;
+        }
+}
+
+/**
+ * Frees the distributions and the hash table, about 16 MB once touched, when the map is closed.
+ * previewPush does nothing until the next previewReset
+ */
+void previewFree()
+{
+    previewTruncate(0);
+    for (int p = 0; p < 2; p++)
+    {
+        free(levels[p][0].mass);
+        levels[p][0].mass = NULL;
+    }
+    free(acc_key);
+    free(acc_p);
+    free(acc_used);
+    acc_key  = NULL;
+    acc_p    = NULL;
+    acc_used = NULL;
+    tables_gen = -1;
+#ifdef __GLIBC__
+    malloc_trim(0); // The distributions are scattered in the heap, free() alone keeps them resident
+#endif
+}
+
+/**
+ * When the tables have been reloaded the zones are played again with the new ones
+ */
+static void checkTables()
+{
+    if (tables_gen == (long)tablesGeneration())
+        return;
+
+    int n = zones;
+    previewReset();
+    for (int i = 0; i < n; i++)
+        previewPush(types[i], objects[i]);
+}
+
+/**
+ * @param  zone Index of the zone, from 0
+ * @return      The probability of dying in the zone for a player who enters it, on average between the two
+ */
+double previewDanger(int zone)
+{
+    double danger = 0;
+
+    checkTables();
+    if (zone < 0 || zone >= zones)
+        return 0;
+    for (int p = 0; p < 2; p++)
+        if (levels[p][zone].alive > 0)
+            danger += levels[p][zone].deaths / levels[p][zone].alive / 2;
+    return danger;
+}
+
+/**
+ * Probability of escape of each player, with the exit added to the map as closeMap does
+ * @param escape Where the probabilities of Giacomo and Marzia will be written
+ */
+void previewEscape(double escape[2])
+{
+    checkTables();
+    for (int p = 0; p < 2; p++)
+    {
+        Level last = levels[p][zones]; // The exit is not kept
+
+        escape[p] = zones == 0 ? 0 : playZone(&tables, &levels[p][zones], NULL, !p, EXIT_CAMPING, -1);
+        levels[p][zones] = last;
+    }
+}
@@ -0,0 +1,33 @@
+/******************************************************************************/
+/*!
+ * @file   preview.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Header file of preview.c
+ *
+ * Estimate of the difficulty of the map being created, shown by printMap.
+ * Each player is followed as a distribution over the states of the player (health, backpack,
+ * turns of gasoline left) at the entry of every zone, playing like the default policy of sim.c:
+ * heals when injured, searches every zone, takes what it finds, crafts and advances.
+ * The distribution at the entry of a zone only depends on the zones before it, so the
+ * distributions are kept for every prefix of the map: adding or removing the last zone
+ * costs the computation of a single zone, whatever the size of the map.
+ *
+ * The two players are followed apart: the other one is supposed alive, takes the object of
+ * a zone before the player half of the times and uses half of the turns of the gasoline.
+ */
+/******************************************************************************/
+
+#ifndef PREVIEW_H_INCLUDED
+#define PREVIEW_H_INCLUDED
+
+#include "gamelib.h"
+
+void   previewReset   ();
+void   previewPush    (TypeZone, ObjType);
+void   previewTruncate(int);
+void   previewFree    ();
+double previewDanger  (int);
+void   previewEscape  (double[2]);
+
+#endif
@@ -0,0 +1,338 @@
+/******************************************************************************/
+/*!
+ * @file   saveparse.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Single pass parser of the saves, over a buffer in memory
+ *
+ * The buffer is read once, from the start to the end, without allocations: the numbers
+ * are parsed in place and every value is checked against its range, so a malformed file
+ * is refused with the line and the column of the first error instead of being misread.
+ * A save damaged without breaking its format is caught by the checksum on its last line, which
+ * is required when the save starts with the line of the format: only the saves of version 1,
+ * without it, can end after the game variables.
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <ctype.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gamelib.h"
+#include "saveparse.h"
+
+typedef struct {
+    const char* p;
+    const char* end;
+    const char* line_start;
+    int         line;
+    SaveError*  err;
+} Cursor;
+
+static int fail(Cursor* c, const char* format, ...)
+{
+    va_list args;
+
+    c->err->line   = c->line;
+    c->err->column = (int)(c->p - c->line_start) + 1;
+    va_start(args, format);
+    vsnprintf(c->err->message, sizeof(c->err->message), format, args);
+    va_end(args);
+    return FALSE;
+}
+
+/**
+ * Consumes a literal, which can contain '\n' (a "\r\n" in the buffer is accepted too)
+ */
+static int expect(Cursor* c, const char* literal)
+{
+    for (const char* l = literal; *l; l++)
+    {
+        if (*l == '\n' && c->p < c->end && *c->p == '\r')
+            c->p++;
+        if (c->p >= c->end)
+            return fail(c, "fine del file inattesa");
+        if (*c->p != *l)
+        {
+            if (*l == '\n')
+                return fail(c, "atteso un a capo");
+            return fail(c, "atteso '%c'", *l);
+        }
+        c->p++;
+        if (*l == '\n')
+        {
+            c->line++;
+            c->line_start = c->p;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * Parses an integer, after the spaces of the padding of "%4d", and checks its range
+ * @param  c    The cursor
+ * @param  min  Minimum value accepted
+ * @param  max  Maximum value accepted
+ * @param  what Name of the value, for the error message
+ * @param  out  Where the value will be written
+ * @return      TRUE on success
+ */
+static int number(Cursor* c, long min, long max, const char* what, long* out)
+{
+    long value = 0;
+    int  neg   = FALSE;
+
+    while (c->p < c->end && *c->p == ' ')
+        c->p++;
+    if (c->p < c->end && *c->p == '-')
+    {
+        neg = TRUE;
+        c->p++;
+    }
+
+    const char* digits = c->p;
+    while (c->p < c->end && (unsigned)(*c->p - '0') < 10)
+    {
+        value = value * 10 + (*c->p - '0');
+        if (value > 1000000000L) // Far beyond any valid value, stopping before an overflow
+            return fail(c, "%s: numero troppo grande", what);
+        c->p++;
+    }
+    if (c->p == digits)
+        return fail(c, c->p >= c->end ? "%s: fine del file inattesa" : "%s: atteso un numero", what);
+
+    value = neg ? -value : value;
+    if (value < min || value > max)
+    {
+        c->p = digits - neg;
+        return fail(c, "%s: %ld fuori dall'intervallo [%ld, %ld]", what, value, min, max);
+    }
+    *out = value;
+    return TRUE;
+}
+
+/**
+ * Checksum of a save: FNV-1a hash of its text
+ */
+uint32_t saveChecksum(const char* buf, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (unsigned char)buf[i]) * 16777619u;
+    return h;
+}
+
+static void skipBlanks(Cursor* c)
+{
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\r' || *c->p == '\n' || *c->p == '\t'))
+    {
+        if (*c->p++ == '\n')
+        {
+            c->line++;
+            c->line_start = c->p;
+        }
+    }
+}
+
+/**
+ * Tells whether the cursor is at a tag, without consuming it
+ */
+static int atTag(const Cursor* c, const char* tag)
+{
+    size_t len = strlen(tag);
+    return (size_t)(c->end - c->p) >= len && memcmp(c->p, tag, len) == 0;
+}
+
+/**
+ * Parses the line with the checksum and compares it with the one of the body of the save
+ * @param  c        The cursor, after the blanks which follow the body
+ * @param  body     The body of the save, from its start to the end of the game variables
+ * @param  len      Length of body
+ * @param  required FALSE for the saves of version 1, which may not have the line
+ * @return          TRUE if the checksum matches, or if it is missing and not required
+ */
+static int checksum(Cursor* c, const char* body, size_t len, int required)
+{
+    static const char tag[] = "CHECKSUM:";
+    uint32_t          value = 0;
+
+    if (!atTag(c, tag))
+        return required ? fail(c, "checksum mancante, il salvataggio è troncato") : TRUE;
+    c->p += sizeof(tag) - 1;
+    while (c->p < c->end && *c->p == ' ')
+        c->p++;
+
+    const char* digits = c->p;
+    for (; c->p < c->end && c->p - digits < 8 && isxdigit((unsigned char)*c->p); c->p++)
+        value = value << 4 | (uint32_t)(*c->p <= '9' ? *c->p - '0' : (*c->p | 0x20) - 'a' + 10);
+    if (c->p - digits != 8)
+        return fail(c, "checksum: attese 8 cifre esadecimali");
+
+    if (value != saveChecksum(body, len))
+    {
+        c->p = digits;
+        return fail(c, "checksum errato, il salvataggio è danneggiato");
+    }
+    return TRUE;
+}
+
+static int parsePlayer(Cursor* c, int i, int zones, SavePlayer* p)
+{
+    static const char* tags[2] = {"P1-", "P2-"};
+    long v;
+
+    if (!expect(c, tags[i]))
+        return FALSE;
+
+    if (!number(c, DEAD, ALIVE, "stato", &v))
+        return FALSE;
+    p->state = v;
+
+    if (!expect(c, "-") || !number(c, 0, zones, "posizione", &v))
+        return FALSE;
+    p->pos = v;
+
+    if (!expect(c, "-|"))
+        return FALSE;
+    for (int o = 0; o < 6; o++)
+    {
+        if ((o > 0 && !expect(c, "-")) || !number(c, 0, 65535, "oggetti nello zaino", &v))
+            return FALSE;
+        p->backpack[o] = v;
+    }
+
+    // In -D DEBUG obj_count starts from -100
+    if (!expect(c, "|-") || !number(c, -1000000, 1000000, "numero di oggetti", &v))
+        return FALSE;
+    p->obj_count = v;
+
+    if (!expect(c, "-") || !number(c, FALSE, TRUE, "zona perquisita", &v))
+        return FALSE;
+    p->searched = v;
+
+    return expect(c, "\n");
+}
+
+/**
+ * Parses a save
+ * @param  buf  The text of the save. More saves can follow each other in the same buffer
+ * @param  len  Length of buf
+ * @param  data Where the save will be written
+ * @param  err  Where the error will be written
+ * @return      The number of bytes of the save (trailing whitespace included), 0 on error
+ */
+size_t saveParse(const char* buf, size_t len, SaveData* data, SaveError* err)
+{
+    Cursor c      = {buf, buf + len, buf, 1, err};
+    long   v;
+    long   format = 1;
+
+    // FORMAT, missing in the saves of version 1
+    if (atTag(&c, "FORMAT:"))
+    {
+        if (!expect(&c, "FORMAT:") || !number(&c, 2, SAVE_FORMAT, "versione del formato", &format) || !expect(&c, "\n"))
+            return 0;
+    }
+
+    // LINKED LIST
+    if (!expect(&c, "LINKED LIST:\n"))
+        return 0;
+
+    data->zones = 0;
+    do
+    {
+        if (data->zones == SAVE_MAX_ZONES)
+            return fail(&c, "più di %d zone", SAVE_MAX_ZONES);
+
+        if (!number(&c, KITCHEN, EXIT_CAMPING, "tipo di zona", &v))
+            return 0;
+        data->type[data->zones] = v;
+
+        if (!expect(&c, "-") || !number(&c, JUNK, NOTHING, "oggetto", &v))
+            return 0;
+        data->object[data->zones++] = v;
+
+        if (c.p >= c.end || (*c.p != ',' && *c.p != '#'))
+            return fail(&c, "atteso ',' o '#'");
+    } while (*c.p++ == ',');
+
+    if (data->type[data->zones - 1] != EXIT_CAMPING)
+        return fail(&c, "l'ultima zona deve essere l'uscita del campeggio");
+
+    // PLAYERS
+    if (!expect(&c, "\nPLAYERS:\n"))
+        return 0;
+    for (int i = 0; i < 2; i++)
+        if (!parsePlayer(&c, i, data->zones, &data->player[i]))
+            return 0;
+
+    // GAME VARIABLES
+    if (!expect(&c, "GAME VARIABLES:\n") || !number(&c, 0, 2, "turno", &v))
+        return 0;
+    data->turn_check = v;
+    if (!expect(&c, ",") || !number(&c, 0, 255, "turni della benzina", &v))
+        return 0;
+    data->gasoline_turns = v;
+
+    size_t body = c.p - buf;
+    skipBlanks(&c);
+    if (!checksum(&c, buf, body, format > 1))
+        return 0;
+    skipBlanks(&c);
+    return c.p - buf;
+}
+
+/**
+ * Parses a file containing a single save, reading it through mmap
+ * @param  path The file
+ * @param  data Where the save will be written
+ * @param  err  Where the error will be written (line 0 if the file can not be read)
+ * @return      TRUE on success
+ */
+int saveParseFile(const char* path, SaveData* data, SaveError* err)
+{
+    struct stat st;
+    int         fd = open(path, O_RDONLY);
+
+    err->line = err->column = 0;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        snprintf(err->message, sizeof(err->message), "impossibile aprire il file");
+        return FALSE;
+    }
+    if (st.st_size == 0)
+    {
+        close(fd);
+        snprintf(err->message, sizeof(err->message), "il file è vuoto");
+        return FALSE;
+    }
+
+    const char* buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (buf == MAP_FAILED)
+    {
+        snprintf(err->message, sizeof(err->message), "impossibile leggere il file");
+        return FALSE;
+    }
+
+    size_t used = saveParse(buf, st.st_size, data, err);
+    if (used != 0 && used != (size_t)st.st_size)
+    {
+        SaveError tail = {0};
+        Cursor    c    = {buf + used, buf + st.st_size, buf + used, 0, &tail};
+        for (const char* q = buf; q < buf + used; q++) // Line of the extra data, for the message
+            if (*q == '\n')
+                c.line++, c.line_start = q + 1;
+        c.line++;
+        fail(&c, "dati in più dopo la fine del salvataggio");
+        *err = tail;
+        used = 0;
+    }
+    munmap((void*)buf, st.st_size);
+    return used != 0;
+}
@@ -0,0 +1,60 @@
+/******************************************************************************/
+/*!
+ * @file   saveparse.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Header file of saveparse.c
+ *
+ * Parser of the text format written by saveGame:
+ *   FORMAT: 2
+ *   LINKED LIST:
+ *   type-object,type-object,...,type-object#
+ *   PLAYERS:
+ *   P1-state-   pos-|   n-   n-   n-   n-   n-   n|-obj_count-searched
+ *   P2-...
+ *   GAME VARIABLES:
+ *   turn_check, gasoline_turns
+ *   CHECKSUM: xxxxxxxx
+ * The last line is the saveChecksum in hex of everything before the '\n' that precedes it.
+ * The saves of version 1 (GameSave.save of the previous versions, the maps of mapgen) have no
+ * FORMAT line and their checksum is optional; with the FORMAT line it is required, so that a
+ * truncated save is refused.
+ */
+/******************************************************************************/
+
+#ifndef SAVEPARSE_H_INCLUDED
+#define SAVEPARSE_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SAVE_MAX_ZONES 255 /**<The ID of a zone is an unsigned char */
+#define SAVE_FORMAT    2   /**<Version of the format written by saveGame */
+
+typedef struct {
+    uint8_t        state;
+    uint8_t        pos;             /**<ID of the zone, 0 when out of the map */
+    unsigned short backpack[6];
+    int            obj_count;
+    uint8_t        searched;
+} SavePlayer;
+
+typedef struct {
+    int            zones;
+    uint8_t        type  [SAVE_MAX_ZONES];
+    uint8_t        object[SAVE_MAX_ZONES];
+    SavePlayer     player[2];
+    unsigned int   turn_check;
+    unsigned int   gasoline_turns;
+} SaveData;
+
+typedef struct {
+    int  line, column;              /**<Position of the error, starting from 1 */
+    char message[128];
+} SaveError;
+
+uint32_t saveChecksum(const char*, size_t);
+size_t saveParse     (const char*, size_t, SaveData*, SaveError*);
+int    saveParseFile (const char*, SaveData*, SaveError*);
+
+#endif
@@ -0,0 +1,1046 @@
+/******************************************************************************/
+/*!
+ * @file   savestore.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Store of the saved games, with a sorted index of the sessions
+ *
+ * The index is read through mmap and searched with a binary search. A save of an existing
+ * session only rewrites its record in place; a new or removed session rewrites the index
+ * into a temporary file which then replaces the old one, so a reader always sees a whole index.
+ * The processes sharing the store serialize the writes with a lock on index.lock.
+ *
+ * In SAVE_SYNC_GROUP mode saveStoreWrite only writes the temporary file and queues it, then
+ * returns: a thread wakes up at most every SAVE_SYNC_MS, makes durable all the saves queued in
+ * the meantime, and only then renames them into place, so the fsyncs are out of the turn of
+ * the player and a crash never exposes a save which is not on the disk yet. A group of more
+ * saves is made durable with a single syncfs, before the renames and after them.
+ * The queue is shared by the processes when one of them is the committer of the store (see
+ * saveStoreServeSync, the server of --serve): the others send it their saves through SAVE_SOCKET,
+ * so the sessions of different processes share their groups, and a save sent is committed even
+ * if its process is killed right after. Without a committer every process has its own thread.
+ * In every mode the record of a save in the index is updated only after the save is in place
+ * (and durable, in the modes with fsync), so the index never counts a save which can be lost.
+ */
+/******************************************************************************/
+#define _GNU_SOURCE // syncfs, see syncStore
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "gamelib.h"
+#include "savestore.h"
+
+typedef struct {
+    char     magic[4];
+    uint16_t version;
+    uint16_t size;
+    uint32_t count;
+    uint32_t reserved;       /**<Keeps the records aligned to 8 bytes */
+} IndexHeader;
+
+typedef struct {
+    void*            base;
+    size_t           size;
+    const SaveEntry* entries;
+    uint32_t         count;
+} IndexMap;
+
+static char            dir[512]   = SAVE_DIR;
+static pthread_mutex_t index_lock = PTHREAD_MUTEX_INITIALIZER; /**<The lock of index.lock is per process, this one orders the threads */
+
+/**
+ * Changes the directory of the store, SAVE_DIR by default
+ */
+void saveStoreSetDir(const char* path)
+{
+    snprintf(dir, sizeof(dir), "%s", path);
+}
+
+/**
+ * A key is made of 1 to SAVE_KEY_LEN-1 letters, digits, '_' or '-', so that it is also a valid file name
+ */
+int saveStoreValidKey(const char* key)
+{
+    size_t len = strlen(key);
+
+    if (len == 0 || len >= SAVE_KEY_LEN)
+        return FALSE;
+    for (size_t i = 0; i < len; i++)
+        if (!isalnum((unsigned char)key[i]) && key[i] != '_' && key[i] != '-')
+            return FALSE;
+    return TRUE;
+}
+
+/**
+ * FNV-1a hash of the key, reduced to a shard
+ */
+static uint32_t shardOf(const char* key)
+{
+    uint32_t h = 2166136261u;
+    for (; *key; key++)
+        h = (h ^ (unsigned char)*key) * 16777619u;
+    return h % SAVE_SHARDS;
+}
+
+static void padKey(const char* key, char padded[SAVE_KEY_LEN])
+{
+    memset(padded, 0, SAVE_KEY_LEN);
+    strncpy(padded, key, SAVE_KEY_LEN - 1);
+}
+
+// ------------------------------------INDEX------------------------------------
+/**
+ * Takes the lock of the index
+ * @param  type F_RDLCK to read, F_WRLCK to write
+ * @return      The descriptor holding the lock, to release with unlockIndex, -1 on error
+ */
+static int lockIndex(short type)
+{
+    char path[600];
+    int  fd;
+
+    // Closing any descriptor of index.lock drops the locks of the whole process, so the threads take turns
+    pthread_mutex_lock(&index_lock);
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+    {
+        pthread_mutex_unlock(&index_lock);
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "%s/index.lock", dir);
+    if ((fd = open(path, O_RDWR | O_CREAT, 0644)) < 0)
+    {
+        pthread_mutex_unlock(&index_lock);
+        return -1;
+    }
+
+    struct flock fl = {0};
+    fl.l_type   = type;
+    fl.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &fl) == -1)
+    {
+        if (errno != EINTR)
+        {
+            close(fd);
+            pthread_mutex_unlock(&index_lock);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+static void unlockIndex(int fd)
+{
+    close(fd);
+    pthread_mutex_unlock(&index_lock);
+}
+
+/**
+ * Maps the index in memory. A missing index is an empty one
+ * @return TRUE on success, FALSE if the index is damaged or can not be read
+ */
+static int mapIndex(IndexMap* m)
+{
+    char        path[600];
+    struct stat st;
+    int         fd;
+
+    m->base    = NULL;
+    m->size    = 0;
+    m->entries = NULL;
+    m->count   = 0;
+
+    snprintf(path, sizeof(path), "%s/index.db", dir);
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return errno == ENOENT;
+
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IndexHeader))
+    {
+        close(fd);
+        fprintf(stderr, "%s: indice dei salvataggi danneggiato.\n", path);
+        return FALSE;
+    }
+
+    m->size = st.st_size;
+    m->base = mmap(NULL, m->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m->base == MAP_FAILED)
+    {
+        m->base = NULL;
+        return FALSE;
+    }
+
+    const IndexHeader* h = (const IndexHeader*)m->base;
+    if (memcmp(h->magic, SAVE_MAGIC, 4) != 0 || h->version != SAVE_VERSION || h->size != sizeof(SaveEntry) ||
+        m->size < sizeof(IndexHeader) + (size_t)h->count * sizeof(SaveEntry))
+    {
+        munmap(m->base, m->size);
+        m->base = NULL;
+        fprintf(stderr, "%s: indice dei salvataggi danneggiato.\n", path);
+        return FALSE;
+    }
+
+    m->entries = (const SaveEntry*)((const char*)m->base + sizeof(IndexHeader));
+    m->count   = h->count;
+    return TRUE;
+}
+
+static void unmapIndex(IndexMap* m)
+{
+    if (m->base != NULL)
+        munmap(m->base, m->size);
+}
+
+/**
+ * Binary search of the first record whose key is not lower than the given one, comparing n bytes
+ */
+static uint32_t lowerBound(const IndexMap* m, const char* key, size_t n)
+{
+    uint32_t lo = 0, hi = m->count;
+
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (memcmp(m->entries[mid].key, key, n) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * Starts writing a new index into a temporary file, beginning with its header
+ * @param  tmp   Where the name of the temporary file will be written
+ * @param  count Number of records of the new index
+ * @return       The temporary file, NULL on error
+ */
+static FILE* beginIndex(char tmp[610], uint32_t count)
+{
+    IndexHeader h = {{'G', 'I', 'D', 'X'}, SAVE_VERSION, sizeof(SaveEntry), count, 0};
+
+    snprintf(tmp, 610, "%s/index.db.tmp", dir);
+    FILE* fptr = fopen(tmp, "wb");
+    if (fptr != NULL && fwrite(&h, sizeof(h), 1, fptr) != 1)
+    {
+        fclose(fptr);
+        remove(tmp);
+        return NULL;
+    }
+    return fptr;
+}
+
+/**
+ * Makes the new index durable and puts it in place of the old one. The lock for writing has to be held
+ * @param  fptr The temporary file
+ * @param  tmp  Its name
+ * @param  ok   FALSE if the writing of the records failed, in that case the temporary file is only removed
+ * @return      TRUE on success
+ */
+static int endIndex(FILE* fptr, const char* tmp, int ok)
+{
+    char path[600];
+
+    snprintf(path, sizeof(path), "%s/index.db", dir);
+    ok = ok && fflush(fptr) == 0 && fsync(fileno(fptr)) == 0;
+    ok = (fclose(fptr) == 0) && ok;
+
+    if (!ok || rename(tmp, path) != 0)
+    {
+        remove(tmp);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * Writes a new index made of the old one with a record inserted or removed at the given position
+ * @param  m      The old index
+ * @param  at     Position of the change
+ * @param  insert The record to insert, NULL to remove the record at the position
+ * @return        TRUE on success
+ */
+static int rewriteIndex(const IndexMap* m, uint32_t at, const SaveEntry* insert)
+{
+    char     tmp[610];
+    uint32_t skip = insert != NULL ? 0 : 1;
+    FILE*    fptr = beginIndex(tmp, m->count + (insert != NULL ? 1 : -1));
+
+    if (fptr == NULL)
+        return FALSE;
+
+    int ok = fwrite(m->entries, sizeof(SaveEntry), at, fptr) == at;
+    if (insert != NULL)
+        ok = ok && fwrite(insert, sizeof(SaveEntry), 1, fptr) == 1;
+    ok = ok && fwrite(m->entries + at + skip, sizeof(SaveEntry), m->count - at - skip, fptr) == m->count - at - skip;
+    return endIndex(fptr, tmp, ok);
+}
+
+// ------------------------------------STORE------------------------------------
+/**
+ * Looks for a session in the index
+ * @param  key   The key of the session
+ * @param  entry Where the record will be copied, can be NULL
+ * @return       TRUE if the session exists
+ */
+int saveStoreFind(const char* key, SaveEntry* entry)
+{
+    char     padded[SAVE_KEY_LEN];
+    IndexMap m;
+    int      found = FALSE;
+    int      lock  = lockIndex(F_RDLCK);
+
+    if (lock < 0)
+        return FALSE;
+
+    padKey(key, padded);
+    if (mapIndex(&m))
+    {
+        uint32_t i = lowerBound(&m, padded, SAVE_KEY_LEN);
+        if (i < m.count && memcmp(m.entries[i].key, padded, SAVE_KEY_LEN) == 0)
+        {
+            found = TRUE;
+            if (entry != NULL)
+                *entry = m.entries[i];
+        }
+        unmapIndex(&m);
+    }
+    unlockIndex(lock);
+    return found;
+}
+
+/**
+ * Builds the path of the save of a session, creating its subdirectory if needed
+ * @param  key  The key of the session
+ * @param  path Where the path will be written
+ * @param  size Size of path
+ * @return      TRUE on success
+ */
+int saveStorePath(const char* key, char* path, size_t size)
+{
+    uint32_t shard = shardOf(key); // The same shard recorded in the index, without taking its lock
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+        return FALSE;
+
+    snprintf(path, size, "%s/%02x", dir, (unsigned)shard);
+    if (mkdir(path, 0755) != 0 && errno != EEXIST)
+        return FALSE;
+
+    return snprintf(path, size, "%s/%02x/%s.save", dir, (unsigned)shard, key) < (int)size;
+}
+
+/**
+ * Records in the index the saves of a session, written at the path given by saveStorePath.
+ * saveStoreWrite calls it once the save is in place
+ * @param  key   The key of the session
+ * @param  saves Number of saves to record, more than one when the group commit merged them
+ * @return       TRUE on success
+ */
+int saveStoreCommit(const char* key, uint32_t saves)
+{
+    char     padded[SAVE_KEY_LEN];
+    IndexMap m;
+    int      ok   = FALSE;
+    int      lock = lockIndex(F_WRLCK);
+
+    if (lock < 0)
+        return FALSE;
+
+    padKey(key, padded);
+    if (mapIndex(&m))
+    {
+        uint32_t i = lowerBound(&m, padded, SAVE_KEY_LEN);
+
+        if (i < m.count && memcmp(m.entries[i].key, padded, SAVE_KEY_LEN) == 0)
+        {
+            // Existing session: only its record changes
+            SaveEntry e = m.entries[i];
+            char      path[600];
+
+            e.saves  += saves;
+            e.updated = time(NULL);
+            snprintf(path, sizeof(path), "%s/index.db", dir);
+
+            int fd = open(path, O_WRONLY);
+            if (fd >= 0)
+            {
+                ok = pwrite(fd, &e, sizeof(e), sizeof(IndexHeader) + (off_t)i * sizeof(SaveEntry)) == sizeof(e);
+                close(fd);
+            }
+        }
+        else
+        {
+            SaveEntry e;
+            memcpy(e.key, padded, SAVE_KEY_LEN);
+            e.shard   = shardOf(key);
+            e.saves   = saves;
+            e.created = e.updated = time(NULL);
+            ok = rewriteIndex(&m, i, &e);
+        }
+        unmapIndex(&m);
+    }
+    unlockIndex(lock);
+    return ok;
+}
+
+static int compareKeys(const void* a, const void* b)
+{
+    return memcmp(a, b, SAVE_KEY_LEN);
+}
+
+/**
+ * Records in the index the saves of many sessions at once, rewriting the index a single time.
+ * Used by the bulk imports, where a saveStoreCommit for each new session would rewrite the index every time
+ * @param  keys The keys of the sessions, padded with '\0'. They are sorted in place
+ * @param  n    Number of keys
+ * @return      TRUE on success
+ */
+int saveStoreCommitBatch(char (*keys)[SAVE_KEY_LEN], int n)
+{
+    IndexMap m;
+    int      ok   = FALSE;
+    int      lock = lockIndex(F_WRLCK);
+
+    if (lock < 0)
+        return FALSE;
+
+    qsort(keys, n, SAVE_KEY_LEN, compareKeys);
+    if (mapIndex(&m))
+    {
+        char     tmp[610];
+        int64_t  now   = time(NULL);
+        uint32_t count = m.count, i = 0;
+
+        // Counting the records of the merge first, the header comes before them
+        for (int k = 0; k < n; k++)
+        {
+            if (k > 0 && memcmp(keys[k], keys[k - 1], SAVE_KEY_LEN) == 0)
+                continue;
+            while (i < m.count && memcmp(m.entries[i].key, keys[k], SAVE_KEY_LEN) < 0)
+                i++;
+            count += !(i < m.count && memcmp(m.entries[i].key, keys[k], SAVE_KEY_LEN) == 0);
+        }
+
+        FILE* fptr = beginIndex(tmp, count);
+        if (fptr != NULL)
+        {
+            int written = TRUE;
+            i = 0;
+            for (int k = 0; k <= n && written; k++)
+            {
+                if (k > 0 && k < n && memcmp(keys[k], keys[k - 1], SAVE_KEY_LEN) == 0)
+                    continue;
+                while (i < m.count && (k == n || memcmp(m.entries[i].key, keys[k], SAVE_KEY_LEN) < 0))
+                    written = written && fwrite(&m.entries[i++], sizeof(SaveEntry), 1, fptr) == 1;
+                if (k == n)
+                    break;
+
+                SaveEntry e;
+                if (i < m.count && memcmp(m.entries[i].key, keys[k], SAVE_KEY_LEN) == 0)
+                {
+                    e = m.entries[i++];
+                    e.saves++;
+                }
+                else
+                {
+                    memcpy(e.key, keys[k], SAVE_KEY_LEN);
+                    e.shard   = shardOf(keys[k]);
+                    e.saves   = 1;
+                    e.created = now;
+                }
+                e.updated = now;
+                written = written && fwrite(&e, sizeof(e), 1, fptr) == 1;
+            }
+            ok = endIndex(fptr, tmp, written);
+        }
+        unmapIndex(&m);
+    }
+    unlockIndex(lock);
+    return ok;
+}
+
+/**
+ * Lists the sessions whose key starts with a prefix, in order of key
+ * @param  prefix  The prefix, "" for all the sessions
+ * @param  entries Where the records will be copied
+ * @param  max     Maximum number of records to copy
+ * @param  total   Where the number of sessions with the prefix will be written, can be NULL
+ * @return         The number of records copied
+ */
+int saveStoreList(const char* prefix, SaveEntry* entries, int max, int* total)
+{
+    size_t   len = strlen(prefix);
+    IndexMap m;
+    int      copied = 0, matching = 0;
+    int      lock   = lockIndex(F_RDLCK);
+
+    if (lock >= 0 && len < SAVE_KEY_LEN && mapIndex(&m))
+    {
+        for (uint32_t i = lowerBound(&m, prefix, len); i < m.count && memcmp(m.entries[i].key, prefix, len) == 0; i++)
+        {
+            if (copied < max)
+                entries[copied++] = m.entries[i];
+            matching++;
+        }
+        unmapIndex(&m);
+    }
+    if (lock >= 0)
+        unlockIndex(lock);
+    if (total != NULL)
+        *total = matching;
+    return copied;
+}
+
+/**
+ * Deletes the save of a session and its record
+ * @param  key The key of the session
+ * @return     TRUE if the session existed and has been removed
+ */
+int saveStoreRemove(const char* key)
+{
+    char     padded[SAVE_KEY_LEN];
+    IndexMap m;
+    int      ok = FALSE;
+    int      lock;
+
+    saveStoreFlush(); // The saves queued commit their records, taking the lock of the index
+    if ((lock = lockIndex(F_WRLCK)) < 0)
+        return FALSE;
+
+    padKey(key, padded);
+    if (mapIndex(&m))
+    {
+        uint32_t i = lowerBound(&m, padded, SAVE_KEY_LEN);
+
+        if (i < m.count && memcmp(m.entries[i].key, padded, SAVE_KEY_LEN) == 0)
+        {
+            char path[600];
+            snprintf(path, sizeof(path), "%s/%02x/%s.save", dir, (unsigned)m.entries[i].shard, key);
+            saveStoreDelete(path);
+            ok = rewriteIndex(&m, i, NULL);
+        }
+        unmapIndex(&m);
+    }
+    unlockIndex(lock);
+    return ok;
+}
+
+// ---------------------------------DURABILITY----------------------------------
+typedef struct {
+    char     path[600];
+    char     tmp [640];
+    char     key [SAVE_KEY_LEN]; /**<Session to record in the index once the save is in place, "" for none */
+    uint32_t saves;              /**<Saves merged into this one */
+} PendingSave;
+
+static SaveSync        sync_mode     = SAVE_SYNC_GROUP;
+static pthread_mutex_t sync_lock     = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  sync_wake     = PTHREAD_COND_INITIALIZER; /**<To the thread: saves queued, or a flush requested */
+static pthread_cond_t  sync_done     = PTHREAD_COND_INITIALIZER; /**<From the thread: a group has been taken or committed */
+static PendingSave     pending[SAVE_SYNC_MAX];
+static PendingSave     group  [SAVE_SYNC_MAX];                   /**<The group being committed, owned by the thread */
+static int             pending_count = 0;
+static int             sync_busy     = FALSE;
+static int             sync_flush    = FALSE;
+static int             sync_started  = FALSE;
+static unsigned        tmp_seq       = 0;
+static int             serve_fd      = -1; /**<Socket of the committer, in its process */
+static int             committer     = -1; /**<TRUE if the saves of the process go to a committer, FALSE if there's none, -1 not known yet */
+
+// Request to the committer: 'S' queues a save, 'F' waits until every save queued is committed
+typedef struct {
+    char        op;
+    PendingSave save;
+} SyncRequest;
+
+/**
+ * Writes a whole file
+ * @param  path    The file, created or truncated
+ * @param  text    The content
+ * @param  len     Length of text
+ * @param  durable TRUE to fsync the file before closing it
+ * @return         TRUE on success
+ */
+static int writeFile(const char* path, const char* text, size_t len, int durable)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int ok = fd >= 0;
+
+    while (ok && len > 0)
+    {
+        ssize_t n = write(fd, text, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        ok    = n > 0;
+        text += ok ? n : 0;
+        len  -= ok ? n : 0;
+    }
+    ok = ok && (!durable || fsync(fd) == 0);
+    if (fd >= 0)
+        ok = (close(fd) == 0) && ok;
+    if (!ok)
+        remove(path);
+    return ok;
+}
+
+/**
+ * Makes durable the renames done in the directory of a file
+ */
+static int syncDir(const char* path)
+{
+    char        name[600];
+    const char* slash = strrchr(path, '/');
+
+    snprintf(name, sizeof(name), "%.*s", slash != NULL ? (int)(slash - path) : 1, slash != NULL ? path : ".");
+    int fd = open(name, O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+        return FALSE;
+    int ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/**
+ * Puts a temporary file in place of a save, keeping the old save as the SAVE_PREV snapshot
+ */
+static int replaceSave(const char* path, const char* tmp)
+{
+    char prev[620];
+
+    snprintf(prev, sizeof(prev), "%s%s", path, SAVE_PREV);
+    if ((rename(path, prev) != 0 && errno != ENOENT) || rename(tmp, path) != 0)
+    {
+        remove(tmp);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * Records the saves of a session in the index, see saveStoreCommit
+ */
+static void commitIndex(const char* key, uint32_t saves)
+{
+    if (key != NULL && key[0] != '\0' && !saveStoreCommit(key, saves))
+        fprintf(stderr, "Errore nell'aggiornamento dell'indice dei salvataggi.\n");
+}
+
+/**
+ * Makes durable everything written on the file system of the store, with a single syncfs
+ * @return FALSE where syncfs is not available, or on error
+ */
+static int syncStore()
+{
+#ifdef __linux__
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    int ok = fd >= 0 && syncfs(fd) == 0;
+    if (fd >= 0)
+        close(fd);
+    return ok;
+#else
+    return FALSE;
+#endif
+}
+
+/**
+ * Commits a group of saves: every temporary file is made durable before the first rename,
+ * then the directories are synced once each, and only then the index is updated.
+ * A group of more saves is synced as a whole with syncStore, where it is available
+ */
+static void commitGroup(PendingSave* saves, int n)
+{
+    const char* dirs[SAVE_SHARDS + 1];
+    int         n_dirs = 0;
+    int         whole  = n > 1 && syncStore();
+
+    for (int i = 0; i < n && !whole; i++)
+    {
+        int fd = open(saves[i].tmp, O_RDONLY);
+        int ok = fd >= 0 && fsync(fd) == 0;
+        if (fd >= 0)
+            close(fd);
+        if (!ok)
+        {
+            remove(saves[i].tmp);
+            saves[i].path[0] = '\0';
+        }
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        if (saves[i].path[0] == '\0' || !replaceSave(saves[i].path, saves[i].tmp))
+        {
+            fprintf(stderr, "Errore nella scrittura del salvataggio %s.\n", saves[i].path[0] ? saves[i].path : saves[i].tmp);
+            saves[i].key[0] = '\0';
+            continue;
+        }
+
+        // A directory is synced once for the whole group
+        const char* slash = strrchr(saves[i].path, '/');
+        size_t      len   = slash != NULL ? (size_t)(slash - saves[i].path) : 0;
+        int         seen  = FALSE;
+        for (int d = 0; d < n_dirs && !seen; d++)
+            seen = strncmp(dirs[d], saves[i].path, len + 1) == 0;
+        if (!seen && n_dirs < SAVE_SHARDS + 1)
+            dirs[n_dirs++] = saves[i].path;
+    }
+    if (!whole || !syncStore())
+        for (int d = 0; d < n_dirs; d++)
+            syncDir(dirs[d]);
+    for (int i = 0; i < n; i++)
+        commitIndex(saves[i].key, saves[i].saves);
+}
+
+static void* syncThread(void* arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&sync_lock);
+    while (TRUE)
+    {
+        while (pending_count == 0)
+            pthread_cond_wait(&sync_wake, &sync_lock);
+
+        // The group stays open for SAVE_SYNC_MS, gathering the saves of the other sessions
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += SAVE_SYNC_MS * 1000000L;
+        until.tv_sec  += until.tv_nsec / 1000000000L;
+        until.tv_nsec %= 1000000000L;
+        while (!sync_flush && pending_count < SAVE_SYNC_MAX &&
+               pthread_cond_timedwait(&sync_wake, &sync_lock, &until) != ETIMEDOUT)
+            ;
+
+        int n = pending_count;
+        memcpy(group, pending, n * sizeof(PendingSave));
+        pending_count = 0;
+        sync_flush    = FALSE;
+        sync_busy     = TRUE;
+        pthread_cond_broadcast(&sync_done); // The queue has room again
+        pthread_mutex_unlock(&sync_lock);
+
+        commitGroup(group, n);
+
+        pthread_mutex_lock(&sync_lock);
+        sync_busy = FALSE;
+        pthread_cond_broadcast(&sync_done);
+    }
+    return NULL;
+}
+
+/**
+ * Starts the thread of the group commit, on the first save queued
+ * @return FALSE if the thread can not be started
+ */
+static int startSync()
+{
+    pthread_mutex_lock(&sync_lock);
+    if (!sync_started)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, syncThread, NULL) == 0)
+        {
+            pthread_detach(thread);
+            atexit(saveStoreFlush);
+            sync_started = TRUE;
+        }
+    }
+    pthread_mutex_unlock(&sync_lock);
+    return sync_started;
+}
+
+/**
+ * Queues a save for the thread of the group commit
+ */
+static void queueSave(const PendingSave* save)
+{
+    pthread_mutex_lock(&sync_lock);
+    int i = 0;
+    while (i < pending_count && strcmp(pending[i].path, save->path) != 0)
+        i++;
+    if (i < pending_count)
+    {
+        remove(pending[i].tmp); // A newer save of the same session, not committed yet, takes the place of the older one
+        memcpy(pending[i].tmp, save->tmp, sizeof(save->tmp));
+        pending[i].saves += save->saves;
+    }
+    else
+    {
+        while (pending_count == SAVE_SYNC_MAX)
+        {
+            sync_flush = TRUE;
+            pthread_cond_signal(&sync_wake);
+            pthread_cond_wait(&sync_done, &sync_lock);
+        }
+        pending[pending_count++] = *save;
+    }
+    pthread_cond_signal(&sync_wake);
+    pthread_mutex_unlock(&sync_lock);
+}
+
+static int socketPath(struct sockaddr_un* addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    return snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/%s", dir, SAVE_SOCKET) < (int)sizeof(addr->sun_path);
+}
+
+/**
+ * Sends a request to the committer of the store, on a connection of its own
+ * @param  op   'S' to queue a save, 'F' to wait until the saves queued are committed
+ * @param  save The save, for 'S'
+ * @return      TRUE once the save is sent (the committer reads it after the ones sent before),
+ *              or for 'F' once the committer has committed its queue
+ */
+static int sendSync(char op, const PendingSave* save)
+{
+    struct sockaddr_un addr;
+    SyncRequest        req = {0};
+    char               ack;
+    int                fd;
+
+    if (!socketPath(&addr) || (fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        return FALSE;
+
+    req.op = op;
+    if (save != NULL)
+        req.save = *save;
+    int ok = connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 &&
+             send(fd, &req, sizeof(req), MSG_NOSIGNAL) == sizeof(req) &&
+             (op != 'F' || recv(fd, &ack, 1, MSG_WAITALL) == 1);
+    close(fd);
+    return ok;
+}
+
+/**
+ * Serves the requests of sendSync, one connection at a time and in the order they have been sent.
+ * A save only has to be queued, so the sessions do not wait while a flush is served
+ */
+static void* serveThread(void* arg)
+{
+    (void)arg;
+    while (TRUE)
+    {
+        SyncRequest req;
+        int         conn = accept(serve_fd, NULL, NULL);
+
+        if (conn < 0)
+            continue;
+        if (recv(conn, &req, sizeof(req), MSG_WAITALL) == sizeof(req))
+        {
+            if (req.op == 'S')
+            {
+                req.save.path[sizeof(req.save.path) - 1] = req.save.tmp[sizeof(req.save.tmp) - 1] = '\0';
+                req.save.key[SAVE_KEY_LEN - 1] = '\0';
+                queueSave(&req.save);
+            }
+            else
+            {
+                saveStoreFlush();
+                send(conn, "k", 1, MSG_NOSIGNAL);
+            }
+        }
+        close(conn);
+    }
+    return NULL;
+}
+
+// The threads of the committer do not survive a fork: the child starts again as a process without them
+static void forkPrepare()
+{
+    pthread_mutex_lock(&sync_lock);
+    pthread_mutex_lock(&index_lock);
+}
+
+static void forkParent()
+{
+    pthread_mutex_unlock(&index_lock);
+    pthread_mutex_unlock(&sync_lock);
+}
+
+static void forkChild()
+{
+    pthread_mutex_unlock(&index_lock);
+    pthread_mutex_unlock(&sync_lock);
+    pthread_cond_init(&sync_wake, NULL);
+    pthread_cond_init(&sync_done, NULL);
+    close(serve_fd);
+    serve_fd      = -1;
+    pending_count = 0;
+    sync_busy     = FALSE;
+    sync_flush    = FALSE;
+    sync_started  = FALSE;
+    committer     = -1; // The saves of the child go to this process
+}
+
+/**
+ * Makes the process the committer of the store: the saves of the other processes (and of its
+ * children) in SAVE_SYNC_GROUP mode are queued and committed here, together with the ones of
+ * the process, instead of a thread for each process
+ * @return TRUE on success, FALSE if the socket can not be created (every process keeps its own thread)
+ */
+int saveStoreServeSync()
+{
+    struct sockaddr_un addr;
+    pthread_t          thread;
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+        return FALSE;
+    if (!socketPath(&addr) || (serve_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        return FALSE;
+
+    unlink(addr.sun_path); // Left by a committer which has not been closed
+    if (bind(serve_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(serve_fd, SOMAXCONN) != 0 ||
+        !startSync() || pthread_create(&thread, NULL, serveThread, NULL) != 0)
+    {
+        close(serve_fd);
+        serve_fd = -1;
+        return FALSE;
+    }
+    pthread_detach(thread);
+    pthread_atfork(forkPrepare, forkParent, forkChild);
+    committer = FALSE; // Its own saves are queued directly
+    return TRUE;
+}
+
+/**
+ * Removes the temporary files of the saves (KEY.save.PID.N.tmp) left in a directory by the
+ * processes killed before their saves were committed
+ */
+static void sweepDir(const char* path)
+{
+    DIR*           d   = opendir(path);
+    time_t         now = time(NULL);
+    struct dirent* e;
+
+    if (d == NULL)
+        return;
+    while ((e = readdir(d)) != NULL)
+    {
+        const char* ext = strstr(e->d_name, ".save.");
+        char        file[900];
+        struct stat st;
+        long        pid;
+        unsigned    seq;
+        int         end = 0;
+
+        if (ext == NULL || sscanf(ext, ".save.%ld.%u.tmp%n", &pid, &seq, &end) != 2 || end == 0 || ext[end] != '\0')
+            continue;
+        snprintf(file, sizeof(file), "%s/%s", path, e->d_name);
+        // The committer may still have the save of a process just ended in its queue
+        if (kill((pid_t)pid, 0) != 0 && errno == ESRCH && stat(file, &st) == 0 && now - st.st_mtime > SAVE_SWEEP_S)
+            remove(file);
+    }
+    closedir(d);
+}
+
+/**
+ * Opens the store, removing the temporary files left by the processes killed while saving.
+ * To be called once at the start of the program, before the saves
+ */
+void saveStoreOpen()
+{
+    char path[600];
+
+    for (int shard = 0; shard < SAVE_SHARDS; shard++)
+    {
+        snprintf(path, sizeof(path), "%s/%02x", dir, (unsigned)shard);
+        sweepDir(path);
+    }
+    sweepDir("."); // The ones of SAVE_LEGACY
+}
+
+/**
+ * Changes the durability mode, SAVE_SYNC_GROUP by default. The saves queued until then are committed first
+ */
+void saveStoreSetSync(SaveSync mode)
+{
+    saveStoreFlush();
+    sync_mode = mode;
+}
+
+/**
+ * Writes a save atomically, according to the durability mode, then records it in the index.
+ * In SAVE_SYNC_GROUP mode the save replaces the old one within SAVE_SYNC_MS, or at saveStoreFlush
+ * @param  path The save, the old one becomes path + SAVE_PREV
+ * @param  key  The session of the save, recorded in the index once the save is in place; NULL for a save outside the store
+ * @param  text Content of the save
+ * @param  len  Length of text
+ * @return      TRUE on success (in SAVE_SYNC_GROUP mode, if the save has been queued)
+ */
+int saveStoreWrite(const char* path, const char* key, const char* text, size_t len)
+{
+    PendingSave save;
+
+    // Every write has its own temporary file: the one of the previous save may be in the group being committed
+    snprintf(save.path, sizeof(save.path), "%s", path);
+    snprintf(save.tmp,  sizeof(save.tmp),  "%s.%ld.%u.tmp", path, (long)getpid(), tmp_seq++);
+    snprintf(save.key,  sizeof(save.key),  "%s", key != NULL ? key : "");
+    save.saves = 1;
+
+    if (!writeFile(save.tmp, text, len, sync_mode == SAVE_SYNC_ALWAYS))
+        return FALSE;
+    if (sync_mode != SAVE_SYNC_GROUP)
+    {
+        if (!replaceSave(path, save.tmp) || (sync_mode == SAVE_SYNC_ALWAYS && !syncDir(path)))
+            return FALSE;
+        commitIndex(key, 1);
+        return TRUE;
+    }
+
+    // To the committer of the store if there's one, else to the thread of the process
+    if (committer != FALSE && sendSync('S', &save))
+    {
+        committer = TRUE;
+        return TRUE;
+    }
+    if (committer == -1)
+        committer = FALSE;
+    if (startSync())
+        queueSave(&save);
+    else
+        commitGroup(&save, 1);
+    return TRUE;
+}
+
+/**
+ * Waits until every save queued has been committed, by the committer of the store too
+ */
+void saveStoreFlush()
+{
+    if (committer == TRUE && !sendSync('F', NULL))
+        fprintf(stderr, "Il processo che rende durevoli i salvataggi non risponde.\n");
+    if (!sync_started)
+        return;
+
+    pthread_mutex_lock(&sync_lock);
+    while (pending_count > 0 || sync_busy)
+    {
+        sync_flush = TRUE;
+        pthread_cond_signal(&sync_wake);
+        pthread_cond_wait(&sync_done, &sync_lock);
+    }
+    pthread_mutex_unlock(&sync_lock);
+}
+
+/**
+ * Deletes a save written by saveStoreWrite, together with its SAVE_PREV snapshot
+ */
+void saveStoreDelete(const char* path)
+{
+    char prev[620];
+
+    saveStoreFlush();
+    snprintf(prev, sizeof(prev), "%s%s", path, SAVE_PREV);
+    remove(path);
+    remove(prev);
+}
@@ -0,0 +1,78 @@
+/******************************************************************************/
+/*!
+ * @file   savestore.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Header file of savestore.c
+ *
+ * Store of the saved games, one for each session key (the ID of the player).
+ * The saves are spread over 256 subdirectories of SAVE_DIR, chosen by a hash of the key,
+ * and an index file keeps the sessions sorted by key, so that a session is found with
+ * a binary search and the list is read without opening the saves.
+ *
+ * Layout of SAVE_DIR:
+ *   index.db    header: "GIDX", uint16 version, uint16 size of a record, uint32 number of records, uint32 reserved
+ *               then the records (SaveEntry), sorted by key
+ *   index.lock  lock of the index, shared by the processes using the store
+ *   sync.sock   socket of the committer of the store, see saveStoreServeSync
+ *   xx/KEY.save the save of the session KEY, in the format of saveGame, xx being the shard in hex
+ *   xx/KEY.save.prev
+ *               the save before the last one, loaded when the last one is damaged
+ *
+ * A save is written by saveStoreWrite into a temporary file, which then replaces the old save
+ * with a rename: a crash leaves either the old save or the new one, never a truncated file.
+ * How the saves reach the disk depends on the durability mode (SaveSync); the record of the
+ * session in the index is updated after the rename. The temporary files are named KEY.save.PID.N.tmp,
+ * so that saveStoreOpen can remove the ones of the processes killed before their rename.
+ */
+/******************************************************************************/
+
+#ifndef SAVESTORE_H_INCLUDED
+#define SAVESTORE_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SAVE_DIR       "saves"
+#define SAVE_MAGIC     "GIDX"
+#define SAVE_VERSION   1
+#define SAVE_KEY_LEN   32   /**<Terminator included: a key has at most 31 characters */
+#define SAVE_SHARDS    256
+#define SAVE_LEGACY    "GameSave.save" /**<Single save of the previous versions, still loadable (the file written by mapgen, too) */
+#define SAVE_PREV      ".prev"
+#define SAVE_SYNC_MS   10   /**<Interval of the group commit */
+#define SAVE_SYNC_MAX  1024 /**<Saves waiting for the group commit, beyond it saveStoreWrite waits */
+#define SAVE_SOCKET    "sync.sock"
+#define SAVE_SWEEP_S   60   /**<Age of the temporary files of a dead process before saveStoreOpen removes them */
+
+typedef enum {
+    SAVE_SYNC_NONE,   /**<No fsync: the saves are atomic, but the last ones can be lost with the system */
+    SAVE_SYNC_GROUP,  /**<The saves are made durable together by a thread, every SAVE_SYNC_MS: the one of the
+                           committer of the store, shared by the processes (see saveStoreServeSync), or the one of the process */
+    SAVE_SYNC_ALWAYS  /**<An fsync for every save, before saveStoreWrite returns */
+} SaveSync;
+
+typedef struct {
+    char     key[SAVE_KEY_LEN]; /**<Padded with '\0', so that the keys compare with memcmp */
+    uint32_t shard;             /**<Subdirectory of the save */
+    uint32_t saves;             /**<Number of saves of the session, one for each turn */
+    int64_t  created;           /**<Time of the first save */
+    int64_t  updated;           /**<Time of the last save */
+} SaveEntry;
+
+void saveStoreSetDir (const char*);
+void saveStoreOpen   ();
+int  saveStoreServeSync();
+int  saveStoreValidKey(const char*);
+int  saveStorePath   (const char*, char*, size_t);
+int  saveStoreCommit (const char*, uint32_t);
+int  saveStoreCommitBatch(char (*)[SAVE_KEY_LEN], int);
+int  saveStoreFind   (const char*, SaveEntry*);
+int  saveStoreList   (const char*, SaveEntry*, int, int*);
+int  saveStoreRemove (const char*);
+void saveStoreSetSync(SaveSync);
+int  saveStoreWrite  (const char*, const char*, const char*, size_t);
+void saveStoreFlush  ();
+void saveStoreDelete (const char*);
+
+#endif
@@ -0,0 +1,92 @@
+/******************************************************************************/
+/*!
+ * @file   server.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Forking server of the game, one process for every connection
+ *
+ * The server accepts the connections and forks: the child binds the connection to its stdin
+ * and stdout and returns to main, which plays the game as usual; the server goes on
+ * accepting. The game flushes stdout only when it waits for the input (see fillInput), so a
+ * client receives every screen in one piece, ending with the question it has to answer.
+ * The children are reaped by the system, and a child whose client has gone away reads the
+ * end of its input and closes the game, leaving the save of the game in progress.
+ * The server is also the committer of the store: the saves of all the games are made durable
+ * together by its thread (see saveStoreServeSync).
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "gamelib.h"
+#include "savestore.h"
+#include "server.h"
+
+static char out_buf[1 << 16]; /**<stdout of a child, large enough for a whole screen */
+
+/**
+ * Listens on the given port of the loopback interface and serves a game to every connection
+ * @param  port The TCP port
+ * @return      TRUE in the child of a connection, with stdin and stdout bound to it; FALSE
+ *              in the server if it can not listen (the server never returns otherwise)
+ */
+int serveGames(int port)
+{
+    struct sockaddr_in addr = {0};
+    int                one  = 1;
+    int                listen_fd;
+
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if ((listen_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+        return FALSE;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, SERVER_BACKLOG) != 0)
+    {
+        fprintf(stderr, "Impossibile mettersi in ascolto sulla porta %d.\n", port);
+        close(listen_fd);
+        return FALSE;
+    }
+    signal(SIGCHLD, SIG_IGN); // The children are reaped by the system
+    if (!saveStoreServeSync()) // The children send their saves here, to be committed together
+        fprintf(stderr, "Impossibile condividere i salvataggi tra le partite: ognuna li renderà durevoli da sé.\n");
+    fprintf(stderr, "Server in ascolto su 127.0.0.1:%d\n", port);
+
+    while (TRUE)
+    {
+        int conn = accept(listen_fd, NULL, NULL);
+        if (conn < 0)
+        {
+            if (errno != EINTR && errno != ECONNABORTED && errno != EMFILE && errno != ENFILE)
+                perror("accept");
+            if (errno == EMFILE || errno == ENFILE)
+                nanosleep(&(struct timespec){0, 10000000}, NULL); // Out of descriptors: some children have to end first
+            continue;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(listen_fd);
+            setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            dup2(conn, STDIN_FILENO);
+            dup2(conn, STDOUT_FILENO);
+            close(conn);
+            setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+            signal(SIGCHLD, SIG_DFL);
+            srand(time(NULL) ^ getpid()); // The children of the same second must not play the same game
+            setScriptMode(TRUE);
+            return TRUE;
+        }
+        if (pid < 0)
+            perror("fork");
+        close(conn);
+    }
+}
@@ -0,0 +1,22 @@
+/******************************************************************************/
+/*!
+ * @file   server.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Header file of server.c
+ *
+ * Hosting of the game over TCP: every connection plays its own game, in its own process,
+ * exactly as a player on a terminal in script mode (see setScriptMode), so the text sent
+ * by a client is the same that a script would write. The server only listens on the
+ * loopback interface; tools/loadgen.c measures its latencies.
+ */
+/******************************************************************************/
+
+#ifndef SERVER_H_INCLUDED
+#define SERVER_H_INCLUDED
+
+#define SERVER_BACKLOG 4096
+
+int serveGames(int);
+
+#endif
@@ -0,0 +1,391 @@
+/******************************************************************************/
+/*!
+ * @file   sim.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Headless engine playing the rules of gamelib.c without input/output
+ *
+ * Every function here mirrors the function of gamelib.c with the same name,
+ * in the same order of checks and random draws. Keep them aligned.
+ * The functions depending on the constants of the rules are in sim_engine.inc.
+ */
+/******************************************************************************/
+#include <string.h>
+
+#include "sim.h"
+#include "tables.h"
+
+// Number of invalid choices in a row after which a policy is forced to advance
+#define MAX_INVALID 16
+
+#define SIM_CAT_(a, b) a##_##b
+#define SIM_CAT(a, b)  SIM_CAT_(a, b)
+#define SIM_FN(name)   SIM_CAT(name, SIM_VARIANT)
+
+// One static const struct for each rule set, so that its fields are known at compile time
+#define SIM_RULES(name, lands, backpack, exit, dead, base, gasoline, debug) \
+    static const SimRules sim_rules_##name = {#name, lands, backpack, exit, dead, base, gasoline, debug, \
+                                              ENCOUNTER_TABLE(exit, dead, base, 40, gasoline), NULL, NULL};
+#include "sim_rules.def"
+#undef SIM_RULES
+
+// ----------------------------IMPORTANCE SAMPLING------------------------------
+/**
+ * Multiplies the weight of the game by the odds of a draw under the nominal rules over its odds under the proposal
+ */
+static void simWeigh(SimGame* g, double nominal, double proposal)
+{
+    g->weight *= proposal > 0 ? nominal / proposal : 0;
+}
+
+static void simWeighSpawn(SimGame* g, int type, int object)
+{
+    if (g->nominal == NULL)
+        return;
+    simWeigh(g, g->nominal_tables->object_prop[type][object], g->tables->object_prop[type][object]);
+    g->draws->spawn[type][object]++;
+}
+
+static void simWeighAppear(SimGame* g, unsigned int key, int appeared)
+{
+    if (g->nominal == NULL)
+        return;
+    int p = g->nominal->encounter.appear[key], q = g->rules->encounter.appear[key];
+    simWeigh(g, appeared ? p : 100 - p, appeared ? q : 100 - q);
+    g->draws->appear[key][appeared]++;
+}
+
+// The craft succeeds when rand()%100+1 >= craft_fail, for 101-craft_fail values out of 100
+static int simCraftOdds(const GameTables* t)
+{
+    return t->craft_fail < 1 ? 100 : t->craft_fail > 101 ? 0 : 101 - t->craft_fail;
+}
+
+static void simWeighCraft(SimGame* g, int succeeded)
+{
+    if (g->nominal == NULL)
+        return;
+    int p = simCraftOdds(g->nominal_tables), q = simCraftOdds(g->tables);
+    simWeigh(g, succeeded ? p : 100 - p, succeeded ? q : 100 - q);
+    g->draws->craft[succeeded]++;
+}
+
+static void simWeighItem(SimGame* g, int spread, ObjType item)
+{
+    if (g->nominal == NULL)
+        return;
+    const int* p = g->nominal_tables->craft_spread[spread];
+    const int* q = g->tables->craft_spread[spread];
+    simWeigh(g, (double)p[item - KNIFE] / (p[0] + p[1] + p[2]), (double)q[item - KNIFE] / (q[0] + q[1] + q[2]));
+    g->draws->item[spread][item - KNIFE]++;
+}
+
+/**
+ * Builds a map with the given zones, appending the exit. The objects will be drawn at the start of every game
+ * @param map   The map to fill
+ * @param types Types of the zones, exit excluded
+ * @param n     Number of zones, exit excluded (at most SIM_MAX_ZONES-1)
+ */
+void simMapInit(SimMap* map, const TypeZone* types, int n)
+{
+    if (n > SIM_MAX_ZONES - 1)
+        n = SIM_MAX_ZONES - 1;
+
+    for (int i = 0; i < n; i++)
+    {
+        map->type[i]   = types[i];
+        map->object[i] = SIM_RANDOM_OBJ;
+    }
+    map->type[n]   = EXIT_CAMPING;
+    map->object[n] = SIM_RANDOM_OBJ;
+    map->zones     = n + 1;
+}
+
+/**
+ * Same as randomObject() of gamelib.c
+ */
+ObjType simRandomObj(SimRng* rng, const GameTables* tables, TypeZone type)
+{
+    return tables->spawn[type][simRand(rng)%100];
+}
+
+// -----------------------------------ACTIONS-----------------------------------
+static void simProgressZone(SimGame* g, SimPlayer* myP)
+{
+    if (myP->pos + 1 < g->zones)
+    {
+        myP->pos++;
+        myP->searched = FALSE;
+    }
+    else
+        myP->pos = SIM_OUT;
+}
+
+static void simRummage(SimGame* g, SimPlayer* myP, int* moves)
+{
+    if(myP->searched == TRUE)
+        (*moves)++;
+    else
+        myP->searched = TRUE;
+    (void)g;
+}
+
+static void simHeal(SimPlayer* myP, int* moves)
+{
+    if (myP->backpack[BANDAGE] > 0 && myP->state != ALIVE)
+    {
+        myP->state = ALIVE;
+        myP->backpack[BANDAGE]--;
+        myP->obj_count--;
+    }
+    else
+        (*moves)++;
+}
+
+static void simUseAdrenaline(SimPlayer* myP, int* moves)
+{
+    if (myP->backpack[ADRENALINE] > 0)
+    {
+        myP->backpack[ADRENALINE]--;
+        myP->obj_count--;
+        if (*moves == 1)
+            *moves+=2;
+        else
+            *moves+=3;
+    }
+    else
+        (*moves)++;
+}
+
+static void simCraft(SimGame* g, SimPlayer* myP, int* moves)
+{
+    if (myP->backpack[JUNK] > 0)
+    {
+        const GameTables* t = g->tables;
+
+        if(simRand(&g->rng)%100 + 1 >= t->craft_fail)
+        {
+            int     spread = myP->backpack[JUNK] < 3 ? myP->backpack[JUNK] - 1 : 2;
+            ObjType item   = t->craft_item[spread][t->craft_total[spread] > 1 ? simRand(&g->rng)%t->craft_total[spread] : 0];
+
+            simWeighCraft(g, TRUE);
+            simWeighItem(g, spread, item);
+            // Like in craft(), the crafted item is not counted in obj_count
+            myP->backpack[item]++;
+            myP->obj_count -= myP->backpack[JUNK];
+            myP->backpack[JUNK] = 0;
+        }
+        else
+        {
+            simWeighCraft(g, FALSE);
+            myP->backpack[JUNK]--;
+            myP->obj_count--;
+        }
+    }
+    else
+        (*moves)++;
+}
+
+static ObjType simChooseItem(SimGame* g, const SimPolicy* policy, int player)
+{
+    unsigned short* backpack = g->p[player].backpack;
+
+    if((backpack[GASOLINE]>0 && backpack[GUN]>0) || (backpack[GASOLINE]>0 && backpack[KNIFE]>0) || (backpack[KNIFE]>0 && backpack[GUN]>0))
+    {
+        ObjType choice = policy->item(g, player, policy->ctx);
+
+        // An item which is not in the backpack can not be chosen from the menu
+        if (choice >= KNIFE && choice <= GASOLINE && backpack[choice] > 0)
+            return choice;
+    }
+
+    if(backpack[GASOLINE] > 0)
+        return GASOLINE;
+    else if(backpack[GUN]      > 0)
+        return GUN;
+    else if(backpack[KNIFE]    > 0)
+        return KNIFE;
+    else
+        return NOTHING;
+}
+
+// ----------------------------------ENGINES------------------------------------
+#define SIM_GENERIC
+#define SIM_VARIANT generic
+#include "sim_engine.inc"
+#undef SIM_GENERIC
+
+#define SIM_VARIANT classic
+#include "sim_engine.inc"
+#define SIM_VARIANT debug
+#include "sim_engine.inc"
+#define SIM_VARIANT easy
+#include "sim_engine.inc"
+#define SIM_VARIANT hard
+#include "sim_engine.inc"
+#define SIM_VARIANT long_road
+#include "sim_engine.inc"
+
+#define SIM_RULES(name, ...) {&sim_rules_##name, simPlay_##name},
+const SimVariant sim_variants[] = {
+#include "sim_rules.def"
+};
+#undef SIM_RULES
+
+const int sim_variants_count = sizeof(sim_variants) / sizeof(sim_variants[0]);
+
+/**
+ * Looks for a specialized engine
+ * @param  name Name of the rule set, as in sim_rules.def
+ * @return      The engine, NULL if there's no rule set with that name
+ */
+const SimVariant* simFindVariant(const char* name)
+{
+    for (int i = 0; i < sim_variants_count; i++)
+        if (strcmp(sim_variants[i].rules->name, name) == 0)
+            return &sim_variants[i];
+    return NULL;
+}
+
+/**
+ * Plays a game with the rules of gamelib.c, taking the size of the backpack from the tables in use
+ * (see simPlay_generic for the parameters)
+ */
+void simPlay(const SimMap* map, const SimPolicy* policy, uint64_t seed, SimResult* res)
+{
+    const GameTables* t = tablesCurrent();
+
+    if (t->backpack_size == sim_rules_classic.backpack_size)
+        simPlay_classic(NULL, map, policy, seed, res);
+    else
+    {
+        SimRules rules = sim_rules_classic;
+        rules.backpack_size = t->backpack_size;
+        simPlay_generic(&rules, map, policy, seed, res);
+    }
+}
+
+/**
+ * Plays a game with rules known only at run time, with the generic engine
+ * (see simPlay_generic for the parameters)
+ */
+void simPlayRules(const SimRules* rules, const SimMap* map, const SimPolicy* policy, uint64_t seed, SimResult* res)
+{
+    simPlay_generic(rules, map, policy, seed, res);
+}
+
+// -----------------------------------RUNS--------------------------------------
+/**
+ * Plays a range of games, each one with its own stream derived from the seed
+ * @param variant The engine to use, NULL for simPlay
+ * @param map     The map of the games
+ * @param policy  The policy of the players
+ * @param seed    Seed of the run
+ * @param first   Index of the first game, so that a run can be continued in more calls
+ * @param count   Number of games to play
+ * @param stats   The counters which will be incremented
+ */
+void simRun(const SimVariant* variant, const SimMap* map, const SimPolicy* policy, uint64_t seed, uint64_t first, uint64_t count, SimStats* stats)
+{
+    SimResult res;
+
+    for (uint64_t i = first; i < first + count; i++)
+    {
+        if (variant == NULL)
+            simPlay(map, policy, simGameSeed(seed, i), &res);
+        else
+            variant->play(variant->rules, map, policy, simGameSeed(seed, i), &res);
+
+        int escaped = res.escaped[0] + res.escaped[1];
+        stats->games++;
+        stats->both += escaped == 2;
+        stats->one  += escaped == 1;
+        stats->none += escaped == 0;
+    }
+}
+
+/**
+ * Writes the map in the format of GameSave.save, with the players at the start,
+ * so that it can be played with "Carica Partita"
+ * @param map  The map to write. The random objects are drawn with the given seed
+ * @param seed Seed used for the random objects
+ * @param fptr The file where the map will be written
+ */
+void simWriteSave(const SimMap* map, uint64_t seed, FILE* fptr)
+{
+    SimRng            rng = {seed};
+    const GameTables* t   = tablesCurrent();
+
+    fprintf(fptr, "LINKED LIST:\n");
+    for (int i = 0; i < map->zones; i++)
+    {
+        int object = map->object[i] == SIM_RANDOM_OBJ ? simRandomObj(&rng, t, map->type[i]) : map->object[i];
+        fprintf(fptr, "%d-%d%c", map->type[i], object, i + 1 < map->zones ? ',' : '#');
+    }
+
+    fprintf(fptr, "\nPLAYERS:\n");
+    for (int p = 0; p < 2; p++)
+        fprintf(fptr, "P%d-%d-%4d-|%4d-%4d-%4d-%4d-%4d-%4d|-%4d-%d\n", p + 1, ALIVE, 1,
+                t->start[p][0], t->start[p][1], t->start[p][2], t->start[p][3], t->start[p][4], t->start[p][5],
+                t->start_count[p], FALSE);
+    fprintf(fptr, "GAME VARIABLES:\n");
+    fprintf(fptr, "%d, %d", 0, 0);
+}
+
+// ----------------------------------POLICIES-----------------------------------
+/**
+ * Heals when injured, searches every zone, takes what it finds, crafts as soon as it has junk and then advances
+ */
+static SimAction defaultAction(const SimGame* g, int player, int moves, void* ctx)
+{
+    const SimPlayer* myP = &g->p[player];
+    (void)moves;
+    (void)ctx;
+
+    if (myP->state == INJURED && myP->backpack[BANDAGE] > 0)
+        return SIM_HEAL;
+    if (!myP->searched)
+        return SIM_RUMMAGE;
+    if (g->object[myP->pos] != NOTHING && myP->obj_count <= g->rules->backpack_size)
+        return SIM_TAKE;
+    if (myP->backpack[JUNK] > 0)
+        return SIM_CRAFT;
+    return SIM_ADVANCE;
+}
+
+/**
+ * Gasoline first, then the gun, then the knife unless it would be fatal
+ */
+static ObjType defaultItem(const SimGame* g, int player, void* ctx)
+{
+    const unsigned short* backpack = g->p[player].backpack;
+    (void)ctx;
+
+    if (backpack[GASOLINE] > 0)
+        return GASOLINE;
+    if (backpack[GUN] > 0)
+        return GUN;
+    return KNIFE;
+}
+
+const SimPolicy sim_policy_default = {"default", defaultAction, defaultItem, NULL, NULL};
+
+/**
+ * Any action, at random: the games end in ways the default policy never reaches
+ */
+static SimAction randomAction(const SimGame* g, int player, int moves, void* ctx)
+{
+    (void)g;
+    (void)player;
+    (void)moves;
+    return 1 + simRand((SimRng*)ctx) % 6;
+}
+
+static ObjType randomItem(const SimGame* g, int player, void* ctx)
+{
+    (void)g;
+    (void)player;
+    return KNIFE + simRand((SimRng*)ctx) % 3;
+}
+
+const SimPolicy sim_policy_random = {"random", randomAction, randomItem, NULL, NULL};
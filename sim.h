@@ -0,0 +1,179 @@
+/******************************************************************************/
+/*!
+ * @file   sim.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Header file of sim.c
+ *
+ * Headless engine: it plays the same rules of gamelib.c without any input/output,
+ * asking the choices of the players to a policy and drawing the random numbers
+ * from a seeded generator, so that every game can be reproduced from its seed.
+ *
+ * The constants of a rule set (SimRules) are folded into a specialized copy of the engine,
+ * one for each entry of sim_rules.def, which can be picked by name with simFindVariant.
+ */
+/******************************************************************************/
+
+#ifndef SIM_H_INCLUDED
+#define SIM_H_INCLUDED
+
+#include <stdint.h>
+#include "gamelib.h"
+#include "tables.h"
+
+#define SIM_MAX_ZONES  1024
+#define SIM_MAX_TURNS  100000 /**<A game still running after these turns is stopped as unfinished */
+#define SIM_OUT        -1     /**<Position of a player who left the map, escaping or dying */
+#define SIM_RANDOM_OBJ 0xFF   /**<Object of a zone drawn at the start of every game */
+
+// The actions follow the order of the menu of doTurn
+typedef enum {SIM_ADVANCE = 1, SIM_RUMMAGE, SIM_TAKE, SIM_HEAL, SIM_ADRENALINE, SIM_CRAFT} SimAction;
+
+// Events passed to the observer of a policy
+typedef enum {
+    SIM_EV_GIESON, /**<Gieson appeared: the state is the one before the encounter, item is the one used against him */
+    SIM_EV_LEFT    /**<The player left the map, escaping or dying: the state is the one at the end of the action */
+} SimEvent;
+
+typedef struct {
+    uint64_t state;
+} SimRng;
+
+typedef struct {
+    int     zones;                  /**<Number of zones, exit included */
+    uint8_t type  [SIM_MAX_ZONES];  /**<TypeZone of each zone, the last one is EXIT_CAMPING */
+    uint8_t object[SIM_MAX_ZONES];  /**<ObjType of each zone, or SIM_RANDOM_OBJ */
+} SimMap;
+
+typedef struct {
+    PlayerState    state;
+    int            pos;             /**<Index of the zone, SIM_OUT when out of the map */
+    unsigned short backpack[6];
+    int            obj_count;
+    unsigned char  searched;
+} SimPlayer;
+
+// Random draws of a game by outcome, to adapt a proposal of importance sampling (see SimRules.nominal)
+typedef struct {
+    uint16_t spawn [6][6];          /**<Objects drawn, by TypeZone and ObjType */
+    uint16_t appear[ENC_KEYS][2];   /**<Arrivals of Gieson by key: [1] when he appeared */
+    uint16_t craft [2];             /**<Crafts: [1] when they succeeded */
+    uint16_t item  [3][3];          /**<Items crafted (KNIFE, GUN, GASOLINE) with 1, 2, 3 or more junk */
+} SimDraws;
+
+// Constants of a rule set, the ones gamelib.c fixes with the preprocessor
+typedef struct SimRules {
+    const char*   name;
+    int           min_lands;        /**<Minimum number of zones of a map, exit excluded (MAX_LANDS) */
+    int           backpack_size;    /**<BACKPACK_SIZE */
+    unsigned int  gieson_exit;      /**<Odds (%) of Gieson for a player out of the map, while both are alive */
+    unsigned int  gieson_dead;      /**<Odds (%) of Gieson when one of the players is dead */
+    unsigned int  gieson_base;      /**<Odds (%) of Gieson otherwise */
+    unsigned int  gasoline_turns;   /**<Turns without Gieson after the gasoline */
+    unsigned char debug_start;      /**<Initial backpacks of -D DEBUG instead of the ones of the tables */
+    EncounterTable encounter;       /**<Built from the odds above with ENCOUNTER_TABLE */
+    const GameTables* tables;       /**<Tables of the rules, NULL for the ones in use (tablesCurrent) */
+    const struct SimRules* nominal; /**<Importance sampling: these rules are a proposal (their tables and odds of Gieson)
+                                         for the nominal ones, and the generic engine weights every game. NULL otherwise */
+} SimRules;
+
+typedef struct {
+    const GameTables* tables;       /**<Tables of the rules, taken when the game starts */
+    const SimRules*   rules;
+    SimPlayer      p[2];            /**<p[0] is Giacomo (P1), p[1] is Marzia (P2) */
+    unsigned int   gasoline_turns;
+    unsigned int   turn_check;
+    unsigned int   turns;
+    int            zones;
+    const uint8_t* type;
+    uint8_t        object[SIM_MAX_ZONES];
+    SimRng         rng;
+    const SimRules*   nominal;      /**<See SimRules.nominal */
+    const GameTables* nominal_tables;
+    double         weight;          /**<Likelihood ratio of the draws so far, nominal over proposal */
+    SimDraws*      draws;
+} SimGame;
+
+// A policy takes the decisions of the players. Both callbacks receive the player index (0 or 1)
+typedef struct {
+    const char* name;
+    SimAction (*action)(const SimGame*, int player, int moves, void* ctx);
+    ObjType   (*item)  (const SimGame*, int player, void* ctx); /**<Called only when chooseItem would ask */
+    void*       ctx;
+    void      (*event) (const SimGame*, int player, SimEvent, ObjType item, void* ctx); /**<Optional observer, NULL for none */
+} SimPolicy;
+
+typedef struct {
+    PlayerState  state  [2];
+    unsigned char escaped[2];
+    unsigned int turns;
+    unsigned char finished;
+    double       weight;            /**<Likelihood ratio of the game, see SimRules.nominal: 1 without it */
+    SimDraws     draws;             /**<The draws of the game, filled only with SimRules.nominal */
+} SimResult;
+
+typedef struct {
+    uint64_t games;
+    uint64_t both;   /**<Games where both players escaped */
+    uint64_t one;    /**<Games where exactly one player escaped */
+    uint64_t none;   /**<Games where nobody escaped */
+} SimStats;
+
+// An instance of the engine: the specialized ones ignore the first argument of play
+typedef void (*SimPlayFn)(const SimRules*, const SimMap*, const SimPolicy*, uint64_t, SimResult*);
+
+typedef struct {
+    const SimRules* rules;
+    SimPlayFn       play;
+} SimVariant;
+
+/**
+ * splitmix64: a fast generator whose streams are independent for different seeds
+ */
+static inline uint64_t simRngNext(SimRng* rng)
+{
+    uint64_t z = (rng->state += 0x9e3779b97f4a7c15u);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Drop-in replacement of rand(), returning a value between 0 and 2^31-1
+ */
+static inline int simRand(SimRng* rng)
+{
+    return (int)(simRngNext(rng) >> 33);
+}
+
+/**
+ * Seed of the i-th game of a run, so that every game has its own stream
+ */
+static inline uint64_t simGameSeed(uint64_t seed, uint64_t i)
+{
+    SimRng rng = {seed ^ (i * 0xd1b54a32d192ed03u)};
+    return simRngNext(&rng);
+}
+
+/**
+ * Seed of the stream of a policy which draws its choices (see sim_policy_random), apart from the one of the game
+ */
+static inline uint64_t simPolicySeed(uint64_t game_seed)
+{
+    return game_seed ^ 0x5851f42d4c957f2du;
+}
+
+extern const SimPolicy  sim_policy_default;
+extern const SimPolicy  sim_policy_random;  /**<Its ctx has to start with a SimRng, seeded with simPolicySeed for every game */
+extern const SimVariant sim_variants[];
+extern const int        sim_variants_count;
+
+void              simMapInit     (SimMap*, const TypeZone*, int);
+ObjType           simRandomObj   (SimRng*, const GameTables*, TypeZone);
+const SimVariant* simFindVariant (const char*);
+void              simPlay        (const SimMap*, const SimPolicy*, uint64_t, SimResult*);
+void              simPlayRules   (const SimRules*, const SimMap*, const SimPolicy*, uint64_t, SimResult*);
+void              simRun         (const SimVariant*, const SimMap*, const SimPolicy*, uint64_t, uint64_t, uint64_t, SimStats*);
+void              simWriteSave   (const SimMap*, uint64_t, FILE*);
+
+#endif
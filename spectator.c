@@ -0,0 +1,255 @@
+/******************************************************************************/
+/*!
+ * @file   spectator.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Seqlock over a shared memory region, publishing the live state of a game
+ *
+ * The game is the only writer: it makes the sequence number odd, writes the state in place
+ * and makes the number even again, with only plain stores and fences. A reader copies the
+ * state between two loads of the number and keeps the copy only if the number was even
+ * and did not change, so a snapshot is never half old and half new.
+ * A game which dies without closing its region never marks it as ended: the readers check its
+ * process, so they stop waiting on a region nobody will write anymore.
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gamelib.h"
+#include "spectator.h"
+
+// ------------------------------------READER-----------------------------------
+/**
+ * Maps the region of a session, read only
+ * @param  session The key of the session
+ * @return         The region, NULL if there is no game for that session or the region is not valid
+ */
+const SpectatorRegion* spectatorAttach(const char* session)
+{
+    char        name[64];
+    struct stat st;
+
+    snprintf(name, sizeof(name), "%s%s", SPECTATOR_PREFIX, session);
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SpectatorRegion))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    const SpectatorRegion* region = mmap(NULL, sizeof(SpectatorRegion), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED)
+        return NULL;
+    if (memcmp(region->magic, SPECTATOR_MAGIC, 4) != 0 || region->version != SPECTATOR_VERSION ||
+        region->size != sizeof(SpectatorRegion))
+    {
+        munmap((void*)region, sizeof(SpectatorRegion));
+        return NULL;
+    }
+    return region;
+}
+
+/**
+ * Tells if the process of the game is still running
+ */
+static int gameAlive(const SpectatorRegion* region)
+{
+    return kill((pid_t)region->pid, 0) == 0 || errno != ESRCH;
+}
+
+/**
+ * Copies a consistent snapshot of the state, retrying while the game is writing it.
+ * After SPECTATOR_SPIN retries the reader yields the CPU to the game, which may be waiting for it
+ * @param  region The region of the session
+ * @param  out    Where the state will be copied
+ * @return        The sequence number of the snapshot: a spectator redraws only when it changes.
+ *                If the game has died the snapshot is marked as ended, and when it died in the
+ *                middle of a write the number is odd and the state may be half written
+ */
+uint32_t spectatorRead(const SpectatorRegion* region, SpectatorState* out)
+{
+    _Atomic uint32_t* seq = (_Atomic uint32_t*)&region->seq;
+
+    for (unsigned tries = 1; ; tries++)
+    {
+        uint32_t before = atomic_load_explicit(seq, memory_order_acquire);
+
+        memcpy(out, (const void*)&region->state, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        if (!(before & 1) && atomic_load_explicit(seq, memory_order_relaxed) == before)
+        {
+            if (!out->ended && !gameAlive(region))
+                out->ended = TRUE;
+            return before;
+        }
+        if (tries % SPECTATOR_SPIN == 0) // The game is in the middle of a write, or has died there
+        {
+            if (!gameAlive(region))
+            {
+                out->ended = TRUE;
+                return before;
+            }
+            sched_yield();
+        }
+    }
+}
+
+void spectatorDetach(const SpectatorRegion* region)
+{
+    if (region != NULL)
+        munmap((void*)region, sizeof(SpectatorRegion));
+}
+
+// -----------------------------------RENDERING---------------------------------
+static const char* tags_state[3] = {"Morto", "Ferito", "Vivo"};
+static const char* tags_zone [6] = {"Cucina", "Soggiorno", "Rimessa", "Strada", "Lungo lago", "Uscita campeggio"};
+static const char* tags_obj  [7] = {"Cianfrusaglia", "Bende", "Coltello", "Pistola", "Benzina", "Adrenalina", "Nessuno"};
+static const char* tags_name [2] = {"Giacomo", "Marzia"};
+
+/**
+ * Renders a snapshot as text: the inventory of the player of the turn, as in doTurn,
+ * then the map as in printMap, with the players next to their zones
+ * @param  session The key of the session, for the title
+ * @param  s       The snapshot
+ * @param  buf     Where the text will be written
+ * @param  size    Size of buf, SPECTATOR_FRAME_MAX is always enough
+ * @return         The length of the text
+ */
+size_t spectatorRender(const char* session, const SpectatorState* s, char* buf, size_t size)
+{
+    size_t len = 0;
+
+    #define OUT(...) (len += len < size ? (size_t)snprintf(buf + len, size - len, __VA_ARGS__) : 0)
+    OUT("Sessione %s - Turno %u%s\n\n", session, s->turn, s->ended ? " - Partita terminata" : "");
+
+    const SpectatorPlayer* myP = &s->player[s->playing == 1 ? 0 : 1];
+    char gas_info[50] = " ";
+    if (s->gasoline_turns)
+        snprintf(gas_info, sizeof(gas_info), "Turni rimanenti al sicuro da Gieson: %d", s->gasoline_turns);
+
+    OUT("─────────────────────┤ I N V E N T A R I O ├─────────────────────────────┐      \n"
+        " Turno di %-10s │ Cianfrusaglia = %-2d    Bende = %-2d    Coltello = %-2d │     \n"
+        "─────────────────────┤       Pistola = %-2d  Benzina = %-2d  Adrenalina = %-2d │\n"
+        " STATO: %-10s   ├───────────────────────────────────────────────────┘           \n"
+        " MOSSE RIMANENTI: %-2d │ %s\n"
+        "─────────────────────┘                                                          \n",
+        tags_name[s->playing == 1 ? 0 : 1], myP->backpack[0], myP->backpack[1], myP->backpack[2],
+        myP->backpack[3], myP->backpack[4], myP->backpack[5],
+        tags_state[myP->state < 3 ? myP->state : 0], s->moves, gas_info);
+
+    const SpectatorPlayer* other = &s->player[s->playing == 1 ? 1 : 0];
+    OUT("%s: %s\n", tags_name[s->playing == 1 ? 1 : 0], other->pos == 0 ? "fuori dalla mappa" : tags_state[other->state < 3 ? other->state : 0]);
+
+    OUT("\nINIZIO-----------------------------------------------\n");
+    for (int i = 0; i < s->zones && i < SPECTATOR_MAX_ZONES; i++)
+    {
+        OUT("%-2d-> TIPO: %-16s | OGGETTO: %-13s", i + 1, tags_zone[s->type[i] < 6 ? s->type[i] : 0],
+            tags_obj[s->object[i] < 7 ? s->object[i] : 6]);
+        for (int p = 0; p < 2; p++)
+            if (s->player[p].pos == i + 1)
+                OUT(" <- %s", tags_name[p]);
+        OUT("\n");
+    }
+    OUT("FINE-------------------------------------------------\n");
+    #undef OUT
+
+    return len < size ? len : size - 1;
+}
+
+// -----------------------------------PUBLISHER---------------------------------
+#ifdef SPECTATOR
+static SpectatorRegion* region = NULL;
+static char             region_name[64];
+
+/**
+ * Creates the region of a session, replacing the one of a previous game with the same key
+ * @param  session The key of the session
+ * @return         TRUE on success. On failure the game goes on without spectators
+ */
+int spectatorOpen(const char* session)
+{
+    spectatorClose();
+    snprintf(region_name, sizeof(region_name), "%s%s", SPECTATOR_PREFIX, session);
+
+    shm_unlink(region_name); // A region left by a crashed game: its spectators keep the old one
+    int fd = shm_open(region_name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+        return FALSE;
+    if (ftruncate(fd, sizeof(SpectatorRegion)) != 0)
+    {
+        close(fd);
+        shm_unlink(region_name);
+        return FALSE;
+    }
+
+    region = mmap(NULL, sizeof(SpectatorRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED)
+    {
+        region = NULL;
+        shm_unlink(region_name);
+        return FALSE;
+    }
+
+    // The header goes last, a spectator attaching earlier refuses the region
+    atomic_store_explicit(&region->seq, 0, memory_order_relaxed);
+    region->pid     = getpid();
+    region->version = SPECTATOR_VERSION;
+    region->size    = sizeof(SpectatorRegion);
+    snprintf(region->session, sizeof(region->session), "%s", session);
+    atomic_thread_fence(memory_order_release);
+    memcpy(region->magic, SPECTATOR_MAGIC, 4);
+    return TRUE;
+}
+
+/**
+ * Starts writing the state: the spectators reading it from now on will retry
+ * @return The state to fill, NULL if there is no region
+ */
+SpectatorState* spectatorBegin()
+{
+    if (region == NULL)
+        return NULL;
+
+    uint32_t seq = atomic_load_explicit(&region->seq, memory_order_relaxed);
+    atomic_store_explicit(&region->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release); // The writes of the state can not move before the odd number
+    return &region->state;
+}
+
+/**
+ * Ends the write started by spectatorBegin, publishing the new state
+ */
+void spectatorEnd()
+{
+    uint32_t seq = atomic_load_explicit(&region->seq, memory_order_relaxed);
+    atomic_store_explicit(&region->seq, seq + 1, memory_order_release);
+}
+
+/**
+ * Marks the game as ended and removes the region. The spectators which mapped it keep reading its last state
+ */
+void spectatorClose()
+{
+    if (region == NULL)
+        return;
+    if (!region->state.ended) // The game has been closed before its end, e.g. at the end of the input
+    {
+        spectatorBegin()->ended = TRUE;
+        spectatorEnd();
+    }
+    munmap(region, sizeof(SpectatorRegion));
+    shm_unlink(region_name);
+    region = NULL;
+}
+#endif
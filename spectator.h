@@ -0,0 +1,82 @@
+/******************************************************************************/
+/*!
+ * @file   spectator.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Header file of spectator.c
+ *
+ * Live state of a game in shared memory, for the spectators on the same machine.
+ * Every session publishes its state into the region "/gieson-SESSION" (see shm_open),
+ * protected by a seqlock: the game never waits for the spectators and never makes a
+ * syscall to publish, and any number of spectators read consistent snapshots by retrying
+ * when the sequence number changed during their copy. The game marks its state as ended when it
+ * is closed, and the readers mark it themselves when the process of the game (pid) has died.
+ * The publisher is compiled only when the SPECTATOR macro is defined (gcc -D SPECTATOR ...),
+ * the readers are always available.
+ *
+ * Layout of the region:
+ *   header: "GSPC", uint16 version, uint16 size of the region, uint32 sequence number,
+ *           int32 pid of the game, the session key
+ *   then the state (SpectatorState). The sequence number is odd while the state is being written
+ */
+/******************************************************************************/
+
+#ifndef SPECTATOR_H_INCLUDED
+#define SPECTATOR_H_INCLUDED
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SPECTATOR_PREFIX    "/gieson-"
+#define SPECTATOR_MAGIC     "GSPC"
+#define SPECTATOR_VERSION   1
+#define SPECTATOR_MAX_ZONES 255
+#define SPECTATOR_FRAME_MAX (1024 + SPECTATOR_MAX_ZONES * 64) /**<Longest text of spectatorRender */
+#define SPECTATOR_SPIN      1000                             /**<Retries of spectatorRead before it yields and checks the game */
+
+typedef struct {
+    uint8_t  state;              /**<PlayerState */
+    uint8_t  pos;                /**<ID of the zone, 0 when out of the map */
+    uint8_t  searched;
+    uint8_t  reserved;
+    int32_t  obj_count;
+    uint16_t backpack[6];
+} SpectatorPlayer;
+
+typedef struct {
+    uint32_t        turn;
+    uint8_t         playing;     /**<1 for Giacomo, 2 for Marzia */
+    uint8_t         moves;       /**<Moves left to the player of the turn */
+    uint8_t         gasoline_turns;
+    uint8_t         ended;       /**<TRUE when the game is over, the region is about to be removed */
+    uint16_t        zones;
+    uint16_t        reserved;
+    SpectatorPlayer player[2];
+    uint8_t         type  [SPECTATOR_MAX_ZONES]; /**<By ID - 1 */
+    uint8_t         object[SPECTATOR_MAX_ZONES];
+} SpectatorState;
+
+typedef struct {
+    char             magic[4];
+    uint16_t         version;
+    uint16_t         size;
+    _Atomic uint32_t seq;
+    int32_t          pid;
+    char             session[32];
+    SpectatorState   state;
+} SpectatorRegion;
+
+const SpectatorRegion* spectatorAttach(const char*);
+uint32_t               spectatorRead  (const SpectatorRegion*, SpectatorState*);
+void                   spectatorDetach(const SpectatorRegion*);
+size_t                 spectatorRender(const char*, const SpectatorState*, char*, size_t);
+
+#ifdef SPECTATOR
+    int             spectatorOpen (const char*);
+    SpectatorState* spectatorBegin();
+    void            spectatorEnd  ();
+    void            spectatorClose();
+#endif
+
+#endif
@@ -0,0 +1,550 @@
+/******************************************************************************/
+/*!
+ * @file   stats.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Append-only log of the finished games, with the leaderboards kept in memory
+ *
+ * The players are kept in a hash table by key, with their lifetime statistics. Each leaderboard
+ * is a heap of its best STATS_TOP entries whose root is the worst one: a new entry only has to
+ * beat the root, and a player already in a leaderboard knows his position in the heap, so his
+ * entry is updated in place. Both the streaks and the items crafted can only grow, so an
+ * updated entry can only move away from the root.
+ *
+ * The leaderboards are written by the thread recording the games only. After every change
+ * they are published sorted, behind a seqlock like the one of spectator.c, so statsTop never
+ * waits for the writer and can be called from any thread; statsPlayer reads the hash table
+ * and has to be called from the thread recording the games.
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gamelib.h"
+#include "stats.h"
+
+typedef struct {
+    char     magic[4];
+    uint16_t version;
+    uint16_t size;
+    uint32_t reserved[2];
+} StatsHeader;
+
+typedef struct {
+    char        key[SAVE_KEY_LEN];
+    StatsPlayer stats;
+    int         slot[STATS_BOARDS]; /**<Position in the heap of each leaderboard, -1 if out of it */
+} PlayerEntry;
+
+// An entry of a heap: the higher the score, the better
+typedef struct {
+    int64_t  score;
+    uint32_t order;    /**<Index of the game which reached the score: the earlier wins a tie */
+    int32_t  owner;    /**<Index of the player, -1 for the leaderboards of games */
+    int64_t  time;
+    char     key[SAVE_KEY_LEN];
+} HeapEntry;
+
+typedef struct {
+    HeapEntry entry[STATS_TOP];
+    int       n;
+} Heap;
+
+static char         path[512]   = STATS_FILE;
+static int          fd          = -1;
+static off_t        known       = 0;    /**<Bytes of the log already read */
+static uint32_t     games       = 0;
+static uint32_t     damaged     = 0;
+
+static PlayerEntry* players     = NULL;
+static int          n_players   = 0;
+static int          cap_players = 0;
+static int32_t*     table       = NULL; /**<Index of the player + 1, 0 for an empty slot */
+static uint32_t     table_size  = 0;    /**<A power of two, at least twice the players */
+
+static Heap         heaps[STATS_BOARDS];
+
+// The sorted leaderboards, as seen by statsTop
+static struct {
+    _Atomic uint32_t seq;
+    int              n  [STATS_BOARDS];
+    StatsRank        top[STATS_BOARDS][STATS_TOP];
+} published;
+
+/**
+ * FNV-1a hash of n bytes
+ */
+static uint32_t hash(const void* data, size_t n)
+{
+    const unsigned char* p = data;
+    uint32_t             h = 2166136261u;
+
+    for (size_t i = 0; i < n; i++)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+static uint32_t checkOf(const StatsGame* g)
+{
+    return hash(g, offsetof(StatsGame, check));
+}
+
+static void* allocOrDie(void* old, size_t size)
+{
+    void* p = realloc(old, size);
+    if (p == NULL)
+    {
+        fprintf(stderr, "Impossibile allocare la memoria per le statistiche.\n");
+        exit(-1);
+    }
+    return p;
+}
+
+// ------------------------------------PLAYERS----------------------------------
+static void insertSlot(int index)
+{
+    uint32_t i = hash(players[index].key, SAVE_KEY_LEN) & (table_size - 1);
+
+    while (table[i] != 0)
+        i = (i + 1) & (table_size - 1);
+    table[i] = index + 1;
+}
+
+/**
+ * Finds a player by his padded key, adding him if he has never played
+ * @return The index of the player
+ */
+static int findPlayer(const char key[SAVE_KEY_LEN], int add)
+{
+    if (table_size != 0)
+    {
+        uint32_t i = hash(key, SAVE_KEY_LEN) & (table_size - 1);
+
+        for (; table[i] != 0; i = (i + 1) & (table_size - 1))
+            if (memcmp(players[table[i] - 1].key, key, SAVE_KEY_LEN) == 0)
+                return table[i] - 1;
+    }
+    if (!add)
+        return -1;
+
+    if (n_players == cap_players)
+    {
+        cap_players = cap_players == 0 ? 64 : cap_players * 2;
+        players     = allocOrDie(players, cap_players * sizeof(PlayerEntry));
+    }
+    if (2 * (uint32_t)(n_players + 1) > table_size)
+    {
+        free(table);
+        table_size = table_size == 0 ? 128 : table_size * 2;
+        table      = allocOrDie(NULL, table_size * sizeof(int32_t));
+        memset(table, 0, table_size * sizeof(int32_t));
+        for (int p = 0; p < n_players; p++)
+            insertSlot(p);
+    }
+
+    PlayerEntry* pl = &players[n_players];
+    memset(pl, 0, sizeof(*pl));
+    memcpy(pl->key, key, SAVE_KEY_LEN);
+    for (int b = 0; b < STATS_BOARDS; b++)
+        pl->slot[b] = -1;
+    insertSlot(n_players);
+    return n_players++;
+}
+
+// --------------------------------LEADERBOARDS---------------------------------
+static int better(const HeapEntry* a, const HeapEntry* b)
+{
+    return a->score > b->score || (a->score == b->score && a->order < b->order);
+}
+
+static void place(int board, int i, const HeapEntry* e)
+{
+    heaps[board].entry[i] = *e;
+    if (e->owner >= 0)
+        players[e->owner].slot[board] = i;
+}
+
+static void siftUp(int board, int i)
+{
+    Heap*     h = &heaps[board];
+    HeapEntry e = h->entry[i];
+
+    while (i > 0 && better(&h->entry[(i - 1) / 2], &e))
+    {
+        place(board, i, &h->entry[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    place(board, i, &e);
+}
+
+static void siftDown(int board, int i)
+{
+    Heap*     h = &heaps[board];
+    HeapEntry e = h->entry[i];
+
+    while (2 * i + 1 < h->n)
+    {
+        int child = 2 * i + 1;
+        if (child + 1 < h->n && better(&h->entry[child], &h->entry[child + 1]))
+            child++;
+        if (!better(&e, &h->entry[child]))
+            break;
+        place(board, i, &h->entry[child]);
+        i = child;
+    }
+    place(board, i, &e);
+}
+
+/**
+ * Offers an entry to a leaderboard. The entry of a player already in it is replaced
+ */
+static void offer(int board, const HeapEntry* e)
+{
+    Heap* h = &heaps[board];
+
+    if (e->owner >= 0 && players[e->owner].slot[board] >= 0)
+    {
+        int i = players[e->owner].slot[board];
+        place(board, i, e);
+        siftDown(board, i);
+    }
+    else if (h->n < STATS_TOP)
+    {
+        h->n++;
+        place(board, h->n - 1, e);
+        siftUp(board, h->n - 1);
+    }
+    else if (better(e, &h->entry[0]))
+    {
+        if (h->entry[0].owner >= 0)
+            players[h->entry[0].owner].slot[board] = -1;
+        place(board, 0, e);
+        siftDown(board, 0);
+    }
+}
+
+/**
+ * Adds a game of the log to the statistics of its player and to the leaderboards
+ */
+static void apply(const StatsGame* g)
+{
+    if (g->check != checkOf(g))
+    {
+        damaged++;
+        return;
+    }
+
+    int          p  = findPlayer(g->key, TRUE);
+    StatsPlayer* s  = &players[p].stats;
+    HeapEntry    e  = {0, games++, p, g->time, {0}};
+
+    memcpy(e.key, g->key, SAVE_KEY_LEN);
+    s->games++;
+    s->crafted += g->crafted;
+    if (g->escaped)
+    {
+        s->wins++;
+        s->streak++;
+        if (s->best_turns == 0 || g->turns < s->best_turns)
+            s->best_turns = g->turns;
+        if (s->streak > s->best_streak)
+        {
+            s->best_streak = s->streak;
+            e.score = s->best_streak;
+            offer(STATS_STREAK, &e);
+        }
+
+        HeapEntry fastest = e;
+        fastest.owner = -1;
+        fastest.score = -(int64_t)g->turns;
+        offer(STATS_FASTEST, &fastest);
+    }
+    else
+        s->streak = 0;
+
+    if (g->crafted > 0)
+    {
+        e.score = s->crafted;
+        offer(STATS_CRAFTED, &e);
+    }
+}
+
+static int compareEntries(const void* a, const void* b)
+{
+    return better(a, b) ? -1 : better(b, a);
+}
+
+/**
+ * Publishes the sorted leaderboards to statsTop
+ */
+static void publish()
+{
+    uint32_t seq = atomic_load_explicit(&published.seq, memory_order_relaxed);
+    atomic_store_explicit(&published.seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (int b = 0; b < STATS_BOARDS; b++)
+    {
+        HeapEntry sorted[STATS_TOP];
+
+        memcpy(sorted, heaps[b].entry, heaps[b].n * sizeof(HeapEntry));
+        qsort(sorted, heaps[b].n, sizeof(HeapEntry), compareEntries);
+        for (int i = 0; i < heaps[b].n; i++)
+        {
+            StatsRank* r = &published.top[b][i];
+            memcpy(r->key, sorted[i].key, SAVE_KEY_LEN);
+            r->score = b == STATS_FASTEST ? -sorted[i].score : sorted[i].score;
+            r->time  = sorted[i].time;
+        }
+        published.n[b] = heaps[b].n;
+    }
+    atomic_store_explicit(&published.seq, seq + 2, memory_order_release);
+}
+
+// -------------------------------------LOG-------------------------------------
+/**
+ * Takes or releases the lock of the log, shared by the processes using it
+ * @param type F_RDLCK, F_WRLCK or F_UNLCK
+ */
+static int lockLog(short type)
+{
+    struct flock fl = {0};
+    fl.l_type   = type;
+    fl.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &fl) == -1)
+        if (errno != EINTR)
+            return FALSE;
+    return TRUE;
+}
+
+/**
+ * Size of the log without a game left half written by a crash at its end
+ * @param size Size of the file
+ */
+static off_t wholeSize(off_t size)
+{
+    off_t header = sizeof(StatsHeader);
+
+    if (size < header)
+        return header;
+    return header + (size - header) / (off_t)sizeof(StatsGame) * (off_t)sizeof(StatsGame);
+}
+
+/**
+ * Reads the games appended to the log after the ones already known
+ * @param size Size of the log, a whole number of records (see wholeSize)
+ */
+static int readLog(off_t size)
+{
+    if (size <= known)
+        return TRUE;
+
+    const char* base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+        return FALSE;
+
+    for (off_t off = known; off < size; off += sizeof(StatsGame))
+    {
+        StatsGame g;
+        memcpy(&g, base + off, sizeof(g));
+        apply(&g);
+    }
+    munmap((void*)base, size);
+    known = size;
+    return TRUE;
+}
+
+/**
+ * Opens the log and rebuilds the statistics from it. A missing log is created empty,
+ * a game left half written by a crash is dropped
+ * @param  file The log, NULL for STATS_FILE
+ * @return      TRUE on success
+ */
+int statsOpen(const char* file)
+{
+    StatsHeader header = {STATS_MAGIC, STATS_VERSION, sizeof(StatsGame), {0, 0}};
+    struct stat st;
+    int         ok     = FALSE;
+
+    statsClose();
+    if (file != NULL)
+        snprintf(path, sizeof(path), "%s", file);
+    if ((fd = open(path, O_RDWR | O_CREAT, 0644)) < 0)
+        return FALSE;
+    if (!lockLog(F_WRLCK))
+    {
+        statsClose();
+        return FALSE;
+    }
+
+    if (fstat(fd, &st) == 0)
+    {
+        if (st.st_size == 0)
+            ok = pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+        else
+        {
+            StatsHeader found;
+            ok = st.st_size >= (off_t)sizeof(found) && pread(fd, &found, sizeof(found), 0) == sizeof(found) &&
+                 memcmp(found.magic, STATS_MAGIC, 4) == 0 && found.version == STATS_VERSION &&
+                 found.size == sizeof(StatsGame);
+            if (!ok)
+                fprintf(stderr, "%s: registro delle partite danneggiato.\n", path);
+        }
+    }
+
+    known = sizeof(StatsHeader);
+    if (ok)
+    {
+        off_t whole = wholeSize(st.st_size);
+
+        if (whole != st.st_size && ftruncate(fd, whole) != 0)
+            ok = FALSE;
+        else
+            ok = readLog(whole);
+    }
+    lockLog(F_UNLCK);
+
+    if (!ok)
+    {
+        statsClose();
+        return FALSE;
+    }
+    if (damaged > 0)
+        fprintf(stderr, "%s: %u partite danneggiate ignorate.\n", path, damaged);
+    publish();
+    return TRUE;
+}
+
+/**
+ * Reads the games recorded by the other processes since the last read, opening the log the first time
+ */
+void statsRefresh()
+{
+    struct stat st;
+
+    if (fd < 0)
+    {
+        statsOpen(NULL);
+        return;
+    }
+    if (!lockLog(F_RDLCK))
+        return;
+    if (fstat(fd, &st) == 0)
+        readLog(wholeSize(st.st_size)); // A half game is left to the next writer, which needs the write lock to drop it
+    lockLog(F_UNLCK);
+    publish();
+}
+
+/**
+ * Appends a finished game to the log and to the statistics
+ * @param  key     ID of the player
+ * @param  turns   Turns of the game
+ * @param  zones   Zones of the map
+ * @param  crafted Items crafted
+ * @param  escaped Players escaped, STATS_GIACOMO | STATS_MARZIA
+ * @return         TRUE if the game has been written
+ */
+int statsRecord(const char* key, uint32_t turns, uint32_t zones, uint16_t crafted, uint8_t escaped)
+{
+    StatsGame   g = {{0}, (int64_t)time(NULL), turns, zones, crafted, escaped, {0}, 0};
+    struct stat st;
+    off_t       whole = 0;
+    int         ok;
+
+    if (fd < 0 && !statsOpen(NULL))
+        return FALSE;
+
+    strncpy(g.key, key, SAVE_KEY_LEN - 1);
+    g.check = checkOf(&g);
+
+    if (!lockLog(F_WRLCK))
+        return FALSE;
+    ok = fstat(fd, &st) == 0;
+    if (ok && (whole = wholeSize(st.st_size)) != st.st_size && ftruncate(fd, whole) != 0)
+    {
+        ok = FALSE; // Half a game left by a crash: the new one would be appended misaligned after it
+        fprintf(stderr, "%s: impossibile rimuovere la partita incompleta dal registro.\n", path);
+    }
+    ok = ok && readLog(whole);
+    if (ok && pwrite(fd, &g, sizeof(g), whole) != sizeof(g))
+    {
+        ok = FALSE;
+        if (ftruncate(fd, whole) != 0) // Never leave half a game, which would shift the next ones
+            fprintf(stderr, "%s: impossibile ripristinare il registro delle partite.\n", path);
+    }
+    if (ok)
+    {
+        apply(&g);
+        known = whole + sizeof(g);
+    }
+    lockLog(F_UNLCK);
+
+    publish();
+    return ok;
+}
+
+/**
+ * Copies a leaderboard, best first, without waiting for the thread recording the games
+ * @param  board The leaderboard
+ * @param  out   Where the entries will be written
+ * @param  max   Size of out
+ * @return       The entries written
+ */
+int statsTop(StatsBoard board, StatsRank* out, int max)
+{
+    while (TRUE)
+    {
+        uint32_t before = atomic_load_explicit(&published.seq, memory_order_acquire);
+        if (before & 1)
+            continue; // The leaderboards are being published
+
+        int n = published.n[board] < max ? published.n[board] : max;
+        memcpy(out, published.top[board], n * sizeof(StatsRank));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&published.seq, memory_order_relaxed) == before)
+            return n;
+    }
+}
+
+/**
+ * @param  key   ID of the player
+ * @param  stats Where his statistics will be written
+ * @return       FALSE if the player has never finished a game
+ */
+int statsPlayer(const char* key, StatsPlayer* stats)
+{
+    char padded[SAVE_KEY_LEN] = {0};
+    int  p;
+
+    strncpy(padded, key, SAVE_KEY_LEN - 1);
+    if ((p = findPlayer(padded, FALSE)) < 0)
+        return FALSE;
+    *stats = players[p].stats;
+    return TRUE;
+}
+
+/**
+ * Closes the log and forgets the statistics
+ */
+void statsClose()
+{
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+
+    free(players);
+    free(table);
+    players    = NULL;
+    table      = NULL;
+    n_players  = cap_players = 0;
+    table_size = 0;
+    games      = damaged = 0;
+    known      = 0;
+    memset(heaps, 0, sizeof(heaps));
+}
@@ -0,0 +1,79 @@
+/******************************************************************************/
+/*!
+ * @file   stats.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Header file of stats.c
+ *
+ * Store of the finished games, from which the leaderboards and the lifetime statistics of
+ * every player are computed. Every game is appended to STATS_FILE as a fixed-size record:
+ *
+ *   header  "GSTA", uint16 version, uint16 size of a record, uint32 reserved, uint32 reserved
+ *   records StatsGame, in the order in which the games ended
+ *
+ * The log is never rewritten: at startup it is read through mmap and the indexes are rebuilt
+ * from it. Each leaderboard keeps only its best STATS_TOP entries, in a heap, so recording a
+ * game costs O(log STATS_TOP) for each leaderboard. The processes sharing the log append
+ * under a lock, reading first the games appended by the others.
+ */
+/******************************************************************************/
+
+#ifndef STATS_H_INCLUDED
+#define STATS_H_INCLUDED
+
+#include <stdint.h>
+
+#include "savestore.h"
+
+#define STATS_FILE    "GameStats.log"
+#define STATS_MAGIC   "GSTA"
+#define STATS_VERSION 1
+#define STATS_TOP     10
+
+#define STATS_GIACOMO 1 /**<Bits of StatsGame.escaped */
+#define STATS_MARZIA  2
+
+typedef enum {
+    STATS_FASTEST,  /**<Games with at least one escape, by fewest turns */
+    STATS_STREAK,   /**<Players, by longest streak of won games */
+    STATS_CRAFTED,  /**<Players, by items crafted in all their games */
+    STATS_BOARDS
+} StatsBoard;
+
+// A finished game, as written in the log
+typedef struct {
+    char     key[SAVE_KEY_LEN]; /**<ID of the player, padded with '\0' */
+    int64_t  time;              /**<End of the game */
+    uint32_t turns;
+    uint32_t zones;             /**<Zones of the map, the exit included */
+    uint16_t crafted;           /**<Items crafted, failures excluded */
+    uint8_t  escaped;           /**<STATS_GIACOMO | STATS_MARZIA, 0 for a lost game */
+    uint8_t  reserved[9];
+    uint32_t check;             /**<Hash of the fields above, to skip a damaged record */
+} StatsGame;
+
+// An entry of a leaderboard
+typedef struct {
+    char     key[SAVE_KEY_LEN];
+    int64_t  score;             /**<Turns for STATS_FASTEST, otherwise the streak or the items */
+    int64_t  time;              /**<When the score has been reached */
+} StatsRank;
+
+// The lifetime statistics of a player
+typedef struct {
+    uint32_t games;
+    uint32_t wins;
+    uint32_t streak;            /**<Games won since the last lost one */
+    uint32_t best_streak;
+    uint32_t crafted;
+    uint32_t best_turns;        /**<Fewest turns of a won game, 0 if none */
+} StatsPlayer;
+
+int  statsOpen   (const char*);
+int  statsRecord (const char*, uint32_t, uint32_t, uint16_t, uint8_t);
+void statsRefresh();
+int  statsTop    (StatsBoard, StatsRank*, int);
+int  statsPlayer (const char*, StatsPlayer*);
+void statsClose  ();
+
+#endif
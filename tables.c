@@ -0,0 +1,379 @@
+/******************************************************************************/
+/*!
+ * @file   tables.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Tables of the rules, shared by the game and by the headless engine
+ *
+ * The tables in use are published through an atomic pointer: a reload builds and validates
+ * a new copy aside and then swaps it in, so a game running in another thread keeps playing
+ * and simply sees the new values from its next lookup. A reader may still hold the copy
+ * replaced, so it is retired instead of freed: the last TABLES_RETIRED copies are kept and
+ * only the oldest one is freed at each reload. The readers fetch the tables again at every
+ * turn or simulated game; one which keeps them longer copies them by value (see preview.c).
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <signal.h>
+
+#include "gamelib.h"
+#include "tables.h"
+
+static const GameTables default_tables = {
+    .object_prop = {
+        {30,20,40, 0, 0,10},
+        {20,10,10,30, 0,30},
+        {20,10,30, 0,30,10},
+        {80, 0,10, 0,10, 0},
+        {70, 0,10, 0,20, 0},
+        {90, 0,10, 0, 0, 0}
+    },
+    .backpack_size = BACKPACK_SIZE,
+    .craft_fail    = 30,
+    .craft_spread  = {
+        {1, 1, 1},
+        {0, 1, 1},
+        {0, 0, 1}
+    },
+    .start = {
+        {0, 0, 1, 0, 0, 0},
+        {0, 0, 0, 0, 0, 2}
+    },
+    .encounter = ENCOUNTER_TABLE(75, 50, 30, 40, 4)
+};
+
+// Without a useful object, and with the knife while injured, the player dies
+#define ENC_DEATH(text) {JUNK, 0, DEAD, TRUE, FALSE, text}
+
+const EncounterOutcome encounter_outcome[7][3] = {
+    [JUNK]       = {ENC_DEATH(ENC_TEXT_NO_ITEM), ENC_DEATH(ENC_TEXT_NO_ITEM), ENC_DEATH(ENC_TEXT_NO_ITEM)},
+    [BANDAGE]    = {ENC_DEATH(ENC_TEXT_NO_ITEM), ENC_DEATH(ENC_TEXT_NO_ITEM), ENC_DEATH(ENC_TEXT_NO_ITEM)},
+    [ADRENALINE] = {ENC_DEATH(ENC_TEXT_NO_ITEM), ENC_DEATH(ENC_TEXT_NO_ITEM), ENC_DEATH(ENC_TEXT_NO_ITEM)},
+    [NOTHING]    = {ENC_DEATH(ENC_TEXT_NO_ITEM), ENC_DEATH(ENC_TEXT_NO_ITEM), ENC_DEATH(ENC_TEXT_NO_ITEM)},
+    [KNIFE]      = {
+        [DEAD]    = ENC_DEATH(ENC_TEXT_KNIFE_FATAL),
+        [INJURED] = ENC_DEATH(ENC_TEXT_KNIFE_FATAL),
+        [ALIVE]   = {KNIFE, 1, INJURED, FALSE, FALSE, ENC_TEXT_KNIFE}
+    },
+    [GUN]        = {
+        [DEAD]    = {GUN, 1, DEAD,    FALSE, FALSE, ENC_TEXT_GUN},
+        [INJURED] = {GUN, 1, INJURED, FALSE, FALSE, ENC_TEXT_GUN},
+        [ALIVE]   = {GUN, 1, ALIVE,   FALSE, FALSE, ENC_TEXT_GUN}
+    },
+    [GASOLINE]   = {
+        [DEAD]    = {GASOLINE, 1, DEAD,    FALSE, TRUE, ENC_TEXT_GASOLINE},
+        [INJURED] = {GASOLINE, 1, INJURED, FALSE, TRUE, ENC_TEXT_GASOLINE},
+        [ALIVE]   = {GASOLINE, 1, ALIVE,   FALSE, TRUE, ENC_TEXT_GASOLINE}
+    }
+};
+
+#define TABLES_RETIRED 16 /**<Reloads after which a replaced copy is freed */
+
+static _Atomic(const GameTables*) current       = NULL;
+static volatile sig_atomic_t      reload_needed = 0;
+static _Atomic(const GameTables*) retired[TABLES_RETIRED];
+static atomic_uint                retired_count = 0;
+
+static const char* tags_zone[6] = {"KITCHEN", "LIVING_ROOM", "SHED", "STREET", "ALONG_LAKE", "EXIT_CAMPING"};
+
+// Sections of the file with more rows
+typedef enum {NONE, PROP, SPREAD, START} Section;
+static const char* section_name[4] = {"", "OBJECT_PROP", "CRAFT_SPREAD", "START"};
+static const int   section_rows[4] = {0, 6, 3, 2};
+
+/**
+ * Checks the values of the tables and builds the sampling tables
+ * @param  t    The tables to compile
+ * @param  path Name of the file, used for the error messages
+ * @return      TRUE if the tables are valid
+ */
+int tablesCompile(GameTables* t, const char* path)
+{
+    int valid = TRUE;
+
+    for (int z = 0; z < 6; z++)
+    {
+        int sum = 0;
+        for (int o = 0; o < 6; o++)
+        {
+            if (t->object_prop[z][o] < 0)
+            {
+                fprintf(stderr, "%s: OBJECT_PROP, %s: probabilità negativa.\n", path, tags_zone[z]);
+                valid = FALSE;
+            }
+            sum += t->object_prop[z][o];
+        }
+        if (sum != 100)
+        {
+            fprintf(stderr, "%s: OBJECT_PROP, %s: la somma delle probabilità è %d invece di 100.\n", path, tags_zone[z], sum);
+            valid = FALSE;
+        }
+    }
+
+    if (t->backpack_size < 1)
+    {
+        fprintf(stderr, "%s: BACKPACK_SIZE deve essere almeno 1.\n", path);
+        valid = FALSE;
+    }
+    if (t->craft_fail < 0 || t->craft_fail > 101)
+    {
+        fprintf(stderr, "%s: CRAFT_FAIL deve essere compreso tra 0 e 101.\n", path);
+        valid = FALSE;
+    }
+
+    for (int j = 0; j < 3; j++)
+    {
+        int sum = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            if (t->craft_spread[j][i] < 0)
+                sum = 1000;
+            sum += t->craft_spread[j][i];
+        }
+        if (sum < 1 || sum > 100)
+        {
+            fprintf(stderr, "%s: CRAFT_SPREAD, riga %d: i pesi devono essere positivi e la loro somma compresa tra 1 e 100.\n", path, j + 1);
+            valid = FALSE;
+        }
+    }
+
+    for (int p = 0; p < 2; p++)
+    {
+        t->start_count[p] = 0;
+        for (int o = 0; o < 6; o++)
+            t->start_count[p] += t->start[p][o];
+
+        // A backpack holds up to backpack_size+1 objects, since takeItem only refuses when obj_count > backpack_size
+        if (t->start_count[p] > t->backpack_size + 1)
+        {
+            fprintf(stderr, "%s: START, P%d: %d oggetti non entrano in uno zaino da %d.\n", path, p + 1, t->start_count[p], t->backpack_size);
+            valid = FALSE;
+        }
+    }
+
+    if (!valid)
+        return FALSE;
+
+    // The draw of randomObject is rand()%100+1: each of the 100 values is mapped to its object
+    for (int z = 0; z < 6; z++)
+    {
+        int r = 0;
+        for (int o = 0; o < 6; o++)
+            for (int k = 0; k < t->object_prop[z][o]; k++)
+                t->spawn[z][r++] = o;
+    }
+
+    // With a single possible item no number is drawn, like the default case of craft()
+    for (int j = 0; j < 3; j++)
+    {
+        int r = 0, options = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            options += t->craft_spread[j][i] > 0;
+            for (int k = 0; k < t->craft_spread[j][i]; k++)
+                t->craft_item[j][r++] = KNIFE + i;
+        }
+        t->craft_total[j] = options > 1 ? r : 1;
+        if (options == 1)
+            t->craft_item[j][0] = t->craft_item[j][r - 1];
+    }
+    return TRUE;
+}
+
+/**
+ * Returns the tables in use, compiling the default ones on the first call.
+ * The copy returned can be held across at most TABLES_RETIRED reloads: a reader which keeps
+ * the tables for longer than a turn has to copy them, and can tell a reload by tablesGeneration
+ */
+const GameTables* tablesCurrent()
+{
+    const GameTables* t = atomic_load_explicit(&current, memory_order_acquire);
+
+    if (t == NULL)
+    {
+        GameTables* defaults = (GameTables*)malloc(sizeof(GameTables));
+        if (defaults == NULL)
+        {
+            fprintf(stderr, "\nImpossibile allocare la memoria per le tabelle di gioco.\n");
+            exit(-1);
+        }
+        *defaults = default_tables;
+        tablesCompile(defaults, "default");
+
+        // Another thread may have won the race, in that case its copy is used
+        if (!atomic_compare_exchange_strong(&current, &t, defaults))
+            free(defaults);
+        else
+            t = defaults;
+    }
+    return t;
+}
+
+/**
+ * @return The number of reloads so far, it changes whenever the tables in use are replaced
+ */
+unsigned tablesGeneration()
+{
+    return atomic_load(&retired_count);
+}
+
+/**
+ * Tells whether a line starts with the given label, followed by a blank
+ */
+static int hasLabel(const char* line, const char* label)
+{
+    size_t len = strlen(label);
+
+    line += strspn(line, " \t");
+    return strncmp(line, label, len) == 0 && (line[len] == ' ' || line[len] == '\t');
+}
+
+/**
+ * Reads a row of integers from a line, after its label
+ * @return The number of integers read
+ */
+static int readRow(const char* line, int* row, int n)
+{
+    int read = 0, used;
+
+    while (*line == ' ' || *line == '\t')
+        line++;
+    while (*line && *line != ' ' && *line != '\t') // Skipping the label
+        line++;
+
+    while (read < n && sscanf(line, "%d%n", &row[read], &used) == 1)
+    {
+        line += used;
+        read++;
+    }
+    return read;
+}
+
+/**
+ * Checks that a section has all its rows, when it ends
+ * @param  rows The rows read
+ * @return      FALSE if some rows are missing
+ */
+static int endSection(const char* path, Section section, int rows)
+{
+    if (rows >= section_rows[section])
+        return TRUE;
+    fprintf(stderr, "%s: %s: lette %d righe su %d.\n", path, section_name[section], rows, section_rows[section]);
+    return FALSE;
+}
+
+/**
+ * Loads the tables from a file and, if they are valid, puts them in use.
+ * If the file does not exist the tables in use are kept. A section missing from the file keeps
+ * its default values, but a section has to have all its rows; the rows of OBJECT_PROP have to be
+ * labelled with their type of zone, in order. The tables replaced stay valid for TABLES_RETIRED more reloads
+ * @param  path The file of the tables
+ * @return      TRUE if new tables are in use
+ */
+int tablesReload(const char* path)
+{
+    FILE* fptr = fopen(path, "r");
+    if (fptr == NULL)
+        return FALSE;
+
+    GameTables* t = (GameTables*)malloc(sizeof(GameTables));
+    if (t == NULL)
+    {
+        fclose(fptr);
+        return FALSE;
+    }
+    *t = default_tables;
+
+    Section section = NONE;
+    char    line[256];
+    int  line_num = 0, row = 0, valid = TRUE;
+
+    while (fgets(line, sizeof(line), fptr) != NULL)
+    {
+        line_num++;
+        if (line[0] == '#' || strspn(line, " \t\r\n") == strlen(line))
+            continue;
+
+        int     values[6];
+        Section next   = strncmp(line, "OBJECT_PROP:", 12)  == 0 ? PROP   :
+                         strncmp(line, "CRAFT_SPREAD:", 13) == 0 ? SPREAD :
+                         strncmp(line, "START:", 6)         == 0 ? START  : NONE;
+        int     scalar = next == NONE && (sscanf(line, "BACKPACK_SIZE: %d", &t->backpack_size) == 1 ||
+                                          sscanf(line, "CRAFT_FAIL: %d", &t->craft_fail) == 1);
+
+        if (next != NONE || scalar) // A new section, or a value, ends the current section
+        {
+            valid  &= endSection(path, section, row);
+            section = next, row = 0;
+        }
+        else if (section == PROP && row < 6 && !hasLabel(line, tags_zone[row]))
+        {
+            fprintf(stderr, "%s:%d: OBJECT_PROP: attesa la riga di %s: %s", path, line_num, tags_zone[row], line);
+            valid = FALSE;
+            row++;
+        }
+        else if (section == PROP && row < 6 && readRow(line, values, 6) == 6)
+            memcpy(t->object_prop[row++], values, sizeof(values));
+        else if (section == SPREAD && row < 3 && readRow(line, values, 3) == 3)
+            memcpy(t->craft_spread[row++], values, 3 * sizeof(int));
+        else if (section == START && row < 2 && readRow(line, values, 6) == 6)
+        {
+            for (int o = 0; o < 6; o++)
+                t->start[row][o] = values[o] < 0 ? 0 : values[o];
+            row++;
+        }
+        else
+        {
+            fprintf(stderr, "%s:%d: riga non valida: %s", path, line_num, line);
+            valid = FALSE;
+        }
+    }
+    fclose(fptr);
+    valid &= endSection(path, section, row);
+
+    if (!valid || !tablesCompile(t, path))
+    {
+        fprintf(stderr, "%s: tabelle non caricate, restano in uso le precedenti.\n", path);
+        free(t);
+        return FALSE;
+    }
+
+    tablesCurrent(); // Making sure that the defaults are not compiled after the swap
+    const GameTables* old = atomic_exchange_explicit(&current, t, memory_order_acq_rel);
+
+    // The replaced copy takes the place of the oldest retired one, which no reader uses anymore
+    unsigned slot = atomic_fetch_add(&retired_count, 1) % TABLES_RETIRED;
+    free((void*)atomic_exchange(&retired[slot], old));
+    return TRUE;
+}
+
+static void onSighup(int sig)
+{
+    (void)sig;
+    reload_needed = 1;
+}
+
+/**
+ * Makes the process reload the tables when it receives SIGHUP, at the next call of tablesPoll
+ */
+void tablesWatchSignal()
+{
+    signal(SIGHUP, onSighup);
+}
+
+/**
+ * Reloads the tables if a SIGHUP has been received. It has to be called in a point where the game can wait for the disk
+ * @param path The file of the tables
+ */
+void tablesPoll(const char* path)
+{
+    if (reload_needed)
+    {
+        reload_needed = 0;
+        tablesReload(path);
+    }
+}
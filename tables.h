@@ -0,0 +1,111 @@
+/******************************************************************************/
+/*!
+ * @file   tables.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Header file of tables.c
+ *
+ * Tables of the rules (probabilities of the objects, size of the backpack, odds of the craft,
+ * initial backpacks), loaded from TABLES_FILE at startup and reloadable while the game is running.
+ * If the file is missing the default values below are used.
+ *
+ * Format of the file (lines starting with '#' are comments):
+ *   OBJECT_PROP:                       one row for each type of zone, in order, one column for each object (%)
+ *   KITCHEN      30 20 40  0  0 10
+ *   ...
+ *   BACKPACK_SIZE: 4
+ *   CRAFT_FAIL: 30                     the craft fails when rand()%100+1 is lower than this value
+ *   CRAFT_SPREAD:                      weights of KNIFE, GUN, GASOLINE by number of junk
+ *   1  1 1 1
+ *   2  0 1 1
+ *   3  0 0 1                           (3 or more)
+ *   START:                             initial backpacks, in the order of ObjType
+ *   P1 0 0 1 0 0 0
+ *   P2 0 0 0 0 0 2
+ *
+ * A section missing from the file keeps the default values, a section given has to have all its rows.
+ *
+ * The encounters with Gieson are resolved with two more tables: EncounterTable gives the odds of
+ * his appearance for each state of the game, encounter_outcome what happens for each item used.
+ */
+/******************************************************************************/
+
+#ifndef TABLES_H_INCLUDED
+#define TABLES_H_INCLUDED
+
+#include <stdint.h>
+
+#define TABLES_FILE "GameTables.cfg"
+
+// -----------------------------------ENCOUNTERS--------------------------------
+/**
+ * Key of the state of the game at the arrival of Gieson
+ * @param gasoline Turns left of the gasoline, only 0, 1 and more are told apart
+ * @param dead     TRUE if one of the players is dead
+ * @param out      TRUE if the current player is out of the map
+ */
+#define ENC_KEY(gasoline, dead, out) ((((gasoline) > 0) + ((gasoline) > 1)) * 4 + (dead) * 2 + (out))
+#define ENC_KEYS 12
+
+#define ENC_MAX(a, b) ((a) > (b) ? (a) : (b))
+
+/**
+ * Initializer of an EncounterTable, usable both for static tables (the values are constants) and for compound literals.
+ * Gieson appears when rand()%100+1 <= appear[key]: with the gasoline never, when one of the players is dead with
+ * the odds of dead, when the current player escaped and the other is alive with the odds of exit, otherwise of base.
+ * If he does not appear and the draw is <= rustle[key] the player only hears a noise, unless the gasoline is still active.
+ */
+#define ENCOUNTER_TABLE(odds_exit, odds_dead, odds_base, odds_rustle, turns) {                           \
+    .appear = {odds_base, ENC_MAX(odds_exit, odds_base), ENC_MAX(odds_dead, odds_base), ENC_MAX(odds_dead, odds_base), \
+               0, 0, 0, 0, 0, 0, 0, 0},                                                                 \
+    .rustle = {odds_rustle, odds_rustle, odds_rustle, odds_rustle,                                      \
+               odds_rustle, odds_rustle, odds_rustle, odds_rustle, 0, 0, 0, 0},                         \
+    .gasoline_turns = turns                                                                             \
+}
+
+typedef struct {
+    uint8_t appear[ENC_KEYS];       /**<Odds (%) of the appearance of Gieson */
+    uint8_t rustle[ENC_KEYS];       /**<Odds (%) of a noise, when he does not appear */
+    uint8_t gasoline_turns;         /**<Turns without Gieson after the gasoline */
+} EncounterTable;
+
+// Narration of an encounter, see callGieson
+typedef enum {ENC_TEXT_NO_ITEM, ENC_TEXT_KNIFE, ENC_TEXT_KNIFE_FATAL, ENC_TEXT_GUN, ENC_TEXT_GASOLINE} EncounterText;
+
+typedef struct {
+    uint8_t slot;                   /**<Object of the backpack used, JUNK when nothing is used */
+    uint8_t consume;                /**<1 if the object is used up */
+    uint8_t state;                  /**<PlayerState after the encounter */
+    uint8_t died;
+    uint8_t gasoline;               /**<1 if Gieson stays away for gasoline_turns */
+    uint8_t text;                   /**<EncounterText */
+} EncounterOutcome;
+
+extern const EncounterOutcome encounter_outcome[7][3]; /**<Indexed by the ObjType chosen (NOTHING too) and by the PlayerState */
+
+// -------------------------------------TABLES----------------------------------
+
+typedef struct {
+    // Values read from the file
+    int            object_prop [6][6]; /**<Probability (%) of each object (columns) for each type of zone (rows) */
+    int            backpack_size;
+    int            craft_fail;
+    int            craft_spread[3][3]; /**<Weights of KNIFE, GUN, GASOLINE with 1, 2, 3 or more junk */
+    unsigned short start       [2][6]; /**<Initial backpacks of P1 and P2 */
+    int            start_count [2];
+    EncounterTable encounter;          /**<Fixed for now, not read from the file */
+
+    // Sampling tables compiled from the values above
+    uint8_t        spawn       [6][100]; /**<Object given by rand()%100 for each type of zone */
+    uint8_t        craft_total [3];      /**<Sum of the weights, 1 if there's only one possible item */
+    uint8_t        craft_item  [3][100]; /**<Item given by rand()%craft_total */
+} GameTables;
+
+const GameTables* tablesCurrent      ();
+unsigned          tablesGeneration   ();
+int               tablesReload       (const char*);
+int               tablesCompile      (GameTables*, const char*);
+void              tablesWatchSignal  ();
+void              tablesPoll         (const char*);
+
+#endif
@@ -0,0 +1,90 @@
+/******************************************************************************/
+/*!
+ * @file   metrics.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Test of metrics.c: the waits for the user are left out of the spans around them
+ *
+ * A span holds two waits of WAIT_MS each and a short pause outside of them, another one only a
+ * pause: the first has to record about the pause alone, both waits excluded, the second the pause.
+ * The values are read back from the exported file.
+ *
+ * Compilation: gcc -D METRICS -o test_metrics tests/metrics.c metrics.c -Wall -std=c11
+ * Usage:       ./test_metrics
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../metrics.h"
+
+#define TEST_FILE "test_metrics.prom"
+#define WAIT_MS   100
+#define PAUSE_MS  10
+
+static void sleepMs(int ms)
+{
+    struct timespec ts = {0, ms * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * Reads the sum of a timer from the exported file
+ * @return The sum in seconds, -1 if it is missing
+ */
+static double readSum(const char* op)
+{
+    FILE*  fptr = fopen(TEST_FILE, "r");
+    char   line[256], prefix[64];
+    double sum  = -1;
+
+    if (fptr == NULL)
+        return -1;
+    snprintf(prefix, sizeof(prefix), "gieson_latency_seconds_sum{op=\"%s\"} ", op);
+    while (fgets(line, sizeof(line), fptr) != NULL)
+        if (strncmp(line, prefix, strlen(prefix)) == 0)
+            sscanf(line + strlen(prefix), "%lf", &sum);
+    fclose(fptr);
+    return sum;
+}
+
+int main()
+{
+    int failed = 0;
+
+    // A span with two waits
+    METRICS_START(t_waits);
+    METRICS_WAIT_BEGIN();
+    sleepMs(WAIT_MS);
+    METRICS_WAIT_END();
+    sleepMs(PAUSE_MS);
+    METRICS_WAIT_BEGIN();
+    sleepMs(WAIT_MS);
+    METRICS_WAIT_END();
+    METRICS_RECORD(M_RUMMAGE, t_waits);
+
+    // A span without waits
+    METRICS_START(t_pause);
+    sleepMs(PAUSE_MS);
+    METRICS_RECORD(M_HEAL, t_pause);
+
+    metricsExport(TEST_FILE);
+    double waits = readSum("rummage"), plain = readSum("heal");
+    remove(TEST_FILE);
+
+    if (waits < PAUSE_MS / 1e3 || waits >= WAIT_MS / 1e3)
+    {
+        printf("FALLITO: lo span con due attese misura %.6f s, atteso circa %.3f s\n", waits, PAUSE_MS / 1e3);
+        failed++;
+    }
+    if (plain < PAUSE_MS / 1e3 || plain >= WAIT_MS / 1e3)
+    {
+        printf("FALLITO: lo span senza attese misura %.6f s, atteso circa %.3f s\n", plain, PAUSE_MS / 1e3);
+        failed++;
+    }
+    if (!failed)
+        printf("ok\n");
+    return failed;
+}
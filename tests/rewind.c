@@ -0,0 +1,117 @@
+/******************************************************************************/
+/*!
+ * @file   rewind.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Test of the turn history of gamelib.c: the order of the turns after going back
+ *
+ * The games are played by gamelib.c itself, compiled with -D HARNESS (see harness.h), with
+ * random choices. When a player starts a turn right after one of his own, he undoes twice
+ * (7, 7) within it, going back into his previous turn. Once that turn is played again, the
+ * next turn has to start with the same turn_check it had before the undos: it only depends on
+ * the state at the start of the turn gone back to, which the undos did not change.
+ *
+ * Compilation: gcc -O2 -D HARNESS -o test_rewind tests/rewind.c gamelib.c tables.c history.c savestore.c saveparse.c
+ *                  preview.c -Wall -std=c11 -pthread
+ * Usage:       ./test_rewind [games]
+ */
+/******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../gamelib.h"
+#include "../harness.h"
+#include "../sim.h"
+
+#define MAX_CHECKS 3 /**<Checks in a single game, so that it always ends */
+
+static SimRng   rng;
+static int      undos;          /**<Undos still to answer */
+static int      armed;          /**<TRUE while a check waits for the end of the turn gone back to */
+static uint32_t target;         /**<The turn gone back to */
+static uint32_t expected;       /**<turn_check at the start of the turn after it */
+static int      checks_left;
+static uint32_t last_turns;
+static int32_t  last_playing;
+static int      started;
+static int      checked, failed;
+
+int harnessRand(void)
+{
+    return simRand(&rng);
+}
+
+int harnessOnAction(const HarnessState* s)
+{
+    int new_turn = !started || s->turns != last_turns;
+
+    if (armed && s->turns < target)
+        armed = FALSE; // Gone back further, to a turn of the other player: its order is drawn again
+    else if (armed && new_turn && s->turns == target + 1)
+    {
+        armed = FALSE;
+        checked++;
+        if (s->turn_check != expected)
+        {
+            failed++;
+            printf("FALLITO: dopo il turno %u turn_check vale %u invece di %u\n", target + 1, s->turn_check, expected);
+        }
+    }
+
+    // A turn right after one of the same player, with both players still in the map
+    if (!armed && undos == 0 && checks_left > 0 && started && new_turn && s->turns == last_turns + 1 &&
+        s->playing == last_playing && s->player[0].pos != HARNESS_OUT && s->player[1].pos != HARNESS_OUT)
+    {
+        armed    = TRUE;
+        target   = last_turns;
+        expected = s->turn_check;
+        undos    = 2;
+        checks_left--;
+    }
+
+    started      = TRUE;
+    last_turns   = s->turns;
+    last_playing = s->playing;
+    if (undos > 0)
+    {
+        undos--;
+        return 7;
+    }
+    return simRand(&rng) % 3 == 0 ? 1 : 2 + simRand(&rng) % 5;
+}
+
+int harnessOnItem(const HarnessState* s)
+{
+    (void)s;
+    return KNIFE + simRand(&rng) % 3;
+}
+
+int main(int argc, char const *argv[])
+{
+    int     games = argc > 1 ? atoi(argv[1]) : 20000;
+    uint8_t type[HARNESS_MAX_ZONES], object[HARNESS_MAX_ZONES];
+
+    for (int g = 0; g < games; g++)
+    {
+        HarnessState end;
+
+        rng.state   = simGameSeed(1, g);
+        int zones   = MAX_LANDS + 1 + simRand(&rng) % 12;
+        undos       = 0;
+        armed       = FALSE;
+        started     = FALSE;
+        checks_left = MAX_CHECKS;
+        for (int z = 0; z < zones; z++)
+        {
+            type  [z] = z + 1 < zones ? simRand(&rng) % EXIT_CAMPING : EXIT_CAMPING;
+            object[z] = HARNESS_RANDOM;
+        }
+        harnessPlay(type, object, zones, &end);
+    }
+
+    printf("%d controlli in %d partite, %d falliti\n", checked, games, failed);
+    if (checked == 0 || failed > 0)
+        return 1;
+    printf("ok\n");
+    return 0;
+}
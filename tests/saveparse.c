@@ -0,0 +1,74 @@
+/******************************************************************************/
+/*!
+ * @file   saveparse.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Test of saveparse.c: a truncated save is refused
+ *
+ * A save in the format written by saveGame is cut at every length: each cut ending before the
+ * digits of the checksum are complete has to be refused. A save of version 1, without the
+ * FORMAT line and the checksum, has to be loaded as before, and a newer format refused.
+ *
+ * Compilation: gcc -o test_saveparse tests/saveparse.c saveparse.c -Wall -std=c11
+ * Usage:       ./test_saveparse
+ */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "../gamelib.h"
+#include "../saveparse.h"
+
+static const char body[] = "LINKED LIST:\n"
+                           "0-3,4-1,2-6,1-0,4-2,3-6,0-5,5-6#\n"
+                           "PLAYERS:\n"
+                           "P1-2-   3-|   1-   0-   0-   0-   0-   0|-   1-1\n"
+                           "P2-1-   3-|   0-   1-   0-   0-   0-   0|-   1-0\n"
+                           "GAME VARIABLES:\n"
+                           "1, 0";
+
+static int parses(const char* text, size_t len)
+{
+    SaveData  data;
+    SaveError err;
+    return saveParse(text, len, &data, &err) != 0;
+}
+
+int main()
+{
+    char   text[1024];
+    size_t len    = 0;
+    int    failed = 0;
+
+    len += snprintf(text + len, sizeof(text) - len, "FORMAT: %d\n%s", SAVE_FORMAT, body);
+    len += snprintf(text + len, sizeof(text) - len, "\nCHECKSUM: %08x\n", (unsigned)saveChecksum(text, len));
+
+    if (!parses(text, len))
+    {
+        printf("FALLITO: il salvataggio intero viene rifiutato\n");
+        failed++;
+    }
+    for (size_t cut = 1; cut < len - 1; cut++) // Only the last '\n' can be missing
+        if (parses(text, cut))
+        {
+            printf("FALLITO: il salvataggio troncato a %zu byte su %zu viene caricato\n", cut, len);
+            failed++;
+        }
+
+    if (!parses(body, strlen(body)))
+    {
+        printf("FALLITO: il salvataggio della versione 1 viene rifiutato\n");
+        failed++;
+    }
+
+    snprintf(text, sizeof(text), "FORMAT: %d\n%s", SAVE_FORMAT + 1, body);
+    if (parses(text, strlen(text)))
+    {
+        printf("FALLITO: il salvataggio di un formato più recente viene caricato\n");
+        failed++;
+    }
+
+    if (!failed)
+        printf("ok\n");
+    return failed;
+}
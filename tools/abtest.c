@@ -0,0 +1,158 @@
+/******************************************************************************/
+/*!
+ * @file   abtest.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Compares the rule sets of sim_rules.def on the same map and the same games
+ *
+ * Every rule set plays the same seeds (common random numbers), each one with its
+ * specialized engine, so the differences between the rates come from the rules only.
+ * With --generic the same games are played also with the generic engine, to measure
+ * the gain of the specialization.
+ *
+ * Compilation: gcc -O2 -o abtest tools/abtest.c sim.c tables.c -Wall -std=c11 -pthread
+ * Usage:       ./abtest [--rules NAME[,NAME...]] [--games N] [--zones N] [--threads N]
+ *                       [--seed S] [--tables FILE] [--generic 1]
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../sim.h"
+
+typedef struct {
+    const SimVariant* variant;
+    const SimMap*     map;
+    uint64_t          seed;
+    uint64_t          first, count;
+    SimStats          stats;
+} Job;
+
+static void* worker(void* arg)
+{
+    Job* job = (Job*)arg;
+    simRun(job->variant, job->map, &sim_policy_default, job->seed, job->first, job->count, &job->stats);
+    return NULL;
+}
+
+/**
+ * Plays the games splitting them among the threads
+ * @return The seconds elapsed
+ */
+static double runAll(const SimVariant* variant, const SimMap* map, uint64_t seed, uint64_t games, int threads, SimStats* stats)
+{
+    pthread_t       tids[threads];
+    Job             jobs[threads];
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < threads; t++)
+    {
+        jobs[t] = (Job){variant, map, seed, games * t / threads, games * (t + 1) / threads - games * t / threads, {0}};
+        pthread_create(&tids[t], NULL, worker, &jobs[t]);
+    }
+
+    *stats = (SimStats){0};
+    for (int t = 0; t < threads; t++)
+    {
+        pthread_join(tids[t], NULL);
+        stats->games += jobs[t].stats.games;
+        stats->both  += jobs[t].stats.both;
+        stats->one   += jobs[t].stats.one;
+        stats->none  += jobs[t].stats.none;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+int main(int argc, char const *argv[])
+{
+    const SimVariant* chosen[64];
+    int               n_chosen = 0;
+    uint64_t          games    = 100000;
+    uint64_t          seed     = 1;
+    int               zones    = 0;
+    int               threads  = sysconf(_SC_NPROCESSORS_ONLN);
+    int               generic  = FALSE;
+    const char*       tables   = TABLES_FILE;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if      (strcmp(argv[i], "--games")   == 0) games   = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--zones")   == 0) zones   = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--threads") == 0) threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seed")    == 0) seed    = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--tables")  == 0) tables  = argv[i + 1];
+        else if (strcmp(argv[i], "--generic") == 0) generic = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--rules")   == 0)
+        {
+            char names[256];
+            snprintf(names, sizeof(names), "%s", argv[i + 1]);
+            for (char* name = strtok(names, ","); name != NULL && n_chosen < 64; name = strtok(NULL, ","))
+            {
+                if ((chosen[n_chosen++] = simFindVariant(name)) == NULL)
+                {
+                    fprintf(stderr, "Regole sconosciute: %s\n", name);
+                    return -1;
+                }
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Opzione sconosciuta: %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    tablesReload(tables); // If the file is missing the default rules are used
+
+    if (n_chosen == 0)
+        for (n_chosen = 0; n_chosen < sim_variants_count && n_chosen < 64; n_chosen++)
+            chosen[n_chosen] = &sim_variants[n_chosen];
+    if (threads < 1)
+        threads = 1;
+
+    // The map has to be valid for every rule set
+    for (int v = 0; v < n_chosen; v++)
+        if (zones < chosen[v]->rules->min_lands)
+            zones = chosen[v]->rules->min_lands;
+    if (zones > SIM_MAX_ZONES - 1)
+        zones = SIM_MAX_ZONES - 1;
+
+    SimMap   map;
+    SimRng   rng = {seed};
+    TypeZone types[SIM_MAX_ZONES];
+    for (int i = 0; i < zones; i++)
+        types[i] = simRand(&rng) % EXIT_CAMPING;
+    simMapInit(&map, types, zones);
+
+    printf("%d zone, %llu partite per regole, %d thread\n\n", zones, (unsigned long long)games, threads);
+    printf("%-12s %9s %9s %9s %12s", "REGOLE", "ENTRAMBI", "UNO", "NESSUNO", "PARTITE/S");
+    printf(generic ? " %12s\n" : "\n", "GENERICO/S");
+
+    for (int v = 0; v < n_chosen; v++)
+    {
+        SimStats st;
+        double   secs = runAll(chosen[v], &map, seed, games, threads, &st);
+
+        printf("%-12s %8.3f%% %8.3f%% %8.3f%% %12.0f", chosen[v]->rules->name,
+               100.0 * st.both / st.games, 100.0 * st.one / st.games, 100.0 * st.none / st.games, st.games / secs);
+
+        if (generic)
+        {
+            SimVariant g = {chosen[v]->rules, simPlayRules};
+            SimStats   gst;
+            double     gsecs = runAll(&g, &map, seed, games, threads, &gst);
+
+            if (gst.both != st.both || gst.one != st.one || gst.none != st.none)
+                printf(" %12.0f  (risultati diversi!)\n", gst.games / gsecs);
+            else
+                printf(" %12.0f\n", gst.games / gsecs);
+        }
+        else
+            printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,538 @@
+/******************************************************************************/
+/*!
+ * @file   analyzer.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Offline queries over the event files written with -D EVENTS
+ *
+ * The files are memory-mapped and split in chunks of blocks, scanned in parallel.
+ * Each thread builds a full count cube over (type, zone, object, state, outcome, player):
+ * every record costs one index computation and one increment, and any filter or
+ * group-by is then answered from the merged cube. The per-player outcomes
+ * (e.g. did the gasoline save the player?) are joined through a hash table keyed by game and player.
+ *
+ * Compilation: gcc -O2 -o analyzer tools/analyzer.c -Wall -std=c11 -pthread
+ * Usage:       ./analyzer [--threads N] [--report deaths|gasoline|all]
+ *                         [--group-by DIM[,DIM]] [--where DIM=VALUE]... FILE...
+ *              DIM is one of: type, zone, object, state, outcome, player
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../gamelib.h"
+#include "../events.h"
+
+// Bytes of blocks assigned to a single work unit
+#define CHUNK_SIZE (4 << 20)
+
+// ---------------------------------DIMENSIONS----------------------------------
+typedef enum {D_TYPE, D_ZONE, D_OBJECT, D_STATE, D_OUTCOME, D_PLAYER, DIMS} Dim;
+
+static const char* dim_names[DIMS] = {"type", "zone", "object", "state", "outcome", "player"};
+static const int   dim_sizes[DIMS] = {EV_TYPES, 7, 7, 3, 4, 3};
+
+// Names used for the values of each dimension, both in input (--where) and output
+static const char* tags_type[EV_TYPES] = {
+    "EV_GAME_START", "EV_ZONE_ADVANCED", "EV_OBJECT_FOUND", "EV_OBJECT_TAKEN", "EV_BANDAGE_USED",
+    "EV_ADRENALINE_USED", "EV_CRAFT", "EV_GIESON_APPEARED", "EV_GIESON_RESOLVED", "EV_VICTORY", "EV_GAME_OVER"
+};
+static const char* tags_zone   [7] = {"KITCHEN", "LIVING_ROOM", "SHED", "STREET", "ALONG_LAKE", "EXIT_CAMPING", "NONE"};
+static const char* tags_object [7] = {"JUNK", "BANDAGE", "KNIFE", "GUN", "GASOLINE", "ADRENALINE", "NOTHING"};
+static const char* tags_state  [3] = {"DEAD", "INJURED", "ALIVE"};
+static const char* tags_outcome[4] = {"OUT_NONE", "OUT_SUCCESS", "OUT_FAILURE", "OUT_DIED"};
+static const char* tags_player [3] = {"GAME", "GIACOMO", "MARZIA"};
+
+static const char** dim_tags[DIMS] = {tags_type, tags_zone, tags_object, tags_state, tags_outcome, tags_player};
+
+#define CUBE_SIZE (EV_TYPES * 7 * 7 * 3 * 4 * 3)
+
+/**
+ * Position of a record inside the cube. Out of range values are clamped,
+ * so a corrupted record can not write outside of it
+ */
+static inline unsigned cubeIndex(const GameEvent* ev)
+{
+    unsigned type    = ev->type      < EV_TYPES ? ev->type      : EV_TYPES - 1;
+    unsigned zone    = ev->zone_type < 6        ? ev->zone_type : 6;
+    unsigned object  = ev->object    < 7        ? ev->object    : 6;
+    unsigned state   = ev->state     < 3        ? ev->state     : 2;
+    unsigned outcome = ev->outcome   < 4        ? ev->outcome   : 0;
+    unsigned player  = ev->player    < 3        ? ev->player    : 0;
+
+    return ((((type * 7 + zone) * 7 + object) * 3 + state) * 4 + outcome) * 3 + player;
+}
+
+/**
+ * Inverse of cubeIndex
+ */
+static void cubeCoords(unsigned index, int coords[DIMS])
+{
+    for (int d = DIMS - 1; d >= 0; d--)
+    {
+        coords[d] = index % dim_sizes[d];
+        index    /= dim_sizes[d];
+    }
+}
+
+// ---------------------------------PLAYER JOIN---------------------------------
+enum {F_MET_GIESON = 1, F_GASOLINE = 2, F_ESCAPED = 4, F_DIED = 8};
+
+typedef struct {
+    uint64_t* keys;  /**<(game << 2 | player) + 1, 0 means empty */
+    uint8_t*  flags;
+    size_t    size;  /**<Power of two */
+    size_t    used;
+} FlagTable;
+
+static void tableInit(FlagTable* t, size_t size)
+{
+    t->keys  = (uint64_t*)calloc(size, sizeof(uint64_t));
+    t->flags = (uint8_t*)calloc(size, sizeof(uint8_t));
+    t->size  = size;
+    t->used  = 0;
+    if (t->keys == NULL || t->flags == NULL)
+    {
+        fprintf(stderr, "Memoria insufficiente.\n");
+        exit(-1);
+    }
+}
+
+static void tableSet(FlagTable* t, uint64_t key, uint8_t flags);
+
+static void tableGrow(FlagTable* t)
+{
+    FlagTable bigger;
+    tableInit(&bigger, t->size * 2);
+
+    for (size_t i = 0; i < t->size; i++)
+        if (t->keys[i])
+            tableSet(&bigger, t->keys[i], t->flags[i]);
+
+    free(t->keys);
+    free(t->flags);
+    *t = bigger;
+}
+
+/**
+ * ORs the flags into the entry of the key, inserting it if needed (open addressing, linear probing)
+ */
+static void tableSet(FlagTable* t, uint64_t key, uint8_t flags)
+{
+    if (t->used * 2 >= t->size)
+        tableGrow(t);
+
+    size_t i = (key * 0x9e3779b97f4a7c15u) >> 20 & (t->size - 1);
+    while (t->keys[i] != 0 && t->keys[i] != key)
+        i = (i + 1) & (t->size - 1);
+
+    if (t->keys[i] == 0)
+    {
+        t->keys[i] = key;
+        t->used++;
+    }
+    t->flags[i] |= flags;
+}
+
+// ----------------------------------SCANNING-----------------------------------
+typedef struct {
+    const unsigned char* data;
+    size_t               size;
+} Unit;
+
+typedef struct {
+    uint64_t  cube[CUBE_SIZE];
+    FlagTable players;
+    uint64_t  records;
+} Partial;
+
+static Unit*      units      = NULL;
+static size_t     units_num  = 0;
+static atomic_size_t next_unit = 0;
+
+/**
+ * Scans a run of blocks. Every record is counted in the cube, then the few events
+ * which matter for the per-player outcomes are sent to the join table
+ */
+static void scanUnit(const Unit* unit, Partial* p)
+{
+    const unsigned char* cur = unit->data;
+    const unsigned char* end = unit->data + unit->size;
+
+    while (cur + sizeof(uint32_t) <= end)
+    {
+        uint32_t count;
+        memcpy(&count, cur, sizeof(count));
+        cur += sizeof(count);
+
+        const GameEvent* ev = (const GameEvent*)cur;
+        for (uint32_t i = 0; i < count; i++)
+            p->cube[cubeIndex(&ev[i])]++;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint8_t flags = 0;
+            if (ev[i].type == EV_GIESON_RESOLVED)
+                flags = ev[i].object == GASOLINE ? F_MET_GIESON | F_GASOLINE : F_MET_GIESON;
+            else if (ev[i].type == EV_VICTORY)
+                flags = F_ESCAPED;
+            else if (ev[i].type == EV_GAME_OVER)
+                flags = F_DIED;
+
+            if (flags)
+                tableSet(&p->players, ((uint64_t)ev[i].game << 2 | ev[i].player) + 1, flags);
+        }
+
+        p->records += count;
+        cur        += count * sizeof(GameEvent);
+    }
+}
+
+static void* worker(void* arg)
+{
+    Partial* p = (Partial*)arg;
+    size_t   u;
+
+    while ((u = atomic_fetch_add(&next_unit, 1)) < units_num)
+        scanUnit(&units[u], p);
+
+    return NULL;
+}
+
+/**
+ * Maps a file and cuts it in work units, always on a block boundary
+ * @return FALSE if the file can not be used
+ */
+static int addFile(const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        fprintf(stderr, "%s: impossibile aprire il file.\n", path);
+        return 0;
+    }
+    if (st.st_size < 8)
+    {
+        fprintf(stderr, "%s: file vuoto o troncato.\n", path);
+        close(fd);
+        return 0;
+    }
+
+    const unsigned char* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "%s: impossibile mappare il file.\n", path);
+        return 0;
+    }
+    posix_madvise((void*)data, st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    uint16_t version, rec_size;
+    memcpy(&version,  data + 4, 2);
+    memcpy(&rec_size, data + 6, 2);
+    if (memcmp(data, EVENTS_MAGIC, 4) != 0 || version != EVENTS_VERSION || rec_size != sizeof(GameEvent))
+    {
+        fprintf(stderr, "%s: non è un file di eventi compatibile.\n", path);
+        munmap((void*)data, st.st_size);
+        return 0;
+    }
+
+    size_t off = 8, start = 8;
+    while (off + sizeof(uint32_t) <= (size_t)st.st_size)
+    {
+        uint32_t count;
+        memcpy(&count, data + off, sizeof(count));
+
+        size_t next = off + sizeof(count) + (size_t)count * sizeof(GameEvent);
+        if (next > (size_t)st.st_size)
+        {
+            fprintf(stderr, "%s: ultimo blocco troncato a %zu byte, ignorato.\n", path, off);
+            break;
+        }
+        off = next;
+
+        if (off - start >= CHUNK_SIZE)
+        {
+            units = (Unit*)realloc(units, (units_num + 1) * sizeof(Unit));
+            units[units_num++] = (Unit){data + start, off - start};
+            start = off;
+        }
+    }
+    if (off > start)
+    {
+        units = (Unit*)realloc(units, (units_num + 1) * sizeof(Unit));
+        units[units_num++] = (Unit){data + start, off - start};
+    }
+    return 1;
+}
+
+// ----------------------------------QUERIES------------------------------------
+/**
+ * Sums the cells of the cube matching the filter
+ * @param  cube  The merged cube
+ * @param  where For each dimension the required value, -1 for any
+ * @return       The number of matching records
+ */
+static uint64_t countWhere(const uint64_t* cube, const int where[DIMS])
+{
+    uint64_t total = 0;
+    int      coords[DIMS];
+
+    for (unsigned i = 0; i < CUBE_SIZE; i++)
+    {
+        if (cube[i] == 0)
+            continue;
+
+        cubeCoords(i, coords);
+
+        unsigned char match = TRUE;
+        for (int d = 0; d < DIMS && match; d++)
+            match = where[d] < 0 || where[d] == coords[d];
+
+        if (match)
+            total += cube[i];
+    }
+    return total;
+}
+
+/**
+ * Prints the number of records matching the filter, grouped by one or two dimensions
+ */
+static void groupBy(const uint64_t* cube, const int where[DIMS], int dim1, int dim2)
+{
+    static uint64_t result[EV_TYPES][EV_TYPES];
+    int coords[DIMS];
+
+    memset(result, 0, sizeof(result));
+    for (unsigned i = 0; i < CUBE_SIZE; i++)
+    {
+        if (cube[i] == 0)
+            continue;
+
+        cubeCoords(i, coords);
+
+        unsigned char match = TRUE;
+        for (int d = 0; d < DIMS && match; d++)
+            match = where[d] < 0 || where[d] == coords[d];
+
+        if (match)
+            result[coords[dim1]][dim2 < 0 ? 0 : coords[dim2]] += cube[i];
+    }
+
+    printf("%-20s %-20s %15s\n", dim_names[dim1], dim2 < 0 ? "" : dim_names[dim2], "count");
+    for (int a = 0; a < dim_sizes[dim1]; a++)
+        for (int b = 0; b < (dim2 < 0 ? 1 : dim_sizes[dim2]); b++)
+            if (result[a][b])
+                printf("%-20s %-20s %15llu\n", dim_tags[dim1][a], dim2 < 0 ? "" : dim_tags[dim2][b], (unsigned long long)result[a][b]);
+    printf("\n");
+}
+
+static double ratio(uint64_t num, uint64_t den)
+{
+    return den == 0 ? 0.0 : 100.0 * num / den;
+}
+
+/**
+ * Death rate per type of zone: deaths against visits and against encounters with Gieson
+ */
+static void reportDeaths(const uint64_t* cube)
+{
+    printf("MORTI PER TIPO DI ZONA\n");
+    printf("%-14s %12s %12s %12s %10s %10s\n", "zone", "visits", "encounters", "deaths", "%visits", "%encount.");
+
+    for (int z = KITCHEN; z <= EXIT_CAMPING; z++)
+    {
+        int where[DIMS] = {EV_ZONE_ADVANCED, z, -1, -1, -1, -1};
+        uint64_t visits = countWhere(cube, where);
+
+        where[D_TYPE] = EV_GIESON_APPEARED;
+        uint64_t encounters = countWhere(cube, where);
+
+        where[D_TYPE] = EV_GIESON_RESOLVED;
+        where[D_OUTCOME] = OUT_DIED;
+        uint64_t deaths = countWhere(cube, where);
+
+        printf("%-14s %12llu %12llu %12llu %9.2f%% %9.2f%%\n", tags_zone[z],
+               (unsigned long long)visits, (unsigned long long)encounters, (unsigned long long)deaths,
+               ratio(deaths, visits), ratio(deaths, encounters));
+    }
+    printf("(le visite non comprendono la prima zona, in cui i giocatori partono)\n\n");
+}
+
+/**
+ * Outcome of the players who used the gasoline against Gieson, compared with
+ * the players who met Gieson but never went through the gasoline path of chooseItem
+ */
+static void reportGasoline(const FlagTable* players)
+{
+    uint64_t count[2][3] = {{0}};
+
+    for (size_t i = 0; i < players->size; i++)
+    {
+        uint8_t f = players->flags[i];
+        if (players->keys[i] == 0 || !(f & F_MET_GIESON))
+            continue;
+
+        int group  = (f & F_GASOLINE) ? 0 : 1;
+        int result = (f & F_ESCAPED) ? 0 : ((f & F_DIED) ? 1 : 2);
+        count[group][result]++;
+    }
+
+    printf("ESITO DEI GIOCATORI CHE HANNO INCONTRATO GIESON\n");
+    printf("%-16s %12s %12s %12s %10s\n", "", "escaped", "died", "unfinished", "%escaped");
+    for (int g = 0; g < 2; g++)
+    {
+        uint64_t finished = count[g][0] + count[g][1];
+        printf("%-16s %12llu %12llu %12llu %9.2f%%\n", g == 0 ? "with gasoline" : "without gasoline",
+               (unsigned long long)count[g][0], (unsigned long long)count[g][1], (unsigned long long)count[g][2],
+               ratio(count[g][0], finished));
+    }
+    printf("\n");
+}
+
+// -----------------------------------MAIN--------------------------------------
+static int findDim(const char* name)
+{
+    for (int d = 0; d < DIMS; d++)
+        if (strcmp(name, dim_names[d]) == 0)
+            return d;
+    return -1;
+}
+
+/**
+ * Parses a value of a dimension, given either by name or by number
+ */
+static int findValue(int dim, const char* value)
+{
+    for (int v = 0; v < dim_sizes[dim]; v++)
+        if (strcmp(value, dim_tags[dim][v]) == 0)
+            return v;
+
+    char* end;
+    long  v = strtol(value, &end, 10);
+    return (*end == '\0' && v >= 0 && v < dim_sizes[dim]) ? (int)v : -1;
+}
+
+static void usage()
+{
+    fprintf(stderr, "Uso: analyzer [--threads N] [--report deaths|gasoline|all]\n"
+                    "                [--group-by DIM[,DIM]] [--where DIM=VALUE]... FILE...\n"
+                    "DIM: type, zone, object, state, outcome, player\n");
+    exit(-1);
+}
+
+int main(int argc, char const *argv[])
+{
+    int  threads  = sysconf(_SC_NPROCESSORS_ONLN);
+    int  where[DIMS];
+    int  group[2] = {-1, -1};
+    char report[16] = "all";
+
+    for (int d = 0; d < DIMS; d++)
+        where[d] = -1;
+
+    int i = 1;
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+    {
+        if (i + 1 >= argc)
+            usage();
+
+        if (strcmp(argv[i], "--threads") == 0)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--report") == 0)
+            snprintf(report, sizeof(report), "%s", argv[++i]);
+        else if (strcmp(argv[i], "--group-by") == 0)
+        {
+            char dims[64];
+            snprintf(dims, sizeof(dims), "%s", argv[++i]);
+
+            char* second = strchr(dims, ',');
+            if (second != NULL)
+                *second++ = '\0';
+
+            group[0] = findDim(dims);
+            group[1] = second == NULL ? -1 : findDim(second);
+            if (group[0] < 0 || (second != NULL && group[1] < 0))
+                usage();
+            snprintf(report, sizeof(report), "none");
+        }
+        else if (strcmp(argv[i], "--where") == 0)
+        {
+            char cond[64];
+            snprintf(cond, sizeof(cond), "%s", argv[++i]);
+
+            char* value = strchr(cond, '=');
+            if (value == NULL)
+                usage();
+            *value++ = '\0';
+
+            int d = findDim(cond);
+            if (d < 0 || (where[d] = findValue(d, value)) < 0)
+            {
+                fprintf(stderr, "Condizione non valida: %s\n", argv[i]);
+                return -1;
+            }
+        }
+        else
+            usage();
+    }
+    if (i == argc)
+        usage();
+
+    for (; i < argc; i++)
+        addFile(argv[i]);
+
+    if (threads < 1)
+        threads = 1;
+
+    // Scanning
+    pthread_t* tids     = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    Partial*   partials = (Partial*)calloc(threads, sizeof(Partial));
+    if (tids == NULL || partials == NULL)
+    {
+        fprintf(stderr, "Memoria insufficiente.\n");
+        return -1;
+    }
+
+    for (int t = 0; t < threads; t++)
+    {
+        tableInit(&partials[t].players, 1 << 12);
+        pthread_create(&tids[t], NULL, worker, &partials[t]);
+    }
+    for (int t = 0; t < threads; t++)
+        pthread_join(tids[t], NULL);
+
+    // Merging the partial results into the first one
+    Partial* total = &partials[0];
+    for (int t = 1; t < threads; t++)
+    {
+        for (unsigned c = 0; c < CUBE_SIZE; c++)
+            total->cube[c] += partials[t].cube[c];
+        for (size_t k = 0; k < partials[t].players.size; k++)
+            if (partials[t].players.keys[k])
+                tableSet(&total->players, partials[t].players.keys[k], partials[t].players.flags[k]);
+        total->records += partials[t].records;
+    }
+
+    printf("%llu eventi analizzati in %zu blocchi di lavoro.\n\n", (unsigned long long)total->records, units_num);
+
+    if (group[0] >= 0)
+        groupBy(total->cube, where, group[0], group[1]);
+    if (strcmp(report, "deaths") == 0 || strcmp(report, "all") == 0)
+        reportDeaths(total->cube);
+    if (strcmp(report, "gasoline") == 0 || strcmp(report, "all") == 0)
+        reportGasoline(&total->players);
+
+    return 0;
+}
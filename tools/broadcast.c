@@ -0,0 +1,426 @@
+/******************************************************************************/
+/*!
+ * @file   broadcast.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Broadcasts a game in progress to many spectators over a local socket
+ *
+ * The state is read from the shared memory of the session (see spectator.h), as the spectator
+ * tool does, but every frame is rendered once into a reference counted buffer which is shared
+ * by all the watchers: a watcher only keeps a pointer to the frame it is sending and its offset,
+ * and the frame is sent straight from the shared buffer with a vectored send (the screen clear,
+ * then the frame). A watcher slower than the game finishes the frame it started and then jumps
+ * to the latest one, skipping the frames in between, so the memory used does not grow with
+ * the delay of the watchers.
+ *
+ * With --bench the tool connects N watchers to itself and publishes synthetic frames, reporting
+ * the CPU time of the broadcaster for every frame delivered as N grows.
+ *
+ * Compilation: gcc -O2 -o broadcast tools/broadcast.c spectator.c -Wall -std=c11
+ * Usage:       ./broadcast [--socket PATH] [--interval MS] SESSION
+ *              ./broadcast --bench N[,N...] [--frames F]
+ *              The watchers connect to PATH (/tmp/gieson-SESSION.sock by default), e.g. with nc -U PATH
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "../gamelib.h"
+#include "../spectator.h"
+
+#define MAX_WATCHERS 4096
+
+typedef struct {
+    int    refs;
+    size_t len;
+    char   data[];
+} Frame;
+
+typedef struct {
+    int      fd;
+    Frame*   frame;        /**<Frame being sent, shared with the other watchers */
+    uint64_t frame_id;
+    size_t   off;          /**<Bytes of the frame already sent, screen clear included */
+} Watcher;
+
+static const char clear_screen[] = "\033[H\033[2J";
+#define CLEAR_LEN (sizeof(clear_screen) - 1)
+
+static Watcher  watchers[MAX_WATCHERS];
+static int      n_watchers = 0;
+static Frame*   latest     = NULL;
+static uint64_t latest_id  = 0;
+static uint64_t delivered  = 0, skipped = 0;
+
+// ------------------------------------FRAMES-----------------------------------
+static Frame* frameRender(const char* session, const SpectatorState* s)
+{
+    static char buf[SPECTATOR_FRAME_MAX];
+    size_t      len   = spectatorRender(session, s, buf, sizeof(buf));
+    Frame*      frame = malloc(sizeof(Frame) + len);
+
+    if (frame == NULL)
+    {
+        fprintf(stderr, "Impossibile allocare la memoria per un frame.\n");
+        exit(-1);
+    }
+    frame->refs = 1;
+    frame->len  = len;
+    memcpy(frame->data, buf, len);
+    return frame;
+}
+
+static void frameRelease(Frame* frame)
+{
+    if (frame != NULL && --frame->refs == 0)
+        free(frame);
+}
+
+// -----------------------------------WATCHERS----------------------------------
+static void dropWatcher(int i)
+{
+    close(watchers[i].fd);
+    frameRelease(watchers[i].frame);
+    watchers[i] = watchers[--n_watchers];
+}
+
+/**
+ * Sends to a watcher as much as its socket takes, moving it to the latest frame when it has finished its own
+ * @return 1 if the socket is full and the watcher has something left to send, 0 if it is up to date, -1 on error
+ */
+static int pump(Watcher* w)
+{
+    while (TRUE)
+    {
+        if (w->frame == NULL || w->off == CLEAR_LEN + w->frame->len)
+        {
+            if (w->frame == latest)
+                return 0;
+            if (w->frame != NULL)
+                skipped += latest_id - w->frame_id - 1; // The frames published while this one was being sent
+
+            frameRelease(w->frame);
+            w->frame    = latest;
+            w->frame_id = latest_id;
+            w->off      = 0;
+            if (latest == NULL)
+                return 0;
+            latest->refs++;
+        }
+
+        // Straight from the shared buffer: the screen clear and the frame in a single vectored send
+        struct iovec  iov[2];
+        int           n_iov = 0;
+        if (w->off < CLEAR_LEN)
+            iov[n_iov++] = (struct iovec){(void*)(clear_screen + w->off), CLEAR_LEN - w->off};
+        size_t body = w->off > CLEAR_LEN ? w->off - CLEAR_LEN : 0;
+        iov[n_iov++] = (struct iovec){w->frame->data + body, w->frame->len - body};
+
+        struct msghdr msg = {0};
+        msg.msg_iov    = iov;
+        msg.msg_iovlen = n_iov;
+        ssize_t sent = sendmsg(w->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 1 : (errno == EINTR ? 1 : -1);
+        w->off += sent;
+        if (w->off < CLEAR_LEN + w->frame->len)
+            return 1;
+        delivered++;
+    }
+}
+
+/**
+ * Makes a frame the latest one and starts sending it to the watchers which are not busy with another one
+ */
+static void publish(Frame* frame)
+{
+    // A watcher still sending the previous frame keeps its own reference
+    frameRelease(latest);
+    latest = frame;
+    latest_id++;
+
+    for (int i = n_watchers - 1; i >= 0; i--)
+        if (watchers[i].frame == NULL || watchers[i].off == CLEAR_LEN + watchers[i].frame->len)
+            if (pump(&watchers[i]) < 0)
+                dropWatcher(i);
+}
+
+/**
+ * Waits for the sockets at most timeout ms: accepts the new watchers, drops the closed ones
+ * and goes on with the sends which were stopped by a full socket
+ */
+static void serve(int listen_fd, int timeout)
+{
+    struct pollfd fds[MAX_WATCHERS + 1];
+    int           busy[MAX_WATCHERS];
+
+    fds[0] = (struct pollfd){listen_fd, POLLIN, 0};
+    for (int i = 0; i < n_watchers; i++)
+    {
+        Watcher* w = &watchers[i];
+        busy[i]    = w->frame != NULL && (w->off < CLEAR_LEN + w->frame->len || w->frame != latest);
+        fds[i + 1] = (struct pollfd){w->fd, POLLIN | (busy[i] ? POLLOUT : 0), 0};
+    }
+
+    int n = n_watchers;
+    if (poll(fds, n + 1, timeout) <= 0)
+        return;
+
+    for (int i = n - 1; i >= 0; i--)
+    {
+        short ev = fds[i + 1].revents;
+        if (ev & POLLIN)
+        {
+            char    discard[256]; // The watchers have nothing to say, their input only tells when they leave
+            ssize_t r = recv(watchers[i].fd, discard, sizeof(discard), MSG_DONTWAIT);
+            if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+            {
+                dropWatcher(i);
+                continue;
+            }
+        }
+        if ((ev & (POLLERR | POLLHUP)) || ((ev & POLLOUT) && pump(&watchers[i]) < 0))
+            dropWatcher(i);
+    }
+
+    if (fds[0].revents & POLLIN)
+    {
+        int fd;
+        while ((fd = accept(listen_fd, NULL, NULL)) >= 0)
+        {
+            if (n_watchers == MAX_WATCHERS)
+            {
+                close(fd);
+                continue;
+            }
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            watchers[n_watchers] = (Watcher){fd, NULL, 0, 0};
+            if (pump(&watchers[n_watchers++]) < 0)
+                dropWatcher(n_watchers - 1);
+        }
+    }
+}
+
+static int listenOn(const char* path)
+{
+    struct sockaddr_un addr = {0};
+    int                fd   = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    unlink(path);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 128) != 0)
+    {
+        fprintf(stderr, "Impossibile aprire il socket %s.\n", path);
+        exit(-1);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static double cpuTime()
+{
+    struct rusage r;
+    getrusage(RUSAGE_SELF, &r);
+    return r.ru_utime.tv_sec + r.ru_utime.tv_usec * 1e-6 + r.ru_stime.tv_sec + r.ru_stime.tv_usec * 1e-6;
+}
+
+// -------------------------------------BENCH-----------------------------------
+/**
+ * Connects n watchers to the socket and reads everything they receive, until the broadcaster closes them
+ */
+static void benchWatchers(const char* path, int n)
+{
+    struct pollfd* fds = calloc(n, sizeof(struct pollfd));
+    int            open_fds = n;
+
+    for (int i = 0; i < n; i++)
+    {
+        struct sockaddr_un addr = {0};
+        addr.sun_family = AF_UNIX;
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+        fds[i].fd     = socket(AF_UNIX, SOCK_STREAM, 0);
+        fds[i].events = POLLIN;
+        if (connect(fds[i].fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+            _exit(1);
+    }
+    while (open_fds > 0 && poll(fds, n, 5000) > 0)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            char buf[65536];
+            if (fds[i].fd >= 0 && (fds[i].revents & (POLLIN | POLLHUP)) && read(fds[i].fd, buf, sizeof(buf)) <= 0)
+            {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                open_fds--;
+            }
+        }
+    }
+    _exit(0);
+}
+
+static void bench(const char* counts, int frames)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/gieson-bench-%ld.sock", (long)getpid());
+
+    printf("%8s %10s %12s %10s %14s %16s\n", "watcher", "frame", "consegnati", "saltati", "CPU (s)", "CPU/consegna (us)");
+    for (const char* c = counts; *c; )
+    {
+        int n = atoi(c);
+        int listen_fd = listenOn(path);
+
+        pid_t child = fork();
+        if (child == 0)
+            benchWatchers(path, n);
+        while (n_watchers < n)
+            serve(listen_fd, 100);
+
+        SpectatorState state = {0};
+        state.zones = 20;
+        for (int z = 0; z < state.zones; z++)
+            state.type[z] = z + 1 < state.zones ? z % 5 : EXIT_CAMPING;
+        state.playing = 1;
+
+        delivered = skipped = 0;
+        double cpu = cpuTime();
+        for (int f = 0; f < frames; f++)
+        {
+            state.turn             = f;
+            state.moves            = 1 + f % 3;
+            state.player[f % 2].pos = 1 + f % state.zones;
+            publish(frameRender("bench", &state));
+
+            double until = now() + 0.001; // A frame every millisecond, far faster than a real game
+            do
+                serve(listen_fd, 1);
+            while (now() < until);
+        }
+        for (int i = 0; i < 1000 && delivered + skipped < (uint64_t)frames * n; i++)
+            serve(listen_fd, 1); // Letting the slow watchers reach the last frame
+        cpu = cpuTime() - cpu;
+
+        printf("%8d %10d %12llu %10llu %14.3f %16.2f\n", n, frames, (unsigned long long)delivered,
+               (unsigned long long)skipped, cpu, delivered ? cpu / delivered * 1e6 : 0);
+        fflush(stdout);
+
+        while (n_watchers > 0)
+            dropWatcher(n_watchers - 1);
+        frameRelease(latest);
+        latest = NULL;
+        close(listen_fd);
+        unlink(path);
+        waitpid(child, NULL, 0);
+
+        while (*c && *c != ',')
+            c++;
+        if (*c == ',')
+            c++;
+    }
+}
+
+// -------------------------------------MAIN------------------------------------
+int main(int argc, char const *argv[])
+{
+    const char* socket_path = NULL;
+    const char* bench_list  = NULL;
+    int         interval    = 10;
+    int         frames      = 2000;
+    int         i           = 1;
+
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            fprintf(stderr, "Manca il valore dell'opzione %s\n", argv[i]);
+            return -1;
+        }
+        else if (strcmp(argv[i], "--socket") == 0)
+            socket_path = argv[++i];
+        else if (strcmp(argv[i], "--interval") == 0)
+            interval = atoi(argv[++i]) > 0 ? atoi(argv[i]) : 1;
+        else if (strcmp(argv[i], "--bench") == 0)
+            bench_list = argv[++i];
+        else if (strcmp(argv[i], "--frames") == 0)
+            frames = atoi(argv[++i]) > 0 ? atoi(argv[i]) : 1;
+        else
+        {
+            fprintf(stderr, "Opzione sconosciuta: %s\n", argv[i]);
+            return -1;
+        }
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    if (bench_list != NULL)
+    {
+        bench(bench_list, frames);
+        return 0;
+    }
+    if (i + 1 != argc)
+    {
+        fprintf(stderr, "Utilizzo: %s [--socket PATH] [--interval MS] SESSIONE\n"
+                        "          %s --bench N[,N...] [--frames F]\n", argv[0], argv[0]);
+        return -1;
+    }
+
+    const char* session = argv[i];
+    char        path[108];
+    snprintf(path, sizeof(path), "%s", socket_path != NULL ? socket_path : "");
+    if (socket_path == NULL)
+        snprintf(path, sizeof(path), "/tmp/gieson-%s.sock", session);
+
+    // The watchers can connect before the game starts, they get its first frame
+    int listen_fd = listenOn(path);
+    printf("Trasmissione della sessione %s su %s\n", session, path);
+    fflush(stdout);
+
+    const SpectatorRegion* region;
+    while ((region = spectatorAttach(session)) == NULL)
+        serve(listen_fd, interval);
+
+    SpectatorState state;
+    uint32_t       shown = 1; // Odd, never a published sequence number
+    double         cpu   = cpuTime();
+    do
+    {
+        uint32_t seq = spectatorRead(region, &state);
+        if (seq != shown || state.ended) // Also the last state of a game which has died, marked by spectatorRead
+        {
+            publish(frameRender(session, &state));
+            shown = seq;
+        }
+        serve(listen_fd, interval);
+    } while (!state.ended);
+
+    // The last frame reaches the watchers which are not too slow
+    double until = now() + 1;
+    while (now() < until && delivered + skipped < latest_id * (uint64_t)n_watchers)
+        serve(listen_fd, 10);
+
+    printf("Frame: %llu, consegne: %llu, saltati: %llu, CPU: %.3f s\n", (unsigned long long)latest_id,
+           (unsigned long long)delivered, (unsigned long long)skipped, cpuTime() - cpu);
+    while (n_watchers > 0)
+        dropWatcher(n_watchers - 1);
+    frameRelease(latest);
+    spectatorDetach(region);
+    close(listen_fd);
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,648 @@
+/******************************************************************************/
+/*!
+ * @file   harness.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Differential tests of the headless engines against the logic of the game
+ *
+ * Every game is played by the game itself (gamelib.c compiled with -D HARNESS, see harness.h)
+ * and by each engine on the same map, the same seed and the same choices: a random player,
+ * seeded by the game, answers to the menus of both, and the state of the game is recorded
+ * before every choice. The two sequences of states are compared step by step, and at the end
+ * the outcomes; since the choices only depend on the states, the first different state is the
+ * first action that the two implementations play differently.
+ *
+ * A game which does not match is shrunk to a minimal reproducer: the player is made to only
+ * advance after as few choices as possible, then the zones are removed or simplified one by
+ * one, as long as the game still does not match. The reproducer can be played again with --replay.
+ *
+ * Engines: generic (simPlayRules), classic (specialized engine), tables (simPlay),
+ *          gieson (gieson_simulate_batch, one game per call). --self-test 1 adds "mutant",
+ *          an engine where the gasoline lasts a turn less, which has to be caught.
+ *
+ * Compilation: gcc -O2 -D HARNESS -o harness tools/harness.c gamelib.c tables.c sim.c gieson.c history.c
+ *                  savestore.c saveparse.c preview.c -Wall -std=c11 -pthread
+ * Usage:       ./harness [--games N] [--seed S] [--engines NAME[,NAME...]] [--self-test 1]
+ *              ./harness --replay INDEX:LIMIT:TYPES:OBJECTS [--seed S] [--engines ...]
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "../gamelib.h"
+#include "../harness.h"
+#include "../sim.h"
+#include "../gieson.h"
+
+#define MAX_SHOWN     5  /**<Reproducers printed for each engine */
+#define FORCE_ADVANCE 8  /**<Invalid choices in a row after which the player advances, below MAX_INVALID of sim.c */
+
+// A game to play: the seed is the one of the game INDEX of the run
+typedef struct {
+    uint64_t index;
+    int      limit;                    /**<Choices of the random player, then it only advances. -1 for no limit */
+    int      zones;
+    uint8_t  type  [HARNESS_MAX_ZONES];
+    uint8_t  object[HARNESS_MAX_ZONES];
+} Case;
+
+// -----------------------------------PLAYER------------------------------------
+typedef struct {
+    HarnessState* step;
+    uint8_t*      is_item;
+    int           n, cap;
+} Trace;
+
+typedef struct {
+    SimRng   rng;
+    int      limit, choices, invalid;
+    int      has_last;
+    uint32_t last_turns;
+    int32_t  last_playing, last_moves;
+    Trace*   trace;
+} Tester;
+
+static void record(Tester* pl, const HarnessState* s, int is_item)
+{
+    Trace* t = pl->trace;
+
+    if (t->n == t->cap)
+    {
+        t->cap     = t->cap ? 2 * t->cap : 1024;
+        t->step    = realloc(t->step, t->cap * sizeof(HarnessState));
+        t->is_item = realloc(t->is_item, t->cap);
+        if (t->step == NULL || t->is_item == NULL)
+        {
+            fprintf(stderr, "Memoria insufficiente.\n");
+            exit(-1);
+        }
+    }
+    t->step[t->n]    = *s;
+    t->is_item[t->n] = is_item;
+    t->n++;
+}
+
+/**
+ * Chooses an action at random. A choice which left the state as it was is counted as invalid,
+ * and after FORCE_ADVANCE of them in a row the player advances, so that sim.c never forces it
+ */
+static int chooseAction(Tester* pl, const HarnessState* s)
+{
+    record(pl, s, FALSE);
+
+    if (pl->has_last && s->turns == pl->last_turns && s->playing == pl->last_playing && s->moves == pl->last_moves)
+        pl->invalid++;
+    else
+        pl->invalid = 0;
+    pl->has_last     = TRUE;
+    pl->last_turns   = s->turns;
+    pl->last_playing = s->playing;
+    pl->last_moves   = s->moves;
+
+    if ((pl->limit >= 0 && pl->choices >= pl->limit) || pl->invalid >= FORCE_ADVANCE)
+        return SIM_ADVANCE;
+    pl->choices++;
+    return 1 + simRand(&pl->rng) % 6;
+}
+
+/**
+ * Chooses at random one of the items against Gieson, now and then one that is not in the backpack
+ */
+static int chooseItem(Tester* pl, const HarnessState* s)
+{
+    const uint16_t* backpack = s->player[s->playing].backpack;
+    int             options[3], n = 0;
+
+    record(pl, s, TRUE);
+    for (int o = KNIFE; o <= GASOLINE; o++)
+        if (backpack[o] > 0)
+            options[n++] = o;
+    if (n == 0 || simRand(&pl->rng) % 8 == 0)
+        return KNIFE + simRand(&pl->rng) % 3;
+    return options[simRand(&pl->rng) % n];
+}
+
+static void playerInit(Tester* pl, const Case* c, uint64_t game_seed, Trace* trace)
+{
+    memset(pl, 0, sizeof(*pl));
+    pl->rng.state = simPolicySeed(game_seed);
+    pl->limit     = c->limit;
+    pl->trace     = trace;
+    trace->n      = 0;
+}
+
+// ----------------------------------REFERENCE----------------------------------
+static SimRng  ref_rng;
+static Tester* ref_tester;
+
+int harnessRand(void)
+{
+    return simRand(&ref_rng);
+}
+
+int harnessOnAction(const HarnessState* s)
+{
+    return chooseAction(ref_tester, s);
+}
+
+int harnessOnItem(const HarnessState* s)
+{
+    return chooseItem(ref_tester, s);
+}
+
+// -----------------------------------ENGINES-----------------------------------
+typedef struct {
+    int32_t  state[2];
+    uint8_t  escaped[2];
+    uint32_t turns;
+} Outcome;
+
+static void fromSim(const SimGame* g, int player, int moves, HarnessState* s)
+{
+    memset(s, 0, sizeof(*s));
+    for (int p = 0; p < 2; p++)
+    {
+        s->player[p].state     = g->p[p].state;
+        s->player[p].pos       = g->p[p].pos;
+        s->player[p].obj_count = g->p[p].obj_count;
+        s->player[p].searched  = g->p[p].searched;
+        memcpy(s->player[p].backpack, g->p[p].backpack, sizeof(s->player[p].backpack));
+    }
+    s->gasoline_turns = g->gasoline_turns;
+    s->turn_check     = g->turn_check;
+    s->turns          = g->turns;
+    s->playing        = player;
+    s->moves          = moves;
+    s->zones          = g->zones;
+    memcpy(s->object, g->object, g->zones);
+}
+
+static SimAction simAction(const SimGame* g, int player, int moves, void* ctx)
+{
+    HarnessState s;
+    fromSim(g, player, moves, &s);
+    return chooseAction(ctx, &s);
+}
+
+static ObjType simItem(const SimGame* g, int player, void* ctx)
+{
+    HarnessState s;
+    fromSim(g, player, 0, &s);
+    return chooseItem(ctx, &s);
+}
+
+// The view of libgieson has no turn_check: it is not compared for that engine
+static void fromGieson(const GiesonView* v, int player, int moves, HarnessState* s)
+{
+    memset(s, 0, sizeof(*s));
+    for (int p = 0; p < 2; p++)
+    {
+        s->player[p].state     = v->player[p].state;
+        s->player[p].pos       = v->player[p].pos;
+        s->player[p].obj_count = v->player[p].obj_count;
+        s->player[p].searched  = v->player[p].searched;
+        memcpy(s->player[p].backpack, v->player[p].backpack, sizeof(s->player[p].backpack));
+    }
+    s->gasoline_turns = v->gasoline_turns;
+    s->turns          = v->turns;
+    s->playing        = player;
+    s->moves          = moves;
+    s->zones          = v->zones;
+    memcpy(s->object, v->object, v->zones);
+}
+
+static int32_t giesonAction(const GiesonView* v, int32_t player, int32_t moves, void* ctx)
+{
+    HarnessState s;
+    fromGieson(v, player, moves, &s);
+    return chooseAction(ctx, &s);
+}
+
+static int32_t giesonItem(const GiesonView* v, int32_t player, void* ctx)
+{
+    HarnessState s;
+    fromGieson(v, player, 0, &s);
+    return chooseItem(ctx, &s);
+}
+
+static uint64_t run_seed = 1;
+static SimRules mutant_rules;
+
+static void playSim(int engine, const Case* c, Tester* pl, Outcome* out)
+{
+    SimMap    map;
+    SimPolicy policy  = {"harness", simAction, simItem, pl, NULL};
+    uint64_t  seed    = simGameSeed(run_seed, c->index);
+    SimResult res;
+
+    map.zones = c->zones;
+    memcpy(map.type, c->type, c->zones);
+    memcpy(map.object, c->object, c->zones);
+
+    if (engine == 0)
+        simPlayRules(simFindVariant("classic")->rules, &map, &policy, seed, &res);
+    else if (engine == 1)
+        simFindVariant("classic")->play(NULL, &map, &policy, seed, &res);
+    else if (engine == 2)
+        simPlay(&map, &policy, seed, &res);
+    else
+        simPlayRules(&mutant_rules, &map, &policy, seed, &res);
+
+    for (int p = 0; p < 2; p++)
+    {
+        out->state[p]   = res.state[p];
+        out->escaped[p] = res.escaped[p];
+    }
+    out->turns = res.turns;
+}
+
+static void playGieson(const Case* c, Tester* pl, Outcome* out)
+{
+    GiesonMap     map    = {c->zones, c->type, c->object};
+    GiesonPolicy  policy = {giesonAction, giesonItem, pl};
+    uint8_t       state[2], escaped[2];
+    uint32_t      turns;
+    GiesonResults res    = {state, escaped, &turns, NULL};
+
+    gieson_simulate_batch(NULL, &map, &policy, run_seed, c->index, 1, &res);
+    for (int p = 0; p < 2; p++)
+    {
+        out->state[p]   = state[p];
+        out->escaped[p] = escaped[p];
+    }
+    out->turns = turns;
+}
+
+static const char* engine_names[] = {"generic", "classic", "tables", "mutant", "gieson"};
+#define N_ENGINES 5
+#define GIESON    4
+
+// ---------------------------------COMPARISON----------------------------------
+static Trace ref_trace, eng_trace;
+
+typedef struct {
+    int     step;          /**<First step that differs, -1 if the game matches */
+    char    what[256];
+    Outcome ref, eng;
+} Divergence;
+
+/**
+ * Describes the first field of two states which differs
+ * @return FALSE if the states are equal
+ */
+static int diffState(const HarnessState* a, const HarnessState* b, int turn_check, char* what, size_t size)
+{
+    for (int p = 0; p < 2; p++)
+    {
+        const HarnessPlayer* x = &a->player[p];
+        const HarnessPlayer* y = &b->player[p];
+        const char*          n = p == 0 ? "P1" : "P2";
+
+        if (x->state != y->state)
+            return snprintf(what, size, "%s.state %d / %d", n, x->state, y->state), TRUE;
+        if (x->pos != y->pos)
+            return snprintf(what, size, "%s.pos %d / %d", n, x->pos, y->pos), TRUE;
+        if (x->obj_count != y->obj_count)
+            return snprintf(what, size, "%s.obj_count %d / %d", n, x->obj_count, y->obj_count), TRUE;
+        if (x->searched != y->searched)
+            return snprintf(what, size, "%s.searched %d / %d", n, x->searched, y->searched), TRUE;
+        for (int o = 0; o < 6; o++)
+            if (x->backpack[o] != y->backpack[o])
+                return snprintf(what, size, "%s.backpack[%d] %d / %d", n, o, x->backpack[o], y->backpack[o]), TRUE;
+    }
+    if (a->gasoline_turns != b->gasoline_turns)
+        return snprintf(what, size, "gasoline_turns %u / %u", a->gasoline_turns, b->gasoline_turns), TRUE;
+    if (turn_check && a->turn_check != b->turn_check)
+        return snprintf(what, size, "turn_check %u / %u", a->turn_check, b->turn_check), TRUE;
+    if (a->turns != b->turns)
+        return snprintf(what, size, "turns %u / %u", a->turns, b->turns), TRUE;
+    if (a->playing != b->playing)
+        return snprintf(what, size, "playing %d / %d", a->playing, b->playing), TRUE;
+    if (a->moves != b->moves)
+        return snprintf(what, size, "moves %d / %d", a->moves, b->moves), TRUE;
+    if (a->zones != b->zones)
+        return snprintf(what, size, "zones %d / %d", a->zones, b->zones), TRUE;
+    for (int z = 0; z < a->zones; z++)
+        if (a->object[z] != b->object[z])
+            return snprintf(what, size, "object[%d] %d / %d", z, a->object[z], b->object[z]), TRUE;
+    return FALSE;
+}
+
+/**
+ * Plays a game with the game and with an engine and compares them
+ * @return TRUE if they match
+ */
+static int check(int engine, const Case* c, Divergence* d)
+{
+    uint64_t     seed = simGameSeed(run_seed, c->index);
+    Tester       ref, eng;
+    HarnessState end;
+
+    // The reference: the objects of the zones are drawn by addZone from the stream of the game, like sim.c does
+    playerInit(&ref, c, seed, &ref_trace);
+    ref_rng.state = seed;
+    ref_tester    = &ref;
+    harnessPlay(c->type, c->object, c->zones, &end);
+
+    playerInit(&eng, c, seed, &eng_trace);
+    if (engine == GIESON)
+        playGieson(c, &eng, &d->eng);
+    else
+        playSim(engine, c, &eng, &d->eng);
+
+    for (int p = 0; p < 2; p++)
+    {
+        d->ref.state[p]   = end.player[p].state;
+        d->ref.escaped[p] = end.player[p].pos == HARNESS_OUT && end.player[p].state != DEAD;
+    }
+    d->ref.turns = end.turns;
+
+    d->step = -1;
+    int n = ref_trace.n < eng_trace.n ? ref_trace.n : eng_trace.n;
+    for (int i = 0; i < n; i++)
+    {
+        if (ref_trace.is_item[i] != eng_trace.is_item[i])
+        {
+            d->step = i;
+            snprintf(d->what, sizeof(d->what), "%s / %s", ref_trace.is_item[i] ? "oggetto" : "azione",
+                     eng_trace.is_item[i] ? "oggetto" : "azione");
+            return FALSE;
+        }
+        if (diffState(&ref_trace.step[i], &eng_trace.step[i], engine != GIESON, d->what, sizeof(d->what)))
+        {
+            d->step = i;
+            return FALSE;
+        }
+    }
+    if (ref_trace.n != eng_trace.n)
+    {
+        d->step = n;
+        snprintf(d->what, sizeof(d->what), "scelte %d / %d", ref_trace.n, eng_trace.n);
+        return FALSE;
+    }
+    if (memcmp(&d->ref, &d->eng, sizeof(Outcome)) != 0)
+    {
+        d->step = n;
+        snprintf(d->what, sizeof(d->what), "esito P1 %d-%d P2 %d-%d turni %u / P1 %d-%d P2 %d-%d turni %u",
+                 d->ref.state[0], d->ref.escaped[0], d->ref.state[1], d->ref.escaped[1], d->ref.turns,
+                 d->eng.state[0], d->eng.escaped[0], d->eng.state[1], d->eng.escaped[1], d->eng.turns);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// ----------------------------------SHRINKING----------------------------------
+/**
+ * Makes a game which does not match as small as possible, keeping it not matching
+ */
+static void shrink(int engine, Case* c)
+{
+    Divergence d;
+    Case       t;
+    int        changed = TRUE;
+
+    // The choices after the first difference do not matter
+    check(engine, c, &d);
+    int choices = 0;
+    for (int i = 0; i < d.step && i < ref_trace.n; i++)
+        choices += !ref_trace.is_item[i];
+    t = *c;
+    t.limit = choices + 1;
+    if (!check(engine, &t, &d))
+        *c = t;
+
+    while (changed)
+    {
+        changed = FALSE;
+
+        for (int step = c->limit; step > 0 && c->limit > 0; step /= 2)
+        {
+            t = *c;
+            t.limit -= step;
+            if (!check(engine, &t, &d))
+                *c = t, changed = TRUE, step *= 2;
+        }
+
+        // Removing the zones, the exit stays the last one
+        for (int z = c->zones - 2; z >= 0; z--)
+        {
+            t = *c;
+            memmove(&t.type[z], &t.type[z + 1], t.zones - z - 1);
+            memmove(&t.object[z], &t.object[z + 1], t.zones - z - 1);
+            t.zones--;
+            if (!check(engine, &t, &d))
+                *c = t, changed = TRUE;
+        }
+
+        // Simpler zones: kitchens, without objects
+        for (int z = 0; z < c->zones; z++)
+        {
+            t = *c;
+            if (t.type[z] != KITCHEN && t.type[z] != EXIT_CAMPING)
+            {
+                t.type[z] = KITCHEN;
+                if (!check(engine, &t, &d))
+                    *c = t, changed = TRUE;
+            }
+            t = *c;
+            if (t.object[z] != NOTHING)
+            {
+                t.object[z] = NOTHING;
+                if (!check(engine, &t, &d))
+                    *c = t, changed = TRUE;
+            }
+        }
+    }
+}
+
+static void printCase(const Case* c)
+{
+    printf("%llu:%d:", (unsigned long long)c->index, c->limit);
+    for (int z = 0; z < c->zones; z++)
+        printf("%d%s", c->type[z], z + 1 < c->zones ? "," : ":");
+    for (int z = 0; z < c->zones; z++)
+    {
+        if (c->object[z] == HARNESS_RANDOM)
+            printf("R");
+        else
+            printf("%d", c->object[z]);
+        printf("%s", z + 1 < c->zones ? "," : "");
+    }
+}
+
+/**
+ * Reads a reproducer written by printCase
+ * @return FALSE if it is not valid
+ */
+static int parseCase(const char* text, Case* c)
+{
+    unsigned long long index;
+    int                used;
+
+    memset(c, 0, sizeof(*c));
+    if (sscanf(text, "%llu:%d:%n", &index, &c->limit, &used) != 2)
+        return FALSE;
+    c->index = index;
+    text += used;
+
+    for (int part = 0; part < 2; part++)
+    {
+        int n = 0;
+        while (*text && *text != ':' && n < HARNESS_MAX_ZONES)
+        {
+            int value = HARNESS_RANDOM;
+            if (*text == 'R')
+                text++;
+            else if (sscanf(text, "%d%n", &value, &used) == 1)
+                text += used;
+            else
+                return FALSE;
+
+            if (part == 0)
+                c->type[n++] = value;
+            else
+                c->object[n++] = value;
+            if (*text == ',')
+                text++;
+        }
+        if (part == 0)
+            c->zones = n;
+        else if (n != c->zones)
+            return FALSE;
+        if (*text == ':')
+            text++;
+    }
+    for (int z = 0; z < c->zones; z++)
+        if (c->type[z] > EXIT_CAMPING || (c->type[z] == EXIT_CAMPING) != (z + 1 == c->zones) ||
+            (c->object[z] > NOTHING && c->object[z] != HARNESS_RANDOM))
+            return FALSE;
+    return c->zones > 0;
+}
+
+// -------------------------------------MAIN------------------------------------
+/**
+ * The game INDEX of the run: a map from 1 to 3*MAX_LANDS zones, shorter than the game allows
+ * to reach the exit sooner, with now and then an object fixed instead of drawn
+ */
+static void makeCase(uint64_t index, Case* c)
+{
+    SimRng rng = {~simGameSeed(run_seed, index)};
+
+    c->index = index;
+    c->limit = -1;
+    c->zones = 1 + simRand(&rng) % (3 * MAX_LANDS + 1);
+    for (int z = 0; z < c->zones; z++)
+    {
+        c->type  [z] = z + 1 < c->zones ? simRand(&rng) % EXIT_CAMPING : EXIT_CAMPING;
+        c->object[z] = simRand(&rng) % 8 == 0 ? simRand(&rng) % (NOTHING + 1) : HARNESS_RANDOM;
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    uint64_t    games   = 100000;
+    const char* engines = "generic,classic,tables,gieson";
+    const char* replay  = NULL;
+    int         self    = FALSE;
+    int         enabled[N_ENGINES] = {0};
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if      (strcmp(argv[i], "--games")     == 0) games    = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--seed")      == 0) run_seed = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--engines")   == 0) engines  = argv[i + 1];
+        else if (strcmp(argv[i], "--replay")    == 0) replay   = argv[i + 1];
+        else if (strcmp(argv[i], "--self-test") == 0) self     = atoi(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "Opzione sconosciuta: %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    char list[256];
+    snprintf(list, sizeof(list), "%s%s", engines, self ? ",mutant" : "");
+    for (char* name = strtok(list, ","); name != NULL; name = strtok(NULL, ","))
+    {
+        int e;
+        for (e = 0; e < N_ENGINES && strcmp(engine_names[e], name) != 0; e++);
+        if (e == N_ENGINES)
+        {
+            fprintf(stderr, "Motore sconosciuto: %s\n", name);
+            return -1;
+        }
+        enabled[e] = TRUE;
+    }
+
+    // The default tables only: the game reads the odds of Gieson from them, the engines from the classic rules
+    mutant_rules = *simFindVariant("classic")->rules;
+    mutant_rules.encounter.gasoline_turns--;
+
+    Divergence d;
+    if (replay != NULL)
+    {
+        Case c;
+        if (!parseCase(replay, &c))
+        {
+            fprintf(stderr, "Riproduttore non valido: %s\n", replay);
+            return -1;
+        }
+        for (int e = 0; e < N_ENGINES; e++)
+        {
+            if (!enabled[e])
+                continue;
+            if (check(e, &c, &d))
+                printf("%-8s uguale, %d scelte\n", engine_names[e], ref_trace.n);
+            else
+                printf("%-8s diverso al passo %d: %s (partita / motore)\n", engine_names[e], d.step, d.what);
+        }
+        return 0;
+    }
+
+    struct timespec start, end;
+    uint64_t        failures[N_ENGINES] = {0}, steps = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint64_t i = 0; i < games; i++)
+    {
+        Case c;
+        makeCase(i, &c);
+        for (int e = 0; e < N_ENGINES; e++)
+        {
+            if (!enabled[e])
+                continue;
+            if (check(e, &c, &d))
+            {
+                steps += ref_trace.n;
+                continue;
+            }
+            if (failures[e]++ < MAX_SHOWN)
+            {
+                shrink(e, &c);
+                check(e, &c, &d);
+                printf("%-8s diverso al passo %d: %s (partita / motore)\n         riproduttore: --replay ", engine_names[e], d.step, d.what);
+                printCase(&c);
+                printf("\n");
+                makeCase(i, &c);
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    printf("\n%llu partite, %llu stati confrontati, %.1f s (%.0f partite al minuto)\n", (unsigned long long)games,
+           (unsigned long long)steps, secs, games * 60 / secs);
+    int failed = FALSE;
+    for (int e = 0; e < N_ENGINES; e++)
+        if (enabled[e])
+        {
+            printf("%-8s %llu partite diverse\n", engine_names[e], (unsigned long long)failures[e]);
+            failed |= failures[e] > 0 && e != 3;
+        }
+    if (self && failures[3] == 0)
+    {
+        printf("Il motore mutant non è stato scoperto.\n");
+        failed = TRUE;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,517 @@
+/******************************************************************************/
+/*!
+ * @file   loadgen.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Load generator for the server of the game (Output --serve PORT)
+ *
+ * Opens many connections to a local server and plays a game on each of them, through the
+ * real menus: the main menu, the ID, the creation of the map, the actions of doTurn and the
+ * choice of the item against Gieson. When a game ends the client starts a new one.
+ * All the clients live in a single process, driven by epoll, with a heap of the clients
+ * waiting for their think time.
+ *
+ * A screen of the game ends with the question to answer, and the game sends it only when it
+ * waits for the input, so a client recognizes the question by the end of what it received and
+ * the kind of the question by the last known text of the screen. The latency is measured from
+ * the send of an answer to the arrival of the whole next question, and recorded in histograms
+ * with 32 sub-buckets for every power of two (at most ~3% of error), one for each kind of question.
+ *
+ * Policies of the actions: "random" (any action from 1 to 7) or "script" (scout, take, craft,
+ * heal and advance, in a loop). The items against Gieson are always chosen at random.
+ *
+ * Compilation: gcc -O2 -o loadgen tools/loadgen.c -Wall -std=c11
+ * Usage:       ./loadgen [--port P] [--clients N] [--duration S] [--think MS] [--zones N]
+ *                        [--policy random|script] [--seed S]
+ *              The server has to be running: ./Output --serve P
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "../gamelib.h"
+
+#define SUB_BITS   5
+#define SUB        (1 << SUB_BITS)
+#define BUCKETS    ((40 - SUB_BITS + 2) * SUB)           /**<Up to 2^40 microseconds */
+#define TAIL       32                                    /**<Bytes kept to find a text across two reads */
+#define MAX_EVENTS 1024
+
+// The kinds of question, by the text of the screen which asks them
+typedef enum {
+    Q_NONE, Q_MAIN, Q_ID, Q_YES, Q_MAP, Q_ZONE, Q_ACTION, Q_ITEM, Q_TURN, Q_KINDS
+} Question;
+
+static const struct {
+    const char* text;
+    Question    kind;
+} markers[] = {
+    {"1) Nuova Partita",          Q_MAIN},
+    {"ID giocatore",              Q_ID},
+    {"(s/n): ",                   Q_YES},
+    {"1) Inserisci una nuova zona", Q_MAP},
+    {"1) Cucina",                 Q_ZONE},
+    {"MOSSE RIMANENTI",           Q_ACTION},
+    {"Che cosa vuoi utilizzare?", Q_ITEM},
+    {"A quale turno vuoi tornare", Q_TURN}
+};
+
+// The endings of the questions: the game is waiting for the answer
+static const char* prompts[] = {
+    "La tua scelta: ", "(s/n): ", "caratteri): ", "riprova: ", "annullare): "
+};
+
+static const char* tags_kind[Q_KINDS] = {
+    "altro", "menù", "ID", "s/n", "mappa", "zona", "azione", "oggetto", "turno"
+};
+
+typedef struct {
+    uint64_t count[BUCKETS];
+    uint64_t total;
+    uint64_t max;
+    double   sum;
+} Histogram;
+
+typedef struct {
+    int      fd;
+    int      id;
+    Question kind;          /**<Kind of the question being received */
+    Question last;          /**<Kind of the previous question */
+    int      options;       /**<Items offered against Gieson */
+    int      zones;         /**<Zones added to the map being created */
+    int      step;          /**<Next action of the "script" policy */
+    int      games;
+    int      in_game;
+    uint64_t rng;
+    char     tail[TAIL];
+    int      tail_len;
+    double   sent;          /**<When the last answer has been sent, 0 before the first question */
+    double   due;           /**<When the next answer has to be sent */
+    char     answer[48];
+    int      heap_pos;      /**<Position in the heap of the think times, -1 if out of it */
+} Client;
+
+static Client*   clients;
+static int       n_clients;
+static Client**  heap;
+static int       heap_n = 0;
+static Histogram hist[Q_KINDS];
+static Histogram all;
+static Histogram connect_hist;
+
+static int       think_ms = 0;
+static int       zones    = MAX_LANDS;
+static int       scripted = FALSE;
+static uint64_t  answers  = 0;
+static uint64_t  games    = 0;
+static uint64_t  errors   = 0;
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static uint32_t nextRand(uint64_t* state)
+{
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state >> 33;
+}
+
+// ---------------------------------HISTOGRAMS----------------------------------
+static int bucketOf(uint64_t v)
+{
+    if (v < 2 * SUB)
+        return v;
+    int e = 63 - __builtin_clzll(v) - SUB_BITS; // v >> e is in [SUB, 2*SUB)
+    int b = e * SUB + (int)(v >> e);
+    return b < BUCKETS ? b : BUCKETS - 1;
+}
+
+static uint64_t lowerOf(int b)
+{
+    if (b < 2 * SUB)
+        return b;
+    int e = b / SUB - 1;
+    return (uint64_t)(b % SUB + SUB) << e;
+}
+
+static void record(Histogram* h, double seconds)
+{
+    uint64_t us = seconds * 1e6;
+
+    h->count[bucketOf(us)]++;
+    h->total++;
+    h->sum += us;
+    if (us > h->max)
+        h->max = us;
+}
+
+static double percentile(const Histogram* h, double p)
+{
+    uint64_t rank = (uint64_t)(p * h->total), seen = 0;
+
+    for (int b = 0; b < BUCKETS; b++)
+        if ((seen += h->count[b]) > rank)
+            return lowerOf(b) / 1000.0;
+    return h->max / 1000.0;
+}
+
+static void printHistogram(const char* name, const Histogram* h, double elapsed)
+{
+    if (h->total == 0)
+        return;
+    printf("%-11s %10llu %10.1f %9.3f %9.3f %9.3f %9.3f %9.3f\n", name, (unsigned long long)h->total, h->total / elapsed,
+           h->sum / h->total / 1000, percentile(h, 0.5), percentile(h, 0.99), percentile(h, 0.999), h->max / 1000.0);
+}
+
+// -------------------------------THINK TIMES-----------------------------------
+static void heapSwap(int a, int b)
+{
+    Client* t = heap[a];
+    heap[a] = heap[b];
+    heap[b] = t;
+    heap[a]->heap_pos = a;
+    heap[b]->heap_pos = b;
+}
+
+static void heapPush(Client* c)
+{
+    int i = heap_n++;
+
+    heap[i]     = c;
+    c->heap_pos = i;
+    for (; i > 0 && heap[(i - 1) / 2]->due > heap[i]->due; i = (i - 1) / 2)
+        heapSwap(i, (i - 1) / 2);
+}
+
+static Client* heapPop()
+{
+    Client* top = heap[0];
+
+    heapSwap(0, --heap_n);
+    for (int i = 0; 2 * i + 1 < heap_n;)
+    {
+        int child = 2 * i + 1;
+        if (child + 1 < heap_n && heap[child + 1]->due < heap[child]->due)
+            child++;
+        if (heap[i]->due <= heap[child]->due)
+            break;
+        heapSwap(i, child);
+        i = child;
+    }
+    top->heap_pos = -1;
+    return top;
+}
+
+// -----------------------------------CLIENTS-----------------------------------
+/**
+ * Opens the connection of a client, without waiting for it
+ */
+static int connectClient(Client* c, int epoll_fd, int port)
+{
+    struct sockaddr_in  addr = {0};
+    struct epoll_event  ev   = {0};
+    int                 one  = 1;
+
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if ((c->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0)
+        return FALSE;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(c->fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 && errno != EINPROGRESS)
+    {
+        close(c->fd);
+        c->fd = -1;
+        return FALSE;
+    }
+    ev.events   = EPOLLIN;
+    ev.data.ptr = c;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c->fd, &ev);
+    c->kind = c->last = Q_NONE;
+    c->sent = now();
+    return TRUE;
+}
+
+/**
+ * Chooses the answer to the question received by a client
+ */
+static void chooseAnswer(Client* c)
+{
+    static const int script[] = {2, 3, 6, 4, 1};
+
+    switch (c->kind)
+    {
+        case Q_MAIN:
+            if (c->in_game)
+            {
+                c->games++;
+                games++;
+            }
+            c->in_game = FALSE;
+            strcpy(c->answer, "1\n");
+            break;
+        case Q_ID:
+            snprintf(c->answer, sizeof(c->answer), "lg%d_%d\n", c->id, c->games);
+            c->zones   = 0;
+            c->in_game = TRUE;
+            break;
+        case Q_YES:
+            strcpy(c->answer, "s\n");
+            break;
+        case Q_MAP:
+            strcpy(c->answer, c->zones < zones ? "1\n" : "3\n");
+            break;
+        case Q_ZONE:
+            snprintf(c->answer, sizeof(c->answer), "%u\n", nextRand(&c->rng) % 5 + 1);
+            c->zones++;
+            break;
+        case Q_ACTION:
+            if (scripted)
+                snprintf(c->answer, sizeof(c->answer), "%d\n", script[c->step++ % 5]);
+            else
+                snprintf(c->answer, sizeof(c->answer), "%u\n", nextRand(&c->rng) % 7 + 1);
+            break;
+        case Q_ITEM:
+            snprintf(c->answer, sizeof(c->answer), "%u\n", nextRand(&c->rng) % (c->options > 0 ? c->options : 1) + 1);
+            break;
+        default: // Going back to a turn, or a question not known: the safest answer
+            strcpy(c->answer, "0\n");
+    }
+}
+
+static void sendAnswer(Client* c)
+{
+    size_t len = strlen(c->answer);
+
+    if (write(c->fd, c->answer, len) != (ssize_t)len)
+        errors++;
+    c->last     = c->kind;
+    c->kind     = Q_NONE;
+    c->options  = 0;
+    c->tail_len = 0;
+    c->sent     = now();
+}
+
+/**
+ * Looks for the known texts in what a client received, the tail of the previous read included.
+ * The kind of the question is given by the last one on the screen
+ */
+static void scan(Client* c, const char* data, size_t len)
+{
+    char        buf[TAIL + 4096 + 1];
+    size_t      n    = c->tail_len;
+    const char* last = NULL;
+
+    memcpy(buf, c->tail, n);
+    memcpy(buf + n, data, len);
+    n     += len;
+    buf[n] = '\0'; // The game never sends a '\0'
+
+    for (size_t m = 0; m < sizeof(markers) / sizeof(markers[0]); m++)
+    {
+        size_t      mlen = strlen(markers[m].text);
+        const char* at   = buf;
+
+        while ((at = strstr(at, markers[m].text)) != NULL)
+        {
+            // Only the texts which end in this read: the others have been found already
+            if (at + mlen > buf + c->tail_len && (last == NULL || at > last))
+            {
+                last    = at;
+                c->kind = markers[m].kind;
+            }
+            at += mlen;
+        }
+    }
+    // The items offered against Gieson are the lines "N) ..." after the question
+    if (c->kind == Q_ITEM)
+        for (size_t i = c->tail_len; i + 1 < n; i++)
+            if (buf[i] >= '1' && buf[i] <= '3' && buf[i + 1] == ')' && (i == 0 || buf[i - 1] == '\n'))
+                c->options = buf[i] - '0';
+
+    size_t keep = n < TAIL ? n : TAIL;
+    memmove(c->tail, buf + n - keep, keep);
+    c->tail_len = keep;
+}
+
+static int isPrompt(const Client* c)
+{
+    for (size_t p = 0; p < sizeof(prompts) / sizeof(prompts[0]); p++)
+    {
+        size_t len = strlen(prompts[p]);
+        if ((size_t)c->tail_len >= len && memcmp(c->tail + c->tail_len - len, prompts[p], len) == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * Reads what the server sent to a client; once the question is whole, schedules the answer
+ * @return FALSE if the connection has been closed
+ */
+static int readClient(Client* c)
+{
+    char    data[4096];
+    ssize_t n;
+
+    while ((n = read(c->fd, data, sizeof(data))) > 0)
+        scan(c, data, n);
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        return FALSE;
+    if (!isPrompt(c))
+        return TRUE;
+
+    double t = now();
+    if (c->kind == Q_NONE)
+        c->kind = c->last; // A wrong answer: the same question again
+    if (c->last == Q_NONE) // The first screen, from the connection
+        record(&connect_hist, t - c->sent);
+    else
+    {
+        record(&hist[c->kind], t - c->sent);
+        record(&all, t - c->sent);
+    }
+    answers++;
+
+    chooseAnswer(c);
+    c->due = t + (think_ms > 0 ? (nextRand(&c->rng) % (2 * think_ms + 1)) / 1000.0 : 0);
+    if (think_ms > 0)
+        heapPush(c);
+    else
+        sendAnswer(c);
+    return TRUE;
+}
+
+// -------------------------------------MAIN------------------------------------
+int main(int argc, char const *argv[])
+{
+    int      port     = 4000;
+    int      duration = 10;
+    uint64_t seed     = 1;
+
+    n_clients = 100;
+    for (int i = 1; i < argc; i += 2)
+    {
+        if (i + 1 >= argc)
+        {
+            fprintf(stderr, "Manca il valore dell'opzione %s\n", argv[i]);
+            return -1;
+        }
+        if      (strcmp(argv[i], "--port")     == 0) port      = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--clients")  == 0) n_clients = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--duration") == 0) duration  = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--think")    == 0) think_ms  = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--zones")    == 0) zones     = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seed")     == 0) seed      = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--policy")   == 0) scripted  = strcmp(argv[i + 1], "script") == 0;
+        else
+        {
+            fprintf(stderr, "Opzione sconosciuta: %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (n_clients < 1 || duration < 1 || zones < MAX_LANDS || zones > 254)
+    {
+        fprintf(stderr, "Servono almeno un client, un secondo e da %d a 254 zone.\n", MAX_LANDS);
+        return -1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    // Every client needs a descriptor
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < (rlim_t)n_clients + 64)
+    {
+        lim.rlim_cur = (rlim_t)n_clients + 64 < lim.rlim_max ? (rlim_t)n_clients + 64 : lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    clients = (Client*)calloc(n_clients, sizeof(Client));
+    heap    = (Client**)calloc(n_clients, sizeof(Client*));
+    int epoll_fd = epoll_create1(0);
+    if (clients == NULL || heap == NULL || epoll_fd < 0)
+    {
+        fprintf(stderr, "Impossibile preparare i client.\n");
+        return -1;
+    }
+
+    int connected = 0;
+    for (int i = 0; i < n_clients; i++)
+    {
+        clients[i].id       = i;
+        clients[i].rng      = seed * 0x9E3779B97F4A7C15ULL + i;
+        clients[i].heap_pos = -1;
+        connected += connectClient(&clients[i], epoll_fd, port);
+    }
+    if (connected == 0)
+    {
+        fprintf(stderr, "Nessuna connessione al server sulla porta %d.\n", port);
+        return -1;
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    double             start = now(), end = start + duration;
+    int                open  = connected;
+
+    while (open > 0 && now() < end)
+    {
+        int timeout = 100;
+        if (heap_n > 0)
+        {
+            double wait = heap[0]->due - now();
+            timeout = wait <= 0 ? 0 : (int)(wait * 1000) + 1 < timeout ? (int)(wait * 1000) + 1 : timeout;
+        }
+
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+        for (int e = 0; e < n; e++)
+        {
+            Client* c = events[e].data.ptr;
+            if (!readClient(c))
+            {
+                errors++;
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+                close(c->fd);
+                c->fd = -1; // If it is waiting in the heap, its answer is dropped when popped
+                open--;
+            }
+        }
+        for (double t = now(); heap_n > 0 && heap[0]->due <= t;)
+        {
+            Client* c = heapPop();
+            if (c->fd >= 0)
+                sendAnswer(c);
+        }
+    }
+    double elapsed = now() - start;
+
+    printf("Client: %d connessi su %d, %.1f s, risposte: %llu (%.1f/s), partite concluse: %llu, errori: %llu\n\n",
+           connected, n_clients, elapsed, (unsigned long long)answers, answers / elapsed,
+           (unsigned long long)games, (unsigned long long)errors);
+    printf("%-11s %10s %10s %9s %9s %9s %9s %9s\n", "domanda", "risposte", "al sec", "media ms", "p50 ms", "p99 ms",
+           "p99.9 ms", "max ms");
+    printHistogram("connessione", &connect_hist, elapsed);
+    for (int k = 1; k < Q_KINDS; k++)
+        printHistogram(tags_kind[k], &hist[k], elapsed);
+    printHistogram("totale", &all, elapsed);
+
+    for (int i = 0; i < n_clients; i++)
+        if (clients[i].fd >= 0)
+            close(clients[i].fd);
+    free(clients);
+    free(heap);
+    close(epoll_fd);
+    return 0;
+}
@@ -0,0 +1,314 @@
+/******************************************************************************/
+/*!
+ * @file   mapgen.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Searches for maps whose probability of escape of both players hits a target
+ *
+ * Every thread runs a simulated annealing chain over the sequences of zones
+ * (at least MAX_LANDS, exit excluded). A candidate is scored with headless games,
+ * played in batches until the confidence interval of the estimate is tight enough
+ * or shows that the candidate can not beat the best one found so far.
+ * All the candidates are scored on the same stream of seeds (common random numbers),
+ * and the scores are cached, so a map visited twice is simulated once.
+ * The best map is written in the format of GameSave.save, ready for "Carica Partita", so it has
+ * at most SAVE_MAX_ZONES - 1 zones, exit excluded.
+ *
+ * Compilation: gcc -O2 -o mapgen tools/mapgen.c sim.c tables.c -Wall -std=c11 -pthread -lm
+ * Usage:       ./mapgen [--target P] [--zones N] [--max-zones N] [--threads N] [--iterations N]
+ *                       [--tolerance E] [--max-games N] [--seed S] [--tables FILE] [--rules NAME] [--output FILE]
+ *
+ * With --rules the maps are scored with one of the rule sets of sim_rules.def instead of the rules of the game.
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../sim.h"
+#include "../saveparse.h"
+
+#define BATCH   2000
+#define Z_99    2.576
+
+typedef struct {
+    int     zones;
+    uint8_t type[SIM_MAX_ZONES];
+} Candidate;
+
+typedef struct {
+    double   target;
+    int      min_zones, max_zones;
+    int      iterations;
+    double   tolerance;
+    uint64_t max_games;
+    uint64_t seed;
+} Options;
+
+static Options           opt     = {0.5, MAX_LANDS, 3 * MAX_LANDS, 2000, 0.005, 200000, 1};
+static const SimVariant* variant = NULL;
+
+// -----------------------------------CACHE-------------------------------------
+typedef struct entry {
+    Candidate     cand;
+    double        p;
+    uint64_t      games;
+    struct entry* next;
+} Entry;
+
+#define CACHE_BUCKETS (1 << 16)
+
+static Entry*          cache[CACHE_BUCKETS];
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t        cache_hits = 0, cache_misses = 0;
+
+static uint64_t hashCandidate(const Candidate* c)
+{
+    uint64_t h = 1469598103934665603u;
+    for (int i = 0; i < c->zones; i++)
+        h = (h ^ c->type[i]) * 1099511628211u;
+    return h ^ c->zones;
+}
+
+static Entry* cacheFind(const Candidate* c, uint64_t h)
+{
+    for (Entry* e = cache[h % CACHE_BUCKETS]; e != NULL; e = e->next)
+        if (e->cand.zones == c->zones && memcmp(e->cand.type, c->type, c->zones) == 0)
+            return e;
+    return NULL;
+}
+
+// ----------------------------------SCORING------------------------------------
+static pthread_mutex_t best_lock = PTHREAD_MUTEX_INITIALIZER;
+static Candidate       best;
+static double          best_err   = 1.0;
+static double          best_p     = 0.0;
+static uint64_t        best_games = 0;
+
+/**
+ * Estimates the probability of escape of both players, stopping as soon as the 99% confidence
+ * interval is narrower than the tolerance, or as soon as it shows that the error can not go below bound
+ * @param  c     The candidate map
+ * @param  bound Error of the best candidate known, used for the early stop
+ * @param  p     Where the estimate will be written
+ * @return       The number of games behind the estimate
+ */
+static uint64_t score(const Candidate* c, double bound, double* p)
+{
+    uint64_t h = hashCandidate(c);
+
+    pthread_mutex_lock(&cache_lock);
+    Entry* e = cacheFind(c, h);
+    if (e != NULL)
+    {
+        cache_hits++;
+        *p = e->p;
+        uint64_t games = e->games;
+        pthread_mutex_unlock(&cache_lock);
+        return games;
+    }
+    cache_misses++;
+    pthread_mutex_unlock(&cache_lock);
+
+    SimMap   map;
+    SimStats st = {0};
+    TypeZone types[SIM_MAX_ZONES];
+
+    for (int i = 0; i < c->zones; i++)
+        types[i] = c->type[i];
+    simMapInit(&map, types, c->zones);
+
+    while (st.games < opt.max_games)
+    {
+        simRun(variant, &map, &sim_policy_default, opt.seed, st.games, BATCH, &st);
+
+        double est  = (double)st.both / st.games;
+        double half = Z_99 * sqrt((est * (1 - est) + 1.0 / st.games) / st.games);
+
+        if (half < opt.tolerance || fabs(est - opt.target) - half > bound)
+            break;
+    }
+    *p = (double)st.both / st.games;
+
+    e = (Entry*)malloc(sizeof(Entry));
+    if (e != NULL)
+    {
+        e->cand  = *c;
+        e->p     = *p;
+        e->games = st.games;
+
+        pthread_mutex_lock(&cache_lock);
+        e->next = cache[h % CACHE_BUCKETS];
+        cache[h % CACHE_BUCKETS] = e;
+        pthread_mutex_unlock(&cache_lock);
+    }
+    return st.games;
+}
+
+// ----------------------------------ANNEALING----------------------------------
+/**
+ * Changes the type of a zone, or inserts/removes a zone keeping the length between the limits
+ */
+static void mutate(Candidate* c, SimRng* rng)
+{
+    int kind = simRand(rng) % 10;
+    int at   = simRand(rng) % c->zones;
+
+    if (kind == 0 && c->zones < opt.max_zones)
+    {
+        memmove(&c->type[at + 1], &c->type[at], c->zones - at);
+        c->type[at] = simRand(rng) % EXIT_CAMPING;
+        c->zones++;
+    }
+    else if (kind == 1 && c->zones > opt.min_zones)
+    {
+        memmove(&c->type[at], &c->type[at + 1], c->zones - at - 1);
+        c->zones--;
+    }
+    else
+        c->type[at] = (c->type[at] + 1 + simRand(rng) % (EXIT_CAMPING - 1)) % EXIT_CAMPING;
+}
+
+static void* chain(void* arg)
+{
+    SimRng    rng = {(uint64_t)(uintptr_t)arg * 0x9e3779b97f4a7c15u ^ opt.seed};
+    Candidate cur, next;
+    double    cur_p, next_p;
+
+    cur.zones = opt.min_zones;
+    for (int i = 0; i < cur.zones; i++)
+        cur.type[i] = simRand(&rng) % EXIT_CAMPING;
+    score(&cur, 1.0, &cur_p);
+
+    for (int it = 0; it < opt.iterations; it++)
+    {
+        double temp = 0.05 * pow(0.001, (double)it / opt.iterations);
+
+        next = cur;
+        mutate(&next, &rng);
+
+        pthread_mutex_lock(&best_lock);
+        double bound = best_err + 3 * temp;
+        pthread_mutex_unlock(&best_lock);
+
+        uint64_t games    = score(&next, bound, &next_p);
+        double   cur_err  = fabs(cur_p  - opt.target);
+        double   next_err = fabs(next_p - opt.target);
+
+        if (next_err <= cur_err || (simRngNext(&rng) >> 11) * 0x1.0p-53 < exp((cur_err - next_err) / temp))
+        {
+            cur   = next;
+            cur_p = next_p;
+        }
+
+        pthread_mutex_lock(&best_lock);
+        if (next_err < best_err)
+        {
+            best       = next;
+            best_err   = next_err;
+            best_p     = next_p;
+            best_games = games;
+        }
+        pthread_mutex_unlock(&best_lock);
+    }
+    return NULL;
+}
+
+// -----------------------------------MAIN--------------------------------------
+static const char* tags_zone[6] = {
+    "Cucina",
+    "Soggiorno",
+    "Rimessa",
+    "Strada",
+    "Lungo lago",
+    "Uscita campeggio"
+};
+
+int main(int argc, char const *argv[])
+{
+    int         threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char* output  = "GameSave.save";
+    const char* tables  = TABLES_FILE;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if      (strcmp(argv[i], "--target")     == 0) opt.target     = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--zones")      == 0) opt.min_zones  = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--max-zones")  == 0) opt.max_zones  = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--threads")    == 0) threads        = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--iterations") == 0) opt.iterations = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--tolerance")  == 0) opt.tolerance  = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--max-games")  == 0) opt.max_games  = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--seed")       == 0) opt.seed       = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--tables")     == 0) tables         = argv[i + 1];
+        else if (strcmp(argv[i], "--rules")      == 0)
+        {
+            if ((variant = simFindVariant(argv[i + 1])) == NULL)
+            {
+                fprintf(stderr, "Regole sconosciute: %s\n", argv[i + 1]);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--output")     == 0) output         = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "Opzione sconosciuta: %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    tablesReload(tables); // If the file is missing the default rules are used
+
+    int min_lands = variant != NULL ? variant->rules->min_lands : MAX_LANDS;
+    if (opt.min_zones < min_lands)
+        opt.min_zones = min_lands;
+    if (opt.max_zones < opt.min_zones)
+        opt.max_zones = opt.min_zones;
+    if (opt.max_zones > SAVE_MAX_ZONES - 1) // The map is written as a save, which Carica Partita has to load
+    {
+        fprintf(stderr, "Le zone devono essere al massimo %d, uscita esclusa.\n", SAVE_MAX_ZONES - 1);
+        return -1;
+    }
+    if (threads < 1)
+        threads = 1;
+
+    pthread_t* tids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    if (tids == NULL)
+    {
+        fprintf(stderr, "Memoria insufficiente.\n");
+        return -1;
+    }
+    for (int t = 0; t < threads; t++)
+        pthread_create(&tids[t], NULL, chain, (void*)(uintptr_t)(t + 1));
+    for (int t = 0; t < threads; t++)
+        pthread_join(tids[t], NULL);
+
+    // Printing the map like printMap() does
+    printf("\nINIZIO-----------------------------------------------\n");
+    for (int i = 0; i < best.zones; i++)
+        printf("%-2d-> TIPO: %s\n", i + 1, tags_zone[best.type[i]]);
+    printf("%-2d-> TIPO: %s\n", best.zones + 1, tags_zone[EXIT_CAMPING]);
+    printf("FINE-------------------------------------------------\n\n");
+
+    printf("Obiettivo: %.3f  Stima: %.3f  (%llu partite)\n", opt.target, best_p, (unsigned long long)best_games);
+    printf("Mappe valutate: %llu, lette dalla cache: %llu\n", (unsigned long long)cache_misses, (unsigned long long)cache_hits);
+
+    FILE* fptr = fopen(output, "w");
+    if (fptr == NULL)
+    {
+        fprintf(stderr, "Errore nell'apertura del file %s.\n", output);
+        return -1;
+    }
+
+    SimMap   map;
+    TypeZone types[SIM_MAX_ZONES];
+    for (int i = 0; i < best.zones; i++)
+        types[i] = best.type[i];
+    simMapInit(&map, types, best.zones);
+    simWriteSave(&map, opt.seed, fptr);
+    fclose(fptr);
+
+    printf("Mappa salvata in %s.\n", output);
+    return 0;
+}
@@ -0,0 +1,649 @@
+/******************************************************************************/
+/*!
+ * @file   raresim.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Estimates the probability of rare outcomes of a game with importance sampling
+ *
+ * Counting the games that end in a rare way needs about 100/p games for an error of 10%: for
+ * an outcome of one game in a million, a hundred million games. Here the games are played
+ * instead with a proposal, rules with other odds for the random draws of the game (the object
+ * of every zone, the arrival of Gieson, the success of a craft and the item crafted), chosen
+ * to make the outcome frequent. Every game is weighted with its likelihood ratio, the product
+ * over its draws of the odds under the nominal rules divided by the odds under the proposal
+ * (see SimRules.nominal), so that the mean of weight * [outcome] is still the probability
+ * under the nominal rules, without bias, whatever the proposal.
+ *
+ * The proposal is either given (--proposal, --gieson) or adapted with the cross-entropy method:
+ * at each iteration --ce-games games are played, the ones reaching the best level of the score
+ * of the target reached by a fraction --rho of them are kept, and each odd of the proposal
+ * becomes the frequency of its draw in the games kept, weighted by their likelihood ratio
+ * (smoothed with the previous odd). The score of a target grows towards the outcome, so that
+ * the levels are climbed one at a time even when the outcome itself is never seen at first.
+ * The odds are rounded to the integer percents of the tables, never to 0 where the nominal
+ * odd is not 0: the proposal has to draw everything the nominal rules can draw. A proposal
+ * given is corrected with the same rule where it does not.
+ *
+ * Then --games games are played with the proposal and as many (--naive) with the nominal
+ * rules, and the two estimates are compared: the ratio of their variances is the number of
+ * naive games worth one game of the proposal.
+ *
+ * Targets:
+ *   both_unharmed   both players escape without any wound
+ *   gasoline_death  a player dies with the gasoline in the backpack (only with --policy random:
+ *                   the default policy always uses it)
+ *   both_dead       both players die
+ *
+ * Compilation: gcc -O2 -o raresim tools/raresim.c sim.c tables.c -Wall -std=c11 -pthread -lm
+ * Usage:       ./raresim --target NAME [--zones N] [--rules NAME] [--policy default|random] [--seed S]
+ *                        [--games N] [--naive N] [--ce N] [--ce-games N] [--rho R] [--threads N] [--tables FILE]
+ *                        [--proposal FILE] [--gieson BASE,OUT,DEAD,DEAD_OUT] [--save FILE]
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../sim.h"
+
+#define MAX_THREADS 256
+#define MIN_ELITE   50   /**<Games kept at least by an iteration of the cross-entropy method */
+#define SMOOTHING   0.7  /**<Weight of the new odds against the previous ones */
+
+// -----------------------------------TARGETS-----------------------------------
+// How a player left the map
+typedef struct {
+    PlayerState state    [2];
+    int         escaped  [2];
+    int         gasoline [2];   /**<Gasoline in the backpack at the last encounter with Gieson */
+    int         died_gas [2];   /**<TRUE if the player died with the gasoline in the backpack */
+} Outcome;
+
+typedef struct {
+    const char* name;
+    const char* description;
+    int         levels;         /**<Score of the games reaching the target */
+    int       (*score)(const Outcome*);
+} Target;
+
+static int scoreUnharmed(const Outcome* o)
+{
+    return (o->escaped[0] && o->state[0] == ALIVE) + (o->escaped[1] && o->state[1] == ALIVE);
+}
+
+static int scoreGasolineDeath(const Outcome* o)
+{
+    if (o->died_gas[0] || o->died_gas[1])
+        return 2;
+    return o->state[0] == DEAD || o->state[1] == DEAD;
+}
+
+static int scoreBothDead(const Outcome* o)
+{
+    return (o->state[0] == DEAD) + (o->state[1] == DEAD);
+}
+
+static const Target targets[] = {
+    {"both_unharmed",  "entrambi fuggono senza ferite",                    2, scoreUnharmed},
+    {"gasoline_death", "un giocatore muore con la benzina nello zaino",    2, scoreGasolineDeath},
+    {"both_dead",      "muoiono entrambi",                                 2, scoreBothDead}
+};
+
+// ----------------------------------OBSERVER-----------------------------------
+// Context of the policy of a thread
+typedef struct {
+    SimRng  rng;    /**<Choices of the random policy, first as sim_policy_random wants it */
+    Outcome out;
+} Observer;
+
+static void observe(const SimGame* g, int player, SimEvent ev, ObjType item, void* ctx)
+{
+    Observer*        o   = ctx;
+    const SimPlayer* myP = &g->p[player];
+
+    (void)item;
+    if (ev == SIM_EV_GIESON)
+        o->out.gasoline[player] = myP->backpack[GASOLINE];
+    else if (myP->state == DEAD)
+        o->out.died_gas[player] = o->out.gasoline[player] > 0;
+}
+
+// ------------------------------------RUNS-------------------------------------
+// A game played with the proposal, kept for the adaptation
+typedef struct {
+    int      score;
+    double   weight;
+    SimDraws draws;
+} Sample;
+
+// Sums of the games of a run
+typedef struct {
+    uint64_t games;
+    uint64_t hits;      /**<Games reaching the target */
+    double   sum;       /**<Sum of weight * [target] */
+    double   sum2;      /**<Sum of (weight * [target])^2 */
+    double   weights;   /**<Sum of the weights of all the games, about games for a sound proposal */
+    double   weights2;
+    double   secs;
+} Estimate;
+
+typedef struct {
+    const SimRules* rules;
+    uint64_t        first, count;
+    Sample*         samples;    /**<NULL to keep only the sums */
+    Estimate        est;
+} Job;
+
+static SimMap        map;
+static SimPolicy     policy;
+static const Target* target;
+static uint64_t      seed = 1;
+static int           threads;
+
+static void* worker(void* arg)
+{
+    Job*      job  = arg;
+    Observer  o    = {0};
+    SimPolicy with = policy;
+    SimResult res;
+
+    with.ctx = &o;
+    for (uint64_t i = 0; i < job->count; i++)
+    {
+        uint64_t game_seed = simGameSeed(seed, job->first + i);
+
+        memset(&o.out, 0, sizeof(o.out));
+        o.rng.state = simPolicySeed(game_seed);
+        simPlayRules(job->rules, &map, &with, game_seed, &res);
+        for (int p = 0; p < 2; p++)
+        {
+            o.out.state  [p] = res.state[p];
+            o.out.escaped[p] = res.escaped[p];
+        }
+
+        int    score = target->score(&o.out);
+        double y     = score >= target->levels ? res.weight : 0;
+
+        job->est.hits     += y > 0;
+        job->est.sum      += y;
+        job->est.sum2     += y * y;
+        job->est.weights  += res.weight;
+        job->est.weights2 += res.weight * res.weight;
+        if (job->samples != NULL)
+            job->samples[i] = (Sample){score, res.weight, res.draws};
+    }
+    return NULL;
+}
+
+/**
+ * Plays the games [first, first+count) of the seed with the given rules, split among the threads
+ * @param samples Filled with every game if not NULL
+ */
+static Estimate run(const SimRules* rules, uint64_t first, uint64_t count, Sample* samples)
+{
+    pthread_t       tids[MAX_THREADS];
+    Job             jobs[MAX_THREADS];
+    Estimate        est = {0};
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < threads; t++)
+    {
+        uint64_t from = count * t / threads, to = count * (t + 1) / threads;
+        jobs[t] = (Job){rules, first + from, to - from, samples != NULL ? samples + from : NULL, {0}};
+        pthread_create(&tids[t], NULL, worker, &jobs[t]);
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        pthread_join(tids[t], NULL);
+        est.hits     += jobs[t].est.hits;
+        est.sum      += jobs[t].est.sum;
+        est.sum2     += jobs[t].est.sum2;
+        est.weights  += jobs[t].est.weights;
+        est.weights2 += jobs[t].est.weights2;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    est.games = count;
+    est.secs  = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    return est;
+}
+
+static double mean(const Estimate* e)
+{
+    return e->sum / e->games;
+}
+
+// Variance of weight * [target] for a single game
+static double variance(const Estimate* e)
+{
+    double m = mean(e);
+    return e->games > 1 ? (e->sum2 / e->games - m * m) * e->games / (e->games - 1) : 0;
+}
+
+// ------------------------------CROSS-ENTROPY----------------------------------
+/**
+ * Rounds a distribution to integers summing to total, leaving at least 1 where the nominal odd is not 0
+ * and 0 where it is
+ */
+static void roundRow(const double* q, const int* nominal, int* out, int n, int total)
+{
+    int sum = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        out[i] = nominal[i] > 0 ? (int)fmax(1, floor(q[i] * total)) : 0;
+        sum   += out[i];
+    }
+    while (sum != total)
+    {
+        // The entry farthest from its exact value, among the ones that can move
+        int    best = -1;
+        double gap  = 0;
+        for (int i = 0; i < n; i++)
+        {
+            double d = (q[i] * total - out[i]) * (sum < total ? 1 : -1);
+            if (nominal[i] > 0 && (sum < total || out[i] > 1) && (best < 0 || d > gap))
+                best = i, gap = d;
+        }
+        out[best] += sum < total ? 1 : -1;
+        sum       += sum < total ? 1 : -1;
+    }
+}
+
+/**
+ * New odds of a draw: the frequencies of its outcomes in the elite games, weighted by their likelihood
+ * ratio, smoothed with the current odds. Unchanged if the draw never happened in the elite games
+ * @param counts  Weighted count of each outcome
+ * @param current Current odds, in units of total, replaced with the new ones
+ */
+static void adaptRow(const double* counts, const int* nominal, int* current, int n, int total)
+{
+    double sum = 0, q[6];
+
+    for (int i = 0; i < n; i++)
+        sum += counts[i];
+    if (sum <= 0)
+        return;
+    for (int i = 0; i < n; i++)
+        q[i] = SMOOTHING * counts[i] / sum + (1 - SMOOTHING) * (double)current[i] / total;
+    roundRow(q, nominal, current, n, total);
+}
+
+// Success of a craft, out of 100 (see simCraftOdds in sim.c)
+static int craftOdds(int craft_fail)
+{
+    return craft_fail < 1 ? 100 : craft_fail > 101 ? 0 : 101 - craft_fail;
+}
+
+/**
+ * Gives a row of odds the support of the nominal one, rounding it with roundRow, if it draws
+ * an outcome the nominal rules never draw or never draws one they can draw
+ * @return TRUE if the row has been changed
+ */
+static int supportRow(const int* nominal, int* current, int n)
+{
+    double q[6], sum = 0;
+    int    same = TRUE;
+
+    for (int i = 0; i < n; i++)
+    {
+        same &= (nominal[i] > 0) == (current[i] > 0);
+        sum  += current[i] > 0 ? current[i] : 0;
+    }
+    if (same)
+        return FALSE;
+    for (int i = 0; i < n; i++)
+        q[i] = sum > 0 && current[i] > 0 ? current[i] / sum : 0;
+    roundRow(q, nominal, current, n, 100);
+    return TRUE;
+}
+
+/**
+ * Makes a proposal given with --proposal and --gieson draw what the nominal rules draw, as the
+ * adaptation does: an outcome never drawn by the proposal would be missing from the estimate
+ * @return The rows of odds changed
+ */
+static int supportProposal(SimRules* proposal, GameTables* t, const SimRules* nominal)
+{
+    const GameTables* nt      = nominal->tables;
+    int               changed = 0;
+
+    for (int z = 0; z < 6; z++)
+        changed += supportRow(nt->object_prop[z], t->object_prop[z], 6);
+    for (int r = 0; r < 3; r++)
+        changed += supportRow(nt->craft_spread[r], t->craft_spread[r], 3);
+    for (int k = 0; k < ENC_KEYS; k++)
+    {
+        int p = nominal->encounter.appear[k], q[2] = {100 - proposal->encounter.appear[k], proposal->encounter.appear[k]};
+        if (supportRow((int[2]){100 - p, p}, q, 2))
+        {
+            proposal->encounter.appear[k] = q[1];
+            changed++;
+        }
+    }
+    int s = craftOdds(nt->craft_fail), q[2] = {100 - craftOdds(t->craft_fail), craftOdds(t->craft_fail)};
+    if (supportRow((int[2]){100 - s, s}, q, 2))
+    {
+        t->craft_fail = 101 - q[1];
+        changed++;
+    }
+    return changed;
+}
+
+/**
+ * An iteration of the cross-entropy method: moves the proposal towards the elite games
+ * @return The level of the score reached by the elite games
+ */
+static int adapt(const Sample* samples, uint64_t n, double rho, SimRules* proposal, GameTables* t, const SimRules* nominal)
+{
+    const GameTables* nt = nominal->tables;
+    uint64_t          reached[8] = {0};
+    int               level;
+
+    // The highest level reached by a fraction rho of the games, or at least by MIN_ELITE of them
+    for (uint64_t i = 0; i < n; i++)
+        for (int l = 0; l <= samples[i].score && l <= target->levels; l++)
+            reached[l]++;
+    for (level = target->levels; level > 0; level--)
+        if (reached[level] >= (uint64_t)fmin(rho * n, MIN_ELITE))
+            break;
+
+    double spawn[6][6] = {{0}}, appear[ENC_KEYS][2] = {{0}}, craft[2] = {0}, item[3][3] = {{0}};
+    for (uint64_t i = 0; i < n; i++)
+    {
+        const Sample* s = &samples[i];
+        if (s->score < level)
+            continue;
+        for (int z = 0; z < 6; z++)
+            for (int o = 0; o < 6; o++)
+                spawn[z][o] += s->weight * s->draws.spawn[z][o];
+        for (int k = 0; k < ENC_KEYS; k++)
+            for (int a = 0; a < 2; a++)
+                appear[k][a] += s->weight * s->draws.appear[k][a];
+        for (int c = 0; c < 2; c++)
+            craft[c] += s->weight * s->draws.craft[c];
+        for (int r = 0; r < 3; r++)
+            for (int o = 0; o < 3; o++)
+                item[r][o] += s->weight * s->draws.item[r][o];
+    }
+
+    for (int z = 0; z < 6; z++)
+        adaptRow(spawn[z], nt->object_prop[z], t->object_prop[z], 6, 100);
+    for (int r = 0; r < 3; r++)
+        adaptRow(item[r], nt->craft_spread[r], t->craft_spread[r], 3, 100);
+
+    // The draws with two outcomes, adapted only when the nominal rules can give both
+    for (int k = 0; k < ENC_KEYS; k++)
+    {
+        int p = nominal->encounter.appear[k], q[2] = {100 - proposal->encounter.appear[k], proposal->encounter.appear[k]};
+        if (p > 0 && p < 100)
+        {
+            adaptRow(appear[k], (int[2]){100 - p, p}, q, 2, 100);
+            proposal->encounter.appear[k] = q[1];
+        }
+    }
+    int s = craftOdds(nt->craft_fail), q[2] = {100 - craftOdds(t->craft_fail), craftOdds(t->craft_fail)};
+    if (s > 0 && s < 100)
+    {
+        adaptRow(craft, (int[2]){100 - s, s}, q, 2, 100);
+        t->craft_fail = 101 - q[1];
+    }
+
+    if (!tablesCompile(t, "proposta"))
+        exit(-1);
+    return level;
+}
+
+// ------------------------------------OUTPUT-----------------------------------
+static const char* tags_zone  [6] = {"KITCHEN", "LIVING_ROOM", "SHED", "STREET", "ALONG_LAKE", "EXIT_CAMPING"};
+static const char* tags_object[6] = {"JUNK", "BANDAGE", "KNIFE", "GUN", "GASOLINE", "ADRENALINE"};
+
+static void printProposal(const SimRules* proposal, const GameTables* t, const SimRules* nominal)
+{
+    const GameTables* nt = nominal->tables;
+
+    printf("Proposta (tra parentesi i valori nominali):\n");
+    for (int z = 0; z < 6; z++)
+    {
+        printf("  %-12s", tags_zone[z]);
+        for (int o = 0; o < 6; o++)
+            printf(" %s %d (%d)", tags_object[o], t->object_prop[z][o], nt->object_prop[z][o]);
+        printf("\n");
+    }
+    printf("  Gieson     ");
+    for (int k = 0; k < 4; k++)
+        printf(" %d%% (%d%%)", proposal->encounter.appear[k], nominal->encounter.appear[k]);
+    printf("\n  CRAFT_FAIL  %d (%d)\n  CRAFT_SPREAD", t->craft_fail, nt->craft_fail);
+    for (int r = 0; r < 3; r++)
+        printf("  %d %d %d (%d %d %d)", t->craft_spread[r][0], t->craft_spread[r][1], t->craft_spread[r][2],
+               nt->craft_spread[r][0], nt->craft_spread[r][1], nt->craft_spread[r][2]);
+    printf("\n");
+}
+
+/**
+ * Writes the proposal in the format of TABLES_FILE, to be given again with --proposal
+ */
+static void saveProposal(const char* path, const SimRules* proposal, const GameTables* t)
+{
+    FILE* fptr = fopen(path, "w");
+
+    if (fptr == NULL)
+    {
+        fprintf(stderr, "Impossibile scrivere il file %s.\n", path);
+        exit(-1);
+    }
+    fprintf(fptr, "# Proposta di raresim per %s, da usare con:\n# --proposal %s --gieson %d,%d,%d,%d\n",
+            target->name, path, proposal->encounter.appear[0], proposal->encounter.appear[1],
+            proposal->encounter.appear[2], proposal->encounter.appear[3]);
+    fprintf(fptr, "OBJECT_PROP:\n");
+    for (int z = 0; z < 6; z++)
+        fprintf(fptr, "%-12s %d %d %d %d %d %d\n", tags_zone[z], t->object_prop[z][0], t->object_prop[z][1], t->object_prop[z][2],
+                t->object_prop[z][3], t->object_prop[z][4], t->object_prop[z][5]);
+    fprintf(fptr, "CRAFT_FAIL: %d\nCRAFT_SPREAD:\n", t->craft_fail);
+    for (int r = 0; r < 3; r++)
+        fprintf(fptr, "%d  %d %d %d\n", r + 1, t->craft_spread[r][0], t->craft_spread[r][1], t->craft_spread[r][2]);
+    fclose(fptr);
+    printf("Proposta scritta in %s\n", path);
+}
+
+static void printEstimate(const char* name, const Estimate* e)
+{
+    double p = mean(e), se = sqrt(variance(e) / e->games);
+
+    printf("%-24s %10llu partite in %7.2f s: p = %.4e ± %.2e", name, (unsigned long long)e->games, e->secs, p, se);
+    if (p > 0)
+        printf(" (errore relativo %.1f%%)", 100 * se / p);
+    printf(", %llu partite nel bersaglio\n", (unsigned long long)e->hits);
+}
+
+// -------------------------------------MAIN------------------------------------
+int main(int argc, char const *argv[])
+{
+    const char* tables      = TABLES_FILE;
+    const char* rules_name  = "classic";
+    const char* policy_name = "default";
+    const char* target_name = NULL;
+    const char* proposal_file = NULL;
+    const char* gieson      = NULL;
+    const char* save        = NULL;
+    uint64_t    games       = 1000000, naive = 0, ce_games = 100000;
+    int         zones       = 0, ce = -1, naive_set = FALSE;
+    double      rho         = 0.1;
+
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 1; i < argc; i += 2)
+    {
+        if (i + 1 == argc)
+        {
+            fprintf(stderr, "Manca il valore dell'opzione %s\n", argv[i]);
+            return -1;
+        }
+        if      (strcmp(argv[i], "--target")   == 0) target_name   = argv[i + 1];
+        else if (strcmp(argv[i], "--zones")    == 0) zones         = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--rules")    == 0) rules_name    = argv[i + 1];
+        else if (strcmp(argv[i], "--policy")   == 0) policy_name   = argv[i + 1];
+        else if (strcmp(argv[i], "--seed")     == 0) seed          = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--games")    == 0) games         = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--naive")    == 0) naive         = strtoull(argv[i + 1], NULL, 10), naive_set = TRUE;
+        else if (strcmp(argv[i], "--ce")       == 0) ce            = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--ce-games") == 0) ce_games      = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--rho")      == 0) rho           = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--threads")  == 0) threads       = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--tables")   == 0) tables        = argv[i + 1];
+        else if (strcmp(argv[i], "--proposal") == 0) proposal_file = argv[i + 1];
+        else if (strcmp(argv[i], "--gieson")   == 0) gieson        = argv[i + 1];
+        else if (strcmp(argv[i], "--save")     == 0) save          = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "Opzione sconosciuta: %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++)
+        if (target_name != NULL && strcmp(target_name, targets[t].name) == 0)
+            target = &targets[t];
+    if (target == NULL)
+    {
+        fprintf(stderr, "Bersaglio sconosciuto, scegliere tra:\n");
+        for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++)
+            fprintf(stderr, "  %-16s %s\n", targets[t].name, targets[t].description);
+        return -1;
+    }
+
+    const SimVariant* variant = simFindVariant(rules_name);
+    if (variant == NULL)
+    {
+        fprintf(stderr, "Regole sconosciute: %s\n", rules_name);
+        return -1;
+    }
+    if (strcmp(policy_name, "default") == 0)
+        policy = sim_policy_default;
+    else if (strcmp(policy_name, "random") == 0)
+        policy = sim_policy_random;
+    else
+    {
+        fprintf(stderr, "Politica sconosciuta: %s\n", policy_name);
+        return -1;
+    }
+    policy.event = observe;
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+    if (!naive_set)
+        naive = games;
+    if (ce < 0)
+        ce = proposal_file == NULL && gieson == NULL ? 10 : 0;
+
+    // The nominal rules, with their tables fixed: the ones of --proposal are loaded later in their place
+    tablesReload(tables); // If the file is missing the default rules are used
+    GameTables nominal_tables = *tablesCurrent(); // Copied, since the games run after more reloads
+    SimRules   nominal        = *variant->rules;
+    nominal.tables = &nominal_tables;
+
+    // The proposal draws with other odds, but plays the same game: same backpacks and same rules
+    GameTables t        = *nominal.tables;
+    SimRules   proposal = nominal;
+    if (proposal_file != NULL)
+    {
+        if (!tablesReload(proposal_file))
+        {
+            fprintf(stderr, "Impossibile caricare la proposta %s.\n", proposal_file);
+            return -1;
+        }
+        memcpy(t.object_prop,  tablesCurrent()->object_prop,  sizeof(t.object_prop));
+        memcpy(t.craft_spread, tablesCurrent()->craft_spread, sizeof(t.craft_spread));
+        t.craft_fail = tablesCurrent()->craft_fail;
+    }
+    if (gieson != NULL)
+    {
+        int odds[4];
+        if (sscanf(gieson, "%d,%d,%d,%d", &odds[0], &odds[1], &odds[2], &odds[3]) != 4)
+        {
+            fprintf(stderr, "--gieson vuole le probabilità delle quattro situazioni: BASE,FUORI,MORTO,MORTO_FUORI\n");
+            return -1;
+        }
+        for (int k = 0; k < 4; k++)
+            proposal.encounter.appear[k] = odds[k] < 0 ? 0 : odds[k] > 100 ? 100 : odds[k];
+    }
+    int changed = supportProposal(&proposal, &t, &nominal);
+    if (changed > 0)
+        fprintf(stderr, "Proposta corretta in %d righe: deve estrarre tutto e solo ciò che estraggono le regole nominali.\n", changed);
+    if (!tablesCompile(&t, "proposta"))
+        return -1;
+    proposal.tables  = &t;
+    proposal.nominal = &nominal;
+
+    // The map: the types of the zones drawn from the seed like addZone. The objects are drawn in every game
+    TypeZone types[SIM_MAX_ZONES];
+    SimRng   rng = {seed};
+    if (zones == 0)
+        zones = nominal.min_lands;
+    if (zones < 1 || zones > SIM_MAX_ZONES - 1)
+    {
+        fprintf(stderr, "Le zone devono essere tra 1 e %d, uscita esclusa.\n", SIM_MAX_ZONES - 1);
+        return -1;
+    }
+    for (int i = 0; i < zones; i++)
+        types[i] = simRand(&rng) % EXIT_CAMPING;
+    simMapInit(&map, types, zones);
+
+    printf("Bersaglio: %s, su una mappa di %d zone (regole %s, politica %s)\n\n", target->description, zones + 1,
+           nominal.name, policy_name);
+
+    // Each run plays its own range of games of the seed
+    uint64_t first = 0;
+    if (ce > 0)
+    {
+        Sample* samples = (Sample*)malloc(ce_games * sizeof(Sample));
+        if (samples == NULL)
+        {
+            fprintf(stderr, "Memoria insufficiente.\n");
+            return -1;
+        }
+        printf("Adattamento della proposta (entropia incrociata):\n");
+        for (int it = 1; it <= ce; it++)
+        {
+            Estimate est   = run(&proposal, first, ce_games, samples);
+            int      level = adapt(samples, ce_games, rho, &proposal, &t, &nominal);
+            first += ce_games;
+            printf("  iterazione %2d: livello %d di %d, %6llu partite nel bersaglio, p = %.3e\n", it, level,
+                   target->levels, (unsigned long long)est.hits, mean(&est));
+        }
+        free(samples);
+        printf("\n");
+    }
+    printProposal(&proposal, &t, &nominal);
+    if (save != NULL)
+        saveProposal(save, &proposal, &t);
+    printf("\n");
+
+    Estimate is = run(&proposal, first, games, NULL);
+    first += games;
+    printEstimate("Campionamento pesato", &is);
+    printf("%-24s peso medio %.3f, partite equivalenti %.0f\n", "", is.weights / is.games,
+           is.weights2 > 0 ? is.weights * is.weights / is.weights2 : 0);
+    if (naive == 0)
+        return 0;
+
+    Estimate direct = run(&nominal, first, naive, NULL);
+    printEstimate("Campionamento diretto", &direct);
+
+    // The variance of the direct estimate, p(1-p), is taken with the best p known
+    double p = is.hits > 0 ? mean(&is) : mean(&direct), v_is = variance(&is), v_direct = p * (1 - p);
+    if (p <= 0 || v_is <= 0)
+    {
+        printf("\nBersaglio mai raggiunto: servono più partite.\n");
+        return 0;
+    }
+    double cost_is = is.secs / is.games, cost_direct = direct.secs / direct.games;
+    printf("\nRiduzione della varianza: %.1f volte a parità di partite, %.1f volte a parità di tempo\n",
+           v_direct / v_is, v_direct * cost_direct / (v_is * cost_is));
+    printf("Per un errore relativo del 10%%: %.3g partite dirette (%.3g s), %.3g pesate (%.3g s)\n",
+           100 * v_direct / (p * p), 100 * v_direct / (p * p) * cost_direct,
+           100 * v_is / (p * p), 100 * v_is / (p * p) * cost_is);
+    return 0;
+}
@@ -0,0 +1,188 @@
+/******************************************************************************/
+/*!
+ * @file   saveimport.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Imports old saves (GameSave.save and archives of them) into the save store
+ *
+ * Every file is memory-mapped and parsed with saveParse; an archive is a file with
+ * many saves one after the other. A save is imported with the name of its file as key
+ * (followed by -N for the N-th save of an archive), and the index of the store is
+ * updated once for every IMPORT_BATCH saves. The malformed saves are reported with
+ * their position and skipped: after an error the rest of an archive can not be trusted,
+ * so the import of that file stops there.
+ *
+ * Compilation: gcc -O2 -o saveimport tools/saveimport.c saveparse.c savestore.c -Wall -std=c11 -pthread
+ * Usage:       ./saveimport [--dir DIR] [--prefix P] [--check] FILE...
+ *              --check only parses the files, without importing them
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../gamelib.h"
+#include "../saveparse.h"
+#include "../savestore.h"
+
+#define IMPORT_BATCH 4096
+
+static char     batch[IMPORT_BATCH][SAVE_KEY_LEN];
+static int      batched   = 0;
+static uint64_t imported  = 0, malformed = 0, bytes = 0;
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void flushBatch()
+{
+    if (batched > 0 && !saveStoreCommitBatch(batch, batched))
+        fprintf(stderr, "Errore nell'aggiornamento dell'indice dei salvataggi.\n");
+    batched = 0;
+}
+
+/**
+ * Builds the key of a save from the name of its file, replacing the characters not allowed in a key
+ * @param key    Where the key will be written, padded with '\0'
+ * @param prefix Prefix of the key
+ * @param path   The file
+ * @param n      Position of the save in an archive, 0 for a file with a single save
+ */
+static void makeKey(char key[SAVE_KEY_LEN], const char* prefix, const char* path, int n)
+{
+    const char* base   = strrchr(path, '/') != NULL ? strrchr(path, '/') + 1 : path;
+    const char* dot    = strrchr(base, '.');
+    int         len    = dot != NULL && dot != base ? (int)(dot - base) : (int)strlen(base);
+    char        suffix[16] = "";
+
+    if (n > 0)
+        snprintf(suffix, sizeof(suffix), "-%d", n);
+
+    int room = SAVE_KEY_LEN - 1 - (int)strlen(prefix) - (int)strlen(suffix);
+    if (len > room)
+        len = room > 0 ? room : 0;
+
+    memset(key, 0, SAVE_KEY_LEN);
+    snprintf(key, SAVE_KEY_LEN, "%s%.*s%s", prefix, len, base, suffix);
+    for (char* k = key; *k; k++)
+        if (!(*k >= 'a' && *k <= 'z') && !(*k >= 'A' && *k <= 'Z') && !(*k >= '0' && *k <= '9') && *k != '-')
+            *k = '_';
+}
+
+static void importFile(const char* path, const char* prefix, int check)
+{
+    struct stat st;
+    int         fd = open(path, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        fprintf(stderr, "%s: impossibile leggere il file.\n", path);
+        if (fd >= 0)
+            close(fd);
+        malformed++;
+        return;
+    }
+
+    const char* buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (buf == MAP_FAILED)
+    {
+        fprintf(stderr, "%s: impossibile leggere il file.\n", path);
+        malformed++;
+        return;
+    }
+    posix_madvise((void*)buf, st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    size_t off = 0;
+    int    n   = 0;
+    while (off < (size_t)st.st_size)
+    {
+        SaveData  data;
+        SaveError err;
+        size_t    used = saveParse(buf + off, st.st_size - off, &data, &err);
+
+        if (used == 0)
+        {
+            int line = err.line;
+            for (size_t i = 0; i < off; i++) // Lines of the saves before the malformed one
+                line += buf[i] == '\n';
+            fprintf(stderr, "%s:%d:%d: %s\n", path, line, err.column, err.message);
+            malformed++;
+            break;
+        }
+
+        // A file is an archive when the first save does not reach its end
+        n++;
+        if (!check)
+        {
+            char key[SAVE_KEY_LEN], out[600];
+            makeKey(key, prefix, path, n == 1 && used == (size_t)st.st_size ? 0 : n);
+
+            FILE* fptr = saveStorePath(key, out, sizeof(out)) ? fopen(out, "w") : NULL;
+            if (fptr == NULL || fwrite(buf + off, 1, used, fptr) != used)
+                fprintf(stderr, "%s: impossibile scrivere %s.\n", path, out);
+            else
+            {
+                memcpy(batch[batched++], key, SAVE_KEY_LEN);
+                if (batched == IMPORT_BATCH)
+                    flushBatch();
+            }
+            if (fptr != NULL)
+                fclose(fptr);
+        }
+        imported++;
+        off   += used;
+        bytes += used;
+    }
+    munmap((void*)buf, st.st_size);
+}
+
+int main(int argc, char const *argv[])
+{
+    const char* prefix = "";
+    int         check  = FALSE;
+    int         i      = 1;
+
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+    {
+        if (strcmp(argv[i], "--check") == 0)
+            check = TRUE;
+        else if (i + 1 >= argc)
+        {
+            fprintf(stderr, "Manca il valore dell'opzione %s\n", argv[i]);
+            return -1;
+        }
+        else if (strcmp(argv[i], "--dir") == 0)
+            saveStoreSetDir(argv[++i]);
+        else if (strcmp(argv[i], "--prefix") == 0)
+            prefix = argv[++i];
+        else
+        {
+            fprintf(stderr, "Opzione sconosciuta: %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (i == argc)
+    {
+        fprintf(stderr, "Utilizzo: %s [--dir DIR] [--prefix P] [--check] FILE...\n", argv[0]);
+        return -1;
+    }
+
+    double start = now();
+    for (; i < argc; i++)
+        importFile(argv[i], prefix, check);
+    if (!check)
+        flushBatch();
+    double total = now() - start;
+
+    printf("%s: %llu salvataggi, %llu errori\n", check ? "Controllati" : "Importati",
+           (unsigned long long)imported, (unsigned long long)malformed);
+    printf("%.1f MB in %.3f s (%.0f MB/s)\n", bytes / 1e6, total, bytes / 1e6 / total);
+    return malformed > 0;
+}
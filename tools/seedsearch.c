@@ -0,0 +1,542 @@
+/******************************************************************************/
+/*!
+ * @file   seedsearch.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Searches the seeds of the games whose outcome matches some conditions
+ *
+ * The games of a range of seeds are played on the same map with the same policy, split in
+ * chunks among the threads. The observer of the policy (SimPolicy.event) collects the facts
+ * of each player: how the player left the map, where, with which backpack, which item was used
+ * against Gieson. A game matches when all the --where conditions hold on its facts.
+ *
+ * The chunks are taken in order and the threads stop taking them once enough games matched:
+ * every game before the last chunk taken has been played, so the games printed are always the
+ * first ones of the range that match, whatever the number of threads.
+ *
+ * For each game found a replay file is written: the seed and the policy, followed by the map
+ * with the objects of that game, in the format of GameSave.save. --replay plays it again,
+ * telling every action.
+ *
+ * Conditions: PLAYER.FIELD OP VALUE, with PLAYER GIACOMO or MARZIA and OP one of = != < > <= >=
+ *   state           DEAD, INJURED or ALIVE at the end of the game
+ *   escaped         1 if the player escaped
+ *   zone            where the player left the map: the zone of the fatal encounter for a death,
+ *                   EXIT_CAMPING for an escape, NONE if the game did not end
+ *   used            item used in the last encounter with Gieson (NOTHING if none)
+ *   encounters      encounters with Gieson
+ *   gasoline_turns  turns of gasoline left when the player left the map
+ *   JUNK ... ADRENALINE  objects in the backpack when the player left the map (before the fatal encounter for a death)
+ * and GAME.turns for the turns of the game.
+ *
+ * Compilation: gcc -O2 -o seedsearch tools/seedsearch.c sim.c tables.c saveparse.c -Wall -std=c11 -pthread
+ * Usage:       ./seedsearch --where COND [--where COND]... [--matches N] [--games N] [--first N] [--seed S]
+ *                           [--zones N | --map FILE] [--policy default|random] [--threads N] [--tables FILE] [--output DIR]
+ *              ./seedsearch --replay FILE [--where COND]... [--tables FILE]
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../sim.h"
+#include "../saveparse.h"
+
+#define CHUNK    4096 /**<Games taken by a thread at a time */
+#define MAX_COND 32
+
+// ------------------------------------FACTS------------------------------------
+enum {F_STATE, F_ESCAPED, F_ZONE, F_USED, F_ENCOUNTERS, F_GASOLINE_TURNS, F_BACKPACK, F_FIELDS = F_BACKPACK + 6};
+#define F_TURNS 0 /**<Field of GAME */
+#define GAME    2 /**<"Player" of the fields of the whole game */
+
+static const char* field_names[F_FIELDS] = {
+    "state", "escaped", "zone", "used", "encounters", "gasoline_turns",
+    "JUNK", "BANDAGE", "KNIFE", "GUN", "GASOLINE", "ADRENALINE"
+};
+static const char* tags_zone  [7] = {"KITCHEN", "LIVING_ROOM", "SHED", "STREET", "ALONG_LAKE", "EXIT_CAMPING", "NONE"};
+static const char* tags_object[7] = {"JUNK", "BANDAGE", "KNIFE", "GUN", "GASOLINE", "ADRENALINE", "NOTHING"};
+static const char* tags_state [3] = {"DEAD", "INJURED", "ALIVE"};
+static const char* tags_player[3] = {"GIACOMO", "MARZIA", "GAME"};
+#define NO_ZONE 6
+
+typedef struct {
+    int32_t p[2][F_FIELDS];
+    int32_t turns;
+    int32_t zone    [2];    /**<Zone of the last encounter with Gieson */
+    int32_t backpack[2][6]; /**<Backpack at the last encounter with Gieson */
+} Facts;
+
+typedef enum {OP_EQ, OP_NE, OP_LT, OP_GT, OP_LE, OP_GE} Op;
+
+typedef struct {
+    int     player;
+    int     field;
+    Op      op;
+    int32_t value;
+} Cond;
+
+static Cond conds[MAX_COND];
+static int  n_conds = 0;
+
+/**
+ * Parses a condition, PLAYER.FIELD OP VALUE
+ * @return FALSE if it is not valid
+ */
+static int parseCond(const char* text, Cond* c)
+{
+    static const char* ops[] = {"=", "!=", "<", ">", "<=", ">="};
+    char               name[64], *dot, *value;
+    size_t             len = strcspn(text, "<>=!");
+
+    if (len == 0 || len >= sizeof(name) || text[len] == '\0')
+        return FALSE;
+    memcpy(name, text, len);
+    name[len] = '\0';
+    if ((dot = strchr(name, '.')) == NULL)
+        return FALSE;
+    *dot++ = '\0';
+
+    for (c->player = 0; c->player < 3 && strcmp(name, tags_player[c->player]) != 0; c->player++);
+    if (c->player == 3)
+        return FALSE;
+    if (c->player == GAME)
+    {
+        if (strcmp(dot, "turns") != 0)
+            return FALSE;
+        c->field = F_TURNS;
+    }
+    else
+    {
+        for (c->field = 0; c->field < F_FIELDS && strcmp(dot, field_names[c->field]) != 0; c->field++);
+        if (c->field == F_FIELDS)
+            return FALSE;
+    }
+
+    value = (char*)text + len + strspn(text + len, "<>=!");
+    c->op = OP_GE + 1;
+    for (int o = 0; o <= OP_GE; o++)
+        if ((int)strlen(ops[o]) == value - (text + len) && strncmp(text + len, ops[o], value - (text + len)) == 0)
+            c->op = o;
+    if (c->op > OP_GE)
+        return FALSE;
+
+    // The values of state, zone and used are given by name
+    const char** tags = NULL;
+    int          n    = 0;
+    if (c->player != GAME && c->field == F_STATE)
+        tags = tags_state, n = 3;
+    else if (c->player != GAME && c->field == F_ZONE)
+        tags = tags_zone, n = 7;
+    else if (c->player != GAME && c->field == F_USED)
+        tags = tags_object, n = 7;
+    for (int v = 0; v < n; v++)
+        if (strcmp(value, tags[v]) == 0)
+        {
+            c->value = v;
+            return TRUE;
+        }
+
+    char* end;
+    c->value = strtol(value, &end, 10);
+    return *value != '\0' && *end == '\0';
+}
+
+static int matches(const Facts* f)
+{
+    for (int i = 0; i < n_conds; i++)
+    {
+        const Cond* c = &conds[i];
+        int32_t     v = c->player == GAME ? f->turns : f->p[c->player][c->field];
+        int         ok;
+
+        switch (c->op)
+        {
+            case OP_EQ: ok = v == c->value; break;
+            case OP_NE: ok = v != c->value; break;
+            case OP_LT: ok = v <  c->value; break;
+            case OP_GT: ok = v >  c->value; break;
+            case OP_LE: ok = v <= c->value; break;
+            default:    ok = v >= c->value;
+        }
+        if (!ok)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+// ----------------------------------OBSERVER-----------------------------------
+// Context of the policy of a thread
+typedef struct {
+    SimRng rng;      /**<Choices of the random policy, first as sim_policy_random wants it */
+    Facts  facts;
+    int    verbose;  /**<TRUE to tell the game, for --replay */
+} Observer;
+
+static const char* tags_action[7] = {
+    "", "avanza", "scopre l'oggetto", "raccoglie l'oggetto", "si cura", "usa l'adrenalina", "usa le cianfrusaglie"
+};
+
+static void observe(const SimGame* g, int player, SimEvent ev, ObjType item, void* ctx)
+{
+    Observer*        o   = ctx;
+    Facts*           f   = &o->facts;
+    const SimPlayer* myP = &g->p[player];
+
+    if (ev == SIM_EV_GIESON)
+    {
+        f->zone[player] = myP->pos == SIM_OUT ? EXIT_CAMPING : g->type[myP->pos];
+        for (int i = 0; i < 6; i++)
+            f->backpack[player][i] = myP->backpack[i];
+        f->p[player][F_USED] = item;
+        f->p[player][F_ENCOUNTERS]++;
+        if (o->verbose)
+            printf("          Gieson appare a %s, che usa: %s\n", tags_player[player], tags_object[item]);
+        return;
+    }
+
+    // SIM_EV_LEFT: the encounter, if any, has already been resolved
+    int dead = myP->state == DEAD;
+    f->p[player][F_ZONE]           = dead ? f->zone[player] : EXIT_CAMPING;
+    f->p[player][F_GASOLINE_TURNS] = g->gasoline_turns;
+    for (int i = 0; i < 6; i++)
+        f->p[player][F_BACKPACK + i] = dead ? f->backpack[player][i] : myP->backpack[i];
+    if (o->verbose)
+        printf("          %s %s\n", tags_player[player], dead ? "muore" : "fugge dal campeggio");
+}
+
+static void resetFacts(Facts* f)
+{
+    memset(f, 0, sizeof(*f));
+    for (int p = 0; p < 2; p++)
+    {
+        f->p[p][F_ZONE] = NO_ZONE;
+        f->p[p][F_USED] = NOTHING;
+    }
+}
+
+static void finishFacts(Facts* f, const SimResult* res)
+{
+    for (int p = 0; p < 2; p++)
+    {
+        f->p[p][F_STATE]   = res->state[p];
+        f->p[p][F_ESCAPED] = res->escaped[p];
+    }
+    f->turns = res->turns;
+}
+
+// -----------------------------------POLICIES----------------------------------
+static SimPolicy policy;
+
+// Wraps the actions of the policy of --replay to tell them
+static SimAction tellAction(const SimGame* g, int player, int moves, void* ctx)
+{
+    const SimPlayer* myP    = &g->p[player];
+    SimAction        action = policy.action(g, player, moves, ctx);
+
+    printf("Turno %-4u %s nella zona %d (%s), %d %s: %s\n", g->turns + 1, tags_player[player], myP->pos + 1,
+           tags_zone[g->type[myP->pos]], moves, moves == 1 ? "mossa" : "mosse", tags_action[action]);
+    return action;
+}
+
+static int setPolicy(const char* name)
+{
+    if (strcmp(name, "default") == 0)
+        policy = sim_policy_default;
+    else if (strcmp(name, "random") == 0)
+        policy = sim_policy_random;
+    else
+        return FALSE;
+    policy.event = observe;
+    return TRUE;
+}
+
+/**
+ * Plays a game, filling the facts of the observer
+ */
+static void play(const SimMap* map, const SimPolicy* p, Observer* o, uint64_t game_seed)
+{
+    SimPolicy with_ctx = *p;
+    SimResult res;
+
+    with_ctx.ctx = o;
+    o->rng.state = simPolicySeed(game_seed);
+    resetFacts(&o->facts);
+    simPlay(map, &with_ctx, game_seed, &res);
+    finishFacts(&o->facts, &res);
+}
+
+// ------------------------------------SEARCH-----------------------------------
+static SimMap           map;
+static uint64_t         seed = 1, first = 0, games = 1000000000;
+static uint64_t         wanted = 10;
+static _Atomic uint64_t next_chunk;
+static _Atomic uint64_t found;
+static _Atomic uint64_t played;
+
+static pthread_mutex_t  hits_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t*        hits      = NULL;
+static size_t           n_hits = 0, hits_cap = 0;
+
+static void* worker(void* arg)
+{
+    Observer o = {0};
+    (void)arg;
+
+    for (;;)
+    {
+        if (atomic_load(&found) >= wanted)
+            break;
+        uint64_t start = atomic_fetch_add(&next_chunk, CHUNK);
+        if (start >= games)
+            break;
+        uint64_t end = start + CHUNK < games ? start + CHUNK : games;
+
+        for (uint64_t i = start; i < end; i++)
+        {
+            play(&map, &policy, &o, simGameSeed(seed, first + i));
+            if (!matches(&o.facts))
+                continue;
+
+            pthread_mutex_lock(&hits_lock);
+            if (n_hits == hits_cap)
+            {
+                hits_cap = hits_cap ? 2 * hits_cap : 64;
+                hits     = realloc(hits, hits_cap * sizeof(uint64_t));
+                if (hits == NULL)
+                {
+                    fprintf(stderr, "Memoria insufficiente.\n");
+                    exit(-1);
+                }
+            }
+            hits[n_hits++] = first + i;
+            pthread_mutex_unlock(&hits_lock);
+            atomic_fetch_add(&found, 1);
+        }
+        atomic_fetch_add(&played, end - start);
+    }
+    return NULL;
+}
+
+static int byIndex(const void* x, const void* y)
+{
+    uint64_t a = *(const uint64_t*)x, b = *(const uint64_t*)y;
+    return (a > b) - (a < b);
+}
+
+/**
+ * Writes the replay file of a game: its seed, the policy and the map with the objects of the game
+ */
+static void writeReplay(const char* dir, uint64_t index, const char* policy_name)
+{
+    char  path[600];
+    FILE* fptr;
+
+    snprintf(path, sizeof(path), "%s/%llu.replay", dir, (unsigned long long)index);
+    if ((fptr = fopen(path, "w")) == NULL)
+    {
+        fprintf(stderr, "Impossibile scrivere il file %s.\n", path);
+        exit(-1);
+    }
+    fprintf(fptr, "SEED: %llu\nPOLICY: %s\n", (unsigned long long)simGameSeed(seed, index), policy_name);
+    simWriteSave(&map, simGameSeed(seed, index), fptr);
+    fprintf(fptr, "\n");
+    fclose(fptr);
+    printf("  %s\n", path);
+}
+
+/**
+ * The map of a save: the types of its zones, the exit excluded since simMapInit appends it
+ */
+static void saveMap(const SaveData* save)
+{
+    TypeZone types[SAVE_MAX_ZONES];
+
+    for (int z = 0; z + 1 < save->zones; z++)
+        types[z] = save->type[z];
+    simMapInit(&map, types, save->zones - 1);
+}
+
+// ------------------------------------REPLAY-----------------------------------
+/**
+ * Plays again the game of a replay file, telling every action
+ * @return 0 if the game matches the conditions
+ */
+static int replay(const char* path)
+{
+    FILE*              fptr = fopen(path, "r");
+    char               buf[8192], name[32];
+    unsigned long long game_seed;
+    SaveData           save;
+    SaveError          err;
+    int                used;
+
+    if (fptr == NULL)
+    {
+        fprintf(stderr, "Impossibile aprire il file %s.\n", path);
+        return -1;
+    }
+    size_t len = fread(buf, 1, sizeof(buf) - 1, fptr);
+    fclose(fptr);
+    buf[len] = '\0';
+
+    if (sscanf(buf, "SEED: %llu\nPOLICY: %31s\n%n", &game_seed, name, &used) != 2 || !setPolicy(name))
+    {
+        fprintf(stderr, "%s: intestazione non valida.\n", path);
+        return -1;
+    }
+    if (saveParse(buf + used, len - used, &save, &err) == 0)
+    {
+        fprintf(stderr, "%s: riga %d, colonna %d: %s\n", path, err.line + 2, err.column, err.message);
+        return -1;
+    }
+
+    // The objects are drawn again from the seed, as in the game found: they are the ones of the file only with the same tables
+    saveMap(&save);
+    SimRng rng = {game_seed};
+    for (int z = 0; z < save.zones; z++)
+        if (simRandomObj(&rng, tablesCurrent(), save.type[z]) != save.object[z])
+        {
+            fprintf(stderr, "%s: gli oggetti non corrispondono, le tabelle sono diverse da quelle della ricerca.\n", path);
+            return -1;
+        }
+
+    Observer o = {0};
+    SimPolicy told = policy;
+    told.action = tellAction;
+    o.verbose   = TRUE;
+    play(&map, &told, &o, game_seed);
+
+    printf("\nFine dopo %d turni\n", o.facts.turns);
+    for (int p = 0; p < 2; p++)
+    {
+        const int32_t* f = o.facts.p[p];
+        printf("%-8s %-8s zona %-12s usato %-10s incontri %d benzina %d zaino",
+               tags_player[p], tags_state[f[F_STATE]], tags_zone[f[F_ZONE]], tags_object[f[F_USED]],
+               f[F_ENCOUNTERS], f[F_GASOLINE_TURNS]);
+        for (int i = 0; i < 6; i++)
+            printf(" %d", f[F_BACKPACK + i]);
+        printf("\n");
+    }
+    if (n_conds > 0)
+        printf("\nLe condizioni %s.\n", matches(&o.facts) ? "sono soddisfatte" : "NON sono soddisfatte");
+    return n_conds > 0 && !matches(&o.facts);
+}
+
+// -------------------------------------MAIN------------------------------------
+int main(int argc, char const *argv[])
+{
+    const char* tables      = TABLES_FILE;
+    const char* map_file    = NULL;
+    const char* replay_file = NULL;
+    const char* output      = "replays";
+    const char* policy_name = "default";
+    int         zones       = MAX_LANDS;
+    int         threads     = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if      (strcmp(argv[i], "--where")   == 0)
+        {
+            if (n_conds == MAX_COND || !parseCond(argv[i + 1], &conds[n_conds++]))
+            {
+                fprintf(stderr, "Condizione non valida: %s\n", argv[i + 1]);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--matches") == 0) wanted      = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--games")   == 0) games       = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--first")   == 0) first       = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--seed")    == 0) seed        = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--zones")   == 0) zones       = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--map")     == 0) map_file    = argv[i + 1];
+        else if (strcmp(argv[i], "--policy")  == 0) policy_name = argv[i + 1];
+        else if (strcmp(argv[i], "--threads") == 0) threads     = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--tables")  == 0) tables      = argv[i + 1];
+        else if (strcmp(argv[i], "--output")  == 0) output      = argv[i + 1];
+        else if (strcmp(argv[i], "--replay")  == 0) replay_file = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "Opzione sconosciuta: %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    tablesReload(tables); // If the file is missing the default rules are used
+
+    if (replay_file != NULL)
+        return replay(replay_file);
+
+    if (n_conds == 0)
+    {
+        fprintf(stderr, "Serve almeno una condizione (--where).\n");
+        return -1;
+    }
+    if (!setPolicy(policy_name))
+    {
+        fprintf(stderr, "Politica sconosciuta: %s\n", policy_name);
+        return -1;
+    }
+
+    // The map: the types of the zones of a save, or drawn from the seed like addZone. The objects are drawn in every game
+    if (map_file != NULL)
+    {
+        SaveData  save;
+        SaveError err;
+        if (!saveParseFile(map_file, &save, &err))
+        {
+            fprintf(stderr, "%s: riga %d, colonna %d: %s\n", map_file, err.line, err.column, err.message);
+            return -1;
+        }
+        saveMap(&save);
+    }
+    else
+    {
+        TypeZone types[SAVE_MAX_ZONES];
+        SimRng   rng = {seed};
+
+        if (zones < 1 || zones > SAVE_MAX_ZONES - 1)
+        {
+            fprintf(stderr, "Le zone devono essere tra 1 e %d, uscita esclusa.\n", SAVE_MAX_ZONES - 1);
+            return -1;
+        }
+        for (int i = 0; i < zones; i++)
+            types[i] = simRand(&rng) % EXIT_CAMPING;
+        simMapInit(&map, types, zones);
+    }
+
+    if (threads < 1)
+        threads = 1;
+
+    struct timespec start, end;
+    pthread_t*      tids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < threads; t++)
+        pthread_create(&tids[t], NULL, worker, NULL);
+    for (int t = 0; t < threads; t++)
+        pthread_join(tids[t], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    qsort(hits, n_hits, sizeof(uint64_t), byIndex);
+    if (n_hits > wanted)
+        n_hits = wanted;
+
+    printf("%llu partite giocate in %.2f s (%.2f milioni al secondo), %zu trovate\n", (unsigned long long)played, secs,
+           played / secs / 1e6, n_hits);
+    if (n_hits > 0 && mkdir(output, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Impossibile creare la cartella %s.\n", output);
+        return -1;
+    }
+    for (size_t h = 0; h < n_hits; h++)
+    {
+        printf("partita %llu, seme %llu\n", (unsigned long long)hits[h], (unsigned long long)simGameSeed(seed, hits[h]));
+        writeReplay(output, hits[h], policy_name);
+    }
+    return n_hits > 0 ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+/******************************************************************************/
+/*!
+ * @file   sensitivity.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Measures the effect of small changes of the tables and of the odds of Gieson
+ *
+ * Every game is played with the baseline rules and with each perturbed copy of them, all
+ * on the same seed (common random numbers): a change of OBJECT_PROP only changes the object
+ * given by the same draw, so the two games of a pair go apart only where the change matters
+ * and the difference of their outcomes has a far smaller variance than the one of two
+ * independent runs. The effects are estimated on these paired differences, in rounds of
+ * games, until the 95% confidence interval of every effect is narrower than the precision.
+ *
+ * A parameter is given as ZONE:OBJECT:DELTA, which moves DELTA points of OBJECT_PROP from JUNK
+ * to OBJECT in the row of ZONE (from the largest other object when OBJECT is JUNK), or as
+ * exit:DELTA, dead:DELTA, base:DELTA for the odds of Gieson of callGieson.
+ * Without --param every cell of OBJECT_PROP and every odds is moved by 5 points, where valid.
+ *
+ * Compilation: gcc -O2 -o sensitivity tools/sensitivity.c sim.c tables.c -Wall -std=c11 -pthread -lm
+ * Usage:       ./sensitivity [--param P[,P...]] [--precision PP] [--max-games N] [--batch N] [--zones N]
+ *                            [--threads N] [--seed S] [--tables FILE] [--rules NAME]
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../sim.h"
+
+#define MAX_PARAMS 64
+#define Z_95       1.96
+
+// The outcomes measured for each game: both escaped, only one escaped, players dead (0, 1 or 2)
+enum {M_BOTH, M_ONE, M_DEAD, METRICS};
+
+typedef struct {
+    char     name[48];
+    SimRules rules;                /**<Perturbed copy of the baseline, with its own tables */
+    GameTables tables;
+} Config;
+
+// Sums over the games, kept as integers so that the threads can be merged exactly
+typedef struct {
+    int64_t x [METRICS], x2 [METRICS]; /**<Outcomes of the configuration */
+    int64_t d [METRICS], d2 [METRICS]; /**<Differences from the baseline in the same game */
+} Sums;
+
+typedef struct {
+    const SimMap* map;
+    uint64_t      seed;
+    uint64_t      first, count;
+    int           n_configs;
+    Sums          sums[MAX_PARAMS + 1];
+} Job;
+
+static Config configs[MAX_PARAMS + 1]; /**<configs[0] is the baseline */
+
+static void outcome(const SimResult* res, int m[METRICS])
+{
+    int escaped = res->escaped[0] + res->escaped[1];
+
+    m[M_BOTH] = escaped == 2;
+    m[M_ONE]  = escaped == 1;
+    m[M_DEAD] = (res->state[0] == DEAD) + (res->state[1] == DEAD);
+}
+
+static void* worker(void* arg)
+{
+    Job* job = (Job*)arg;
+
+    for (uint64_t i = job->first; i < job->first + job->count; i++)
+    {
+        uint64_t  game_seed = simGameSeed(job->seed, i);
+        SimResult res;
+        int       base[METRICS], m[METRICS];
+
+        for (int c = 0; c < job->n_configs; c++)
+        {
+            simPlayRules(&configs[c].rules, job->map, &sim_policy_default, game_seed, &res);
+            outcome(&res, c == 0 ? base : m);
+
+            Sums* s = &job->sums[c];
+            for (int k = 0; k < METRICS; k++)
+            {
+                int x = c == 0 ? base[k] : m[k];
+                int d = x - base[k];
+                s->x [k] += x;
+                s->x2[k] += x * x;
+                s->d [k] += d;
+                s->d2[k] += d * d;
+            }
+        }
+    }
+    return NULL;
+}
+
+// ---------------------------------PARAMETERS----------------------------------
+static const char* tags_zone[6] = {"KITCHEN", "LIVING_ROOM", "SHED", "STREET", "ALONG_LAKE", "EXIT_CAMPING"};
+static const char* tags_obj [6] = {"JUNK", "BANDAGE", "KNIFE", "GUN", "GASOLINE", "ADRENALINE"};
+
+static int findTag(const char** tags, const char* name, size_t len)
+{
+    for (int i = 0; i < 6; i++)
+        if (strlen(tags[i]) == len && strncmp(tags[i], name, len) == 0)
+            return i;
+    return -1;
+}
+
+/**
+ * Builds the configuration of a parameter from the baseline
+ * @param  c    The configuration to fill
+ * @param  spec The parameter, ZONE:OBJECT:DELTA or exit|dead|base:DELTA
+ * @return      TRUE if the parameter is valid and gives valid rules
+ */
+static int makeConfig(Config* c, const char* spec)
+{
+    const char* colon = strchr(spec, ':');
+    const char* last  = strrchr(spec, ':');
+    int         delta;
+
+    *c = configs[0];
+    snprintf(c->name, sizeof(c->name), "%s", spec);
+    if (colon == NULL || sscanf(last + 1, "%d", &delta) != 1)
+        return FALSE;
+
+    if (colon == last)
+    {
+        unsigned int* odds = strncmp(spec, "exit:", 5) == 0 ? &c->rules.gieson_exit :
+                             strncmp(spec, "dead:", 5) == 0 ? &c->rules.gieson_dead :
+                             strncmp(spec, "base:", 5) == 0 ? &c->rules.gieson_base : NULL;
+        if (odds == NULL || (int)*odds + delta < 0 || (int)*odds + delta > 100)
+            return FALSE;
+        *odds += delta;
+        c->rules.encounter = (EncounterTable)ENCOUNTER_TABLE(c->rules.gieson_exit, c->rules.gieson_dead, c->rules.gieson_base,
+                                                             40, c->rules.gasoline_turns);
+    }
+    else
+    {
+        int z = findTag(tags_zone, spec, colon - spec);
+        int o = findTag(tags_obj, colon + 1, last - colon - 1);
+        if (z < 0 || o < 0)
+            return FALSE;
+
+        int* row  = c->tables.object_prop[z];
+        int  from = JUNK;
+        if (o == JUNK)
+            for (int k = from = 1; k < 6; k++)
+                from = row[k] > row[from] ? k : from;
+
+        row[o]    += delta;
+        row[from] -= delta;
+        if (row[o] < 0 || row[from] < 0 || !tablesCompile(&c->tables, spec))
+            return FALSE;
+    }
+    c->rules.tables = &c->tables;
+    return TRUE;
+}
+
+/**
+ * The parameters used without --param: every cell of OBJECT_PROP and every odds of Gieson moved by +5
+ * @return The number of configurations made, baseline included
+ */
+static int defaultConfigs()
+{
+    int  n = 1;
+    char spec[48];
+
+    for (int z = 0; z < 6; z++)
+        for (int o = 0; o < 6 && n <= MAX_PARAMS; o++)
+        {
+            snprintf(spec, sizeof(spec), "%s:%s:+5", tags_zone[z], tags_obj[o]);
+            n += makeConfig(&configs[n], spec); // Skipped when the row can not give the points
+        }
+
+    const char* odds[3] = {"exit:+5", "dead:+5", "base:+5"};
+    for (int k = 0; k < 3 && n <= MAX_PARAMS; k++)
+        n += makeConfig(&configs[n], odds[k]);
+    return n;
+}
+
+// ----------------------------------STATISTICS---------------------------------
+// A death is counted per player, so its rate is half the count per game
+static const double scale[METRICS] = {1, 1, 0.5};
+
+static double variance(int64_t sum, int64_t sum2, uint64_t n)
+{
+    double mean = (double)sum / n;
+    return n > 1 ? ((double)sum2 / n - mean * mean) * n / (n - 1) : 0;
+}
+
+/**
+ * Half width of the 95% confidence interval of an effect, from the variance of the paired differences
+ */
+static double halfWidth(const Sums* s, int k, uint64_t n)
+{
+    return Z_95 * scale[k] * sqrt(variance(s->d[k], s->d2[k], n) / n);
+}
+
+int main(int argc, char const *argv[])
+{
+    const char* params    = NULL;
+    const char* tables    = TABLES_FILE;
+    const char* rules     = "classic";
+    double      precision = 0.1;
+    uint64_t    max_games = 10000000;
+    uint64_t    batch     = 20000;
+    uint64_t    seed      = 1;
+    int         zones     = 0;
+    int         threads   = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if      (strcmp(argv[i], "--param")     == 0) params    = argv[i + 1];
+        else if (strcmp(argv[i], "--precision") == 0) precision = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--max-games") == 0) max_games = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--batch")     == 0) batch     = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--zones")     == 0) zones     = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--threads")   == 0) threads   = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seed")      == 0) seed      = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--tables")    == 0) tables    = argv[i + 1];
+        else if (strcmp(argv[i], "--rules")     == 0) rules     = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "Opzione sconosciuta: %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    tablesReload(tables); // If the file is missing the default rules are used
+
+    const SimVariant* variant = simFindVariant(rules);
+    if (variant == NULL)
+    {
+        fprintf(stderr, "Regole sconosciute: %s\n", rules);
+        return -1;
+    }
+    snprintf(configs[0].name, sizeof(configs[0].name), "%s", "base");
+    configs[0].rules        = *variant->rules;
+    configs[0].tables       = *tablesCurrent();
+    configs[0].rules.tables = &configs[0].tables;
+
+    int n_configs = 1;
+    if (params == NULL)
+        n_configs = defaultConfigs();
+    else
+    {
+        char list[1024];
+        snprintf(list, sizeof(list), "%s", params);
+        for (char* spec = strtok(list, ","); spec != NULL; spec = strtok(NULL, ","))
+        {
+            if (n_configs > MAX_PARAMS || !makeConfig(&configs[n_configs++], spec))
+            {
+                fprintf(stderr, "Parametro non valido: %s\n", spec);
+                return -1;
+            }
+        }
+    }
+    if (threads < 1)
+        threads = 1;
+    if (batch < (uint64_t)threads)
+        batch = threads;
+    if (zones < configs[0].rules.min_lands)
+        zones = configs[0].rules.min_lands;
+    if (zones > SIM_MAX_ZONES - 1)
+        zones = SIM_MAX_ZONES - 1;
+
+    // Same map of abtest with the same seed
+    SimMap   map;
+    SimRng   rng = {seed};
+    TypeZone types[SIM_MAX_ZONES];
+    for (int i = 0; i < zones; i++)
+        types[i] = simRand(&rng) % EXIT_CAMPING;
+    simMapInit(&map, types, zones);
+
+    // Rounds of games, each one split among the threads, until every interval is tight enough
+    Sums     total[MAX_PARAMS + 1] = {0};
+    Job*     jobs = (Job*)malloc(threads * sizeof(Job));
+    uint64_t games = 0;
+    double   widest;
+    if (jobs == NULL)
+    {
+        fprintf(stderr, "Memoria insufficiente.\n");
+        return -1;
+    }
+
+    do
+    {
+        pthread_t tids[threads];
+        uint64_t  count = batch < max_games - games ? batch : max_games - games;
+
+        for (int t = 0; t < threads; t++)
+        {
+            jobs[t] = (Job){.map = &map, .seed = seed, .first = games + count * t / threads,
+                            .count = count * (t + 1) / threads - count * t / threads, .n_configs = n_configs}; // Sums from 0
+            pthread_create(&tids[t], NULL, worker, &jobs[t]);
+        }
+        for (int t = 0; t < threads; t++)
+        {
+            pthread_join(tids[t], NULL);
+            for (int c = 0; c < n_configs; c++)
+                for (int k = 0; k < METRICS; k++)
+                {
+                    total[c].x [k] += jobs[t].sums[c].x [k];
+                    total[c].x2[k] += jobs[t].sums[c].x2[k];
+                    total[c].d [k] += jobs[t].sums[c].d [k];
+                    total[c].d2[k] += jobs[t].sums[c].d2[k];
+                }
+        }
+        games += count;
+
+        widest = 0;
+        for (int c = 1; c < n_configs; c++)
+            for (int k = 0; k < METRICS; k++)
+                widest = fmax(widest, 100 * halfWidth(&total[c], k, games));
+    } while (widest >= precision && games < max_games);
+
+    printf("%d zone, regole %s, %d parametri, %llu partite per configurazione (intervalli al 95%%)\n\n", zones, rules,
+           n_configs - 1, (unsigned long long)games);
+    printf("%-26s %17s %17s %17s %10s\n", "PARAMETRO", "ENTRAMBI", "UNO", "MORTI", "RIDUZIONE");
+    printf("%-26s", "base");
+    for (int k = 0; k < METRICS; k++)
+        printf("  %6.2f%% ±%5.2f  ", 100 * scale[k] * total[0].x[k] / games,
+               100 * Z_95 * scale[k] * sqrt(variance(total[0].x[k], total[0].x2[k], games) / games));
+    printf("\n");
+
+    for (int c = 1; c < n_configs; c++)
+    {
+        double paired = 0, independent = 0;
+
+        printf("%-26s", configs[c].name);
+        for (int k = 0; k < METRICS; k++)
+        {
+            printf("  %+6.2f%% ±%5.2f  ", 100 * scale[k] * total[c].d[k] / games, 100 * halfWidth(&total[c], k, games));
+            paired      += variance(total[c].d[k], total[c].d2[k], games);
+            independent += variance(total[c].x[k], total[c].x2[k], games) + variance(total[0].x[k], total[0].x2[k], games);
+        }
+
+        // How many more games two independent runs would need for the same intervals
+        if (paired > 0)
+            printf(" %9.1fx\n", independent / paired);
+        else
+            printf(" %10s\n", "-");
+    }
+    free(jobs);
+    return 0;
+}
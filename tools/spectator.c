@@ -0,0 +1,98 @@
+/******************************************************************************/
+/*!
+ * @file   spectator.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Follows a game in progress on the same machine, reading its state from shared memory
+ *
+ * The game has to be compiled with -D SPECTATOR. The spectator polls the sequence number of
+ * the region of the session and redraws the inventory and the map (see spectatorRender) only when it changes;
+ * reading never slows down the game, which does not know how many spectators there are.
+ *
+ * Compilation: gcc -O2 -o spectator tools/spectator.c spectator.c -Wall -std=c11
+ * Usage:       ./spectator [--interval MS] [--once] SESSION
+ *              SESSION is the ID of the player, "legacy" for a game loaded from GameSave.save
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "../gamelib.h"
+#include "../spectator.h"
+
+static void sleepMs(int ms)
+{
+    struct timespec t = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&t, NULL);
+}
+
+static void render(const char* session, const SpectatorState* s)
+{
+    static char frame[SPECTATOR_FRAME_MAX];
+
+    spectatorRender(session, s, frame, sizeof(frame));
+    printf("\033[H\033[2J%s", frame); // Without system("clear"), which would spawn a shell for every frame
+    fflush(stdout);
+}
+
+int main(int argc, char const *argv[])
+{
+    int interval = 50;
+    int once     = FALSE;
+    int i        = 1;
+
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+    {
+        if (strcmp(argv[i], "--once") == 0)
+            once = TRUE;
+        else if (i + 1 >= argc)
+        {
+            fprintf(stderr, "Manca il valore dell'opzione %s\n", argv[i]);
+            return -1;
+        }
+        else if (strcmp(argv[i], "--interval") == 0)
+            interval = atoi(argv[++i]) > 0 ? atoi(argv[i]) : 1;
+        else
+        {
+            fprintf(stderr, "Opzione sconosciuta: %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (i + 1 != argc)
+    {
+        fprintf(stderr, "Utilizzo: %s [--interval MS] [--once] SESSIONE\n", argv[0]);
+        return -1;
+    }
+
+    const char*            session = argv[i];
+    const SpectatorRegion* region  = spectatorAttach(session);
+    if (region == NULL)
+    {
+        if (once)
+        {
+            fprintf(stderr, "Nessuna partita in corso per la sessione %s.\n", session);
+            return -1;
+        }
+        printf("In attesa di una partita per la sessione %s...\n", session);
+        fflush(stdout);
+        while ((region = spectatorAttach(session)) == NULL)
+            sleepMs(interval);
+    }
+
+    SpectatorState state;
+    uint32_t       shown = 1; // Odd, never a published sequence number
+    while (TRUE)
+    {
+        uint32_t seq = spectatorRead(region, &state);
+        if (seq != shown || state.ended) // Also the last state of a game which has died, marked by spectatorRead
+        {
+            render(session, &state);
+            shown = seq;
+        }
+        if (state.ended || once)
+            break;
+        sleepMs(interval);
+    }
+    spectatorDetach(region);
+    return 0;
+}
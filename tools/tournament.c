@@ -0,0 +1,521 @@
+/******************************************************************************/
+/*!
+ * @file   tournament.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Ranks the scripted strategies of the players, playing them all on the same games
+ *
+ * A policy is a strategy for the actions of doTurn joined with a choice of the item against
+ * Gieson, named ACTION/ITEM. Every game has its own map, drawn like the zones of addZone with
+ * their objects drawn like randomObject, and its own seed: all the policies play the same map
+ * with the same seed, so two policies are compared on the paired differences of their scores,
+ * whose variance is far lower than the one of two independent runs.
+ *
+ * The games are split in chunks among the threads: each thread plays its own range from the
+ * front and, when it runs out of work, steals the back half of the largest range left, so the
+ * threads end together even when the policies make some games far longer than others.
+ *
+ * The score of a game is the number of players who escaped (0, 1 or 2). The differences are
+ * tested with a two sided z test, with the Holm correction over all the pairs of policies.
+ *
+ * Compilation: gcc -O2 -o tournament tools/tournament.c sim.c tables.c -Wall -std=c11 -pthread -lm
+ * Usage:       ./tournament [--policies ACTION[/ITEM][,...]] [--games N] [--threads N] [--seed S]
+ *                           [--tables FILE] [--alpha A] [--pairs 1]
+ *              Without --policies every ACTION is played with every ITEM
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "../sim.h"
+
+#define MAX_POLICIES 64
+#define CHUNK        256  /**<Games taken from the own range at a time */
+#define Z_95         1.96
+
+// -----------------------------------POLICIES----------------------------------
+static int canTake(const SimGame* g, const SimPlayer* myP)
+{
+    return g->object[myP->pos] != NOTHING && myP->obj_count <= g->rules->backpack_size;
+}
+
+/**
+ * Searches every zone and takes what it finds, nothing else
+ */
+static SimAction rummageAction(const SimGame* g, int player, int moves, void* ctx)
+{
+    const SimPlayer* myP = &g->p[player];
+    (void)moves;
+    (void)ctx;
+
+    if (!myP->searched)
+        return SIM_RUMMAGE;
+    if (canTake(g, myP))
+        return SIM_TAKE;
+    return SIM_ADVANCE;
+}
+
+/**
+ * Like the default policy, but keeps the junk until it has enough for the best odds of the craft
+ */
+static SimAction hoard(const SimGame* g, int player, int junk)
+{
+    const SimPlayer* myP = &g->p[player];
+
+    if (myP->state == INJURED && myP->backpack[BANDAGE] > 0)
+        return SIM_HEAL;
+    if (!myP->searched)
+        return SIM_RUMMAGE;
+    if (canTake(g, myP))
+        return SIM_TAKE;
+    if (myP->backpack[JUNK] >= junk || (myP->backpack[JUNK] > 0 && myP->pos + 1 == g->zones))
+        return SIM_CRAFT;
+    return SIM_ADVANCE;
+}
+
+static SimAction hoard2Action(const SimGame* g, int player, int moves, void* ctx)
+{
+    (void)moves;
+    (void)ctx;
+    return hoard(g, player, 2);
+}
+
+static SimAction hoard3Action(const SimGame* g, int player, int moves, void* ctx)
+{
+    (void)moves;
+    (void)ctx;
+    return hoard(g, player, 3);
+}
+
+/**
+ * Runs to the exit, spending as few turns as possible on the map
+ */
+static SimAction rushAction(const SimGame* g, int player, int moves, void* ctx)
+{
+    (void)g;
+    (void)player;
+    (void)moves;
+    (void)ctx;
+    return SIM_ADVANCE;
+}
+
+static SimAction rushHealAction(const SimGame* g, int player, int moves, void* ctx)
+{
+    const SimPlayer* myP = &g->p[player];
+    (void)moves;
+    (void)ctx;
+
+    return myP->state == INJURED && myP->backpack[BANDAGE] > 0 ? SIM_HEAL : SIM_ADVANCE;
+}
+
+/**
+ * The default policy, taking the adrenaline at the first move of every turn while it has some
+ */
+static SimAction adrenalineAction(const SimGame* g, int player, int moves, void* ctx)
+{
+    if (moves == 1 && g->p[player].backpack[ADRENALINE] > 0)
+        return SIM_ADRENALINE;
+    return sim_policy_default.action(g, player, moves, ctx);
+}
+
+static ObjType gunFirstItem(const SimGame* g, int player, void* ctx)
+{
+    const unsigned short* backpack = g->p[player].backpack;
+    (void)ctx;
+
+    if (backpack[GUN] > 0)
+        return GUN;
+    if (backpack[GASOLINE] > 0)
+        return GASOLINE;
+    return KNIFE;
+}
+
+/**
+ * The knife while it is not fatal, saving the gun and the gasoline for later
+ */
+static ObjType knifeFirstItem(const SimGame* g, int player, void* ctx)
+{
+    const SimPlayer* myP = &g->p[player];
+
+    if (myP->backpack[KNIFE] > 0 && myP->state == ALIVE)
+        return KNIFE;
+    return gunFirstItem(g, player, ctx);
+}
+
+typedef struct {
+    const char* name;
+    SimAction (*fn)(const SimGame*, int, int, void*);
+} ActionEntry;
+
+typedef struct {
+    const char* name;
+    ObjType (*fn)(const SimGame*, int, void*);
+} ItemEntry;
+
+static const ActionEntry actions[] = {
+    {"default",    NULL},
+    {"rummage",    rummageAction},
+    {"hoard2",     hoard2Action},
+    {"hoard3",     hoard3Action},
+    {"rush",       rushAction},
+    {"rush_heal",  rushHealAction},
+    {"adrenaline", adrenalineAction}
+};
+
+static const ItemEntry items[] = {
+    {"default",    NULL},
+    {"gun_first",  gunFirstItem},
+    {"knife_first", knifeFirstItem}
+};
+
+#define N_ACTIONS (int)(sizeof(actions) / sizeof(actions[0]))
+#define N_ITEMS   (int)(sizeof(items) / sizeof(items[0]))
+
+static SimPolicy policies[MAX_POLICIES];
+static char      names   [MAX_POLICIES][32];
+static int       n_policies = 0;
+
+/**
+ * Adds the policy ACTION/ITEM to the tournament
+ * @return TRUE if both the action and the item exist
+ */
+static int addPolicy(const char* spec)
+{
+    const char* slash = strchr(spec, '/');
+    size_t      len   = slash != NULL ? (size_t)(slash - spec) : strlen(spec);
+    const char* item  = slash != NULL ? slash + 1 : "default";
+    int         a, i;
+
+    for (a = 0; a < N_ACTIONS && (strlen(actions[a].name) != len || strncmp(actions[a].name, spec, len) != 0); a++);
+    for (i = 0; i < N_ITEMS && strcmp(items[i].name, item) != 0; i++);
+    if (a == N_ACTIONS || i == N_ITEMS || n_policies == MAX_POLICIES)
+        return FALSE;
+
+    snprintf(names[n_policies], sizeof(names[n_policies]), "%s/%s", actions[a].name, items[i].name);
+    policies[n_policies] = (SimPolicy){names[n_policies],
+                                       actions[a].fn != NULL ? actions[a].fn : sim_policy_default.action,
+                                       items[i].fn   != NULL ? items[i].fn   : sim_policy_default.item, NULL, NULL};
+    n_policies++;
+    return TRUE;
+}
+
+// -------------------------------------POOL------------------------------------
+// Range of games of a thread: the owner takes from next, a thief from end
+typedef struct {
+    pthread_mutex_t  lock;
+    _Atomic uint64_t next, end;   /**<Changed under the lock, atomic only for the thieves looking for a victim */
+    char             pad[64];
+} Range;
+
+// Sums of the scores of a thread, integers so that the threads can be merged exactly
+typedef struct {
+    int64_t score[MAX_POLICIES];
+    int64_t both [MAX_POLICIES];
+    int64_t cross[MAX_POLICIES][MAX_POLICIES]; /**<Sum of score[a]*score[b], only for a <= b */
+    int64_t steals;
+} Sums;
+
+static Range*   ranges;
+static Sums*    sums;
+static int      n_threads;
+static uint64_t seed;
+
+/**
+ * Map of a game, from its own stream: the zones of addZone (at least MAX_LANDS, at most twice as many)
+ * with the objects left to the draw of the game, like randomObject
+ */
+static void gameMap(SimMap* map, uint64_t game_seed)
+{
+    SimRng   rng   = {~game_seed};
+    TypeZone types[2 * MAX_LANDS];
+    int      zones = MAX_LANDS + simRand(&rng) % (MAX_LANDS + 1);
+
+    for (int i = 0; i < zones; i++)
+        types[i] = simRand(&rng) % EXIT_CAMPING;
+    simMapInit(map, types, zones);
+}
+
+/**
+ * Takes the next chunk of the own range, or steals the back half of the largest range of the other threads
+ * @return FALSE when there are no games left
+ */
+static int takeWork(int self, uint64_t* first, uint64_t* last)
+{
+    Range* own = &ranges[self];
+
+    pthread_mutex_lock(&own->lock);
+    if (own->next < own->end)
+    {
+        *first     = own->next;
+        *last      = own->next + CHUNK < own->end ? own->next + CHUNK : own->end;
+        own->next  = *last;
+        pthread_mutex_unlock(&own->lock);
+        return TRUE;
+    }
+    pthread_mutex_unlock(&own->lock);
+
+    while (TRUE)
+    {
+        // The sizes are read without the locks, only to pick a victim
+        int      victim = -1;
+        uint64_t most   = 0;
+        for (int t = 0; t < n_threads; t++)
+        {
+            Range*   r    = &ranges[t];
+            uint64_t left = r->end > r->next ? r->end - r->next : 0;
+            if (t != self && left > most)
+                victim = t, most = left;
+        }
+        if (victim < 0)
+            return FALSE;
+
+        Range* r = &ranges[victim];
+        pthread_mutex_lock(&r->lock);
+        if (r->next >= r->end)
+        {
+            pthread_mutex_unlock(&r->lock); // Emptied in the meantime, looking for another one
+            continue;
+        }
+        uint64_t mid = r->next + (r->end - r->next) / 2;
+        uint64_t end = r->end;
+        r->end = mid;
+        pthread_mutex_unlock(&r->lock);
+
+        pthread_mutex_lock(&own->lock);
+        own->next = mid;
+        own->end  = end;
+        pthread_mutex_unlock(&own->lock);
+        sums[self].steals++;
+        return takeWork(self, first, last);
+    }
+}
+
+static void* worker(void* arg)
+{
+    int      self = (int)(intptr_t)arg;
+    Sums*    s    = &sums[self];
+    uint64_t first, last;
+
+    while (takeWork(self, &first, &last))
+        for (uint64_t i = first; i < last; i++)
+        {
+            uint64_t  game_seed = simGameSeed(seed, i);
+            SimMap    map;
+            SimResult res;
+            int       score[MAX_POLICIES];
+
+            gameMap(&map, game_seed);
+            for (int p = 0; p < n_policies; p++)
+            {
+                simPlay(&map, &policies[p], game_seed, &res);
+                score[p] = res.escaped[0] + res.escaped[1];
+                s->score[p] += score[p];
+                s->both [p] += score[p] == 2;
+            }
+            for (int a = 0; a < n_policies; a++)
+                for (int b = a; b < n_policies; b++)
+                    s->cross[a][b] += score[a] * score[b];
+        }
+    return NULL;
+}
+
+// ----------------------------------STATISTICS---------------------------------
+typedef struct {
+    int    a, b;
+    double diff, half, p;
+    int    significant;
+} Pair;
+
+static Sums   total;
+static double mean[MAX_POLICIES];
+
+/**
+ * Mean and half width of the 95% interval of score[a]-score[b], in escapes per player
+ * @return The p-value of the two sided z test of a zero difference
+ */
+static double pairedTest(int a, int b, uint64_t n, double* diff, double* half)
+{
+    int    lo = a < b ? a : b, hi = a < b ? b : a;
+    double sum_d  = (double)total.score[a] - total.score[b];
+    double sum_d2 = (double)total.cross[a][a] + total.cross[b][b] - 2.0 * total.cross[lo][hi];
+    double m      = sum_d / n;
+    double var    = (sum_d2 / n - m * m) * n / (n - 1);
+    double se     = sqrt(var > 0 ? var / n : 0);
+
+    *diff = m / 2;
+    *half = Z_95 * se / 2;
+    if (se == 0)
+        return m == 0 ? 1 : 0;
+    return erfc(fabs(m) / se / sqrt(2));
+}
+
+static int byMean(const void* x, const void* y)
+{
+    double d = mean[*(const int*)y] - mean[*(const int*)x];
+    return (d > 0) - (d < 0);
+}
+
+static int byP(const void* x, const void* y)
+{
+    double d = ((const Pair*)x)->p - ((const Pair*)y)->p;
+    return (d > 0) - (d < 0);
+}
+
+int main(int argc, char const *argv[])
+{
+    const char* list   = NULL;
+    const char* tables = TABLES_FILE;
+    uint64_t    games  = 100000;
+    double      alpha  = 0.05;
+    int         pairs  = FALSE;
+
+    n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    seed      = 1;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if      (strcmp(argv[i], "--policies") == 0) list      = argv[i + 1];
+        else if (strcmp(argv[i], "--games")    == 0) games     = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--threads")  == 0) n_threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seed")     == 0) seed      = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--tables")   == 0) tables    = argv[i + 1];
+        else if (strcmp(argv[i], "--alpha")    == 0) alpha     = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--pairs")    == 0) pairs     = atoi(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "Opzione sconosciuta: %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    tablesReload(tables); // If the file is missing the default rules are used
+
+    if (list == NULL)
+    {
+        for (int a = 0; a < N_ACTIONS; a++)
+            for (int i = 0; i < N_ITEMS; i++)
+            {
+                char spec[32];
+                snprintf(spec, sizeof(spec), "%s/%s", actions[a].name, items[i].name);
+                addPolicy(spec);
+            }
+    }
+    else
+    {
+        char copy[1024];
+        snprintf(copy, sizeof(copy), "%s", list);
+        for (char* spec = strtok(copy, ","); spec != NULL; spec = strtok(NULL, ","))
+            if (!addPolicy(spec))
+            {
+                fprintf(stderr, "Politica sconosciuta: %s\n", spec);
+                return -1;
+            }
+    }
+    if (n_policies < 2 || games < 2)
+    {
+        fprintf(stderr, "Servono almeno due politiche e due partite.\n");
+        return -1;
+    }
+    if (n_threads < 1)
+        n_threads = 1;
+
+    ranges = (Range*)calloc(n_threads, sizeof(Range));
+    sums   = (Sums*)calloc(n_threads, sizeof(Sums));
+    pthread_t* tids = (pthread_t*)malloc(n_threads * sizeof(pthread_t));
+    if (ranges == NULL || sums == NULL || tids == NULL)
+    {
+        fprintf(stderr, "Memoria insufficiente.\n");
+        return -1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < n_threads; t++)
+    {
+        pthread_mutex_init(&ranges[t].lock, NULL);
+        ranges[t].next = games * t / n_threads;
+        ranges[t].end  = games * (t + 1) / n_threads;
+    }
+    for (int t = 0; t < n_threads; t++)
+        pthread_create(&tids[t], NULL, worker, (void*)(intptr_t)t);
+    for (int t = 0; t < n_threads; t++)
+    {
+        pthread_join(tids[t], NULL);
+        for (int a = 0; a < n_policies; a++)
+        {
+            total.score[a] += sums[t].score[a];
+            total.both [a] += sums[t].both [a];
+            for (int b = a; b < n_policies; b++)
+                total.cross[a][b] += sums[t].cross[a][b];
+        }
+        total.steals += sums[t].steals;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    // Holm: the k-th smallest p-value is significant if it and all the smaller ones are below alpha/(m-k)
+    int   n_pairs = n_policies * (n_policies - 1) / 2, k = 0;
+    Pair* all     = (Pair*)malloc(n_pairs * sizeof(Pair));
+    int   beaten[MAX_POLICIES] = {0};
+    if (all == NULL)
+    {
+        fprintf(stderr, "Memoria insufficiente.\n");
+        return -1;
+    }
+    for (int a = 0; a < n_policies; a++)
+        for (int b = a + 1; b < n_policies; b++, k++)
+        {
+            all[k] = (Pair){a, b, 0, 0, 0, FALSE};
+            all[k].p = pairedTest(a, b, games, &all[k].diff, &all[k].half);
+        }
+    qsort(all, n_pairs, sizeof(Pair), byP);
+    for (k = 0; k < n_pairs && all[k].p <= alpha / (n_pairs - k); k++)
+    {
+        all[k].significant = TRUE;
+        beaten[all[k].diff > 0 ? all[k].a : all[k].b]++;
+    }
+
+    int order[MAX_POLICIES];
+    for (int p = 0; p < n_policies; p++)
+    {
+        mean [p] = (double)total.score[p] / games / 2;
+        order[p] = p;
+    }
+    qsort(order, n_policies, sizeof(int), byMean);
+
+    printf("%d politiche, %llu partite ciascuna, %d thread, %.1f s (%.0f partite/s, %llu furti)\n\n", n_policies,
+           (unsigned long long)games, n_threads, secs, games * n_policies / secs, (unsigned long long)total.steals);
+    printf("%3s %-24s %8s %9s %20s %10s %6s\n", "POS", "POLITICA", "FUGA", "ENTRAMBI", "SCARTO DAL SEGUENTE", "P", "BATTE");
+    for (int r = 0; r < n_policies; r++)
+    {
+        int p = order[r];
+        printf("%3d %-24s %7.3f%% %8.3f%%", r + 1, names[p], 100 * mean[p], 100.0 * total.both[p] / games);
+        if (r + 1 < n_policies)
+        {
+            double diff, half;
+            double pv = pairedTest(p, order[r + 1], games, &diff, &half);
+            printf("    %+7.3f%% ±%6.3f %10.2g", 100 * diff, 100 * half, pv);
+        }
+        else
+            printf(" %31s", "");
+        printf(" %6d\n", beaten[p]);
+    }
+
+    if (pairs)
+    {
+        printf("\n%-24s %-24s %18s %10s\n", "POLITICA A", "POLITICA B", "A - B", "P");
+        for (k = 0; k < n_pairs; k++)
+            printf("%-24s %-24s %+8.3f%% ±%6.3f %10.2g%s\n", names[all[k].a], names[all[k].b], 100 * all[k].diff,
+                   100 * all[k].half, all[k].p, all[k].significant ? " *" : "");
+    }
+    printf("\nFUGA: giocatori fuggiti sul totale. BATTE: politiche battute con differenza significativa "
+           "(correzione di Holm, alpha %.2f).\n", alpha);
+
+    free(all);
+    free(tids);
+    free(sums);
+    free(ranges);
+    return 0;
+}
@@ -0,0 +1,127 @@
+/******************************************************************************/
+/*!
+ * @file   trace.c
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Per-thread ring buffers of spans, dumped as Chrome trace-event JSON
+ */
+/******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include "trace.h"
+
+#ifdef TRACE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <time.h>
+
+// Number of spans kept by each thread. When the ring is full the oldest spans are overwritten
+#define RING_SIZE (1 << 16)
+
+typedef struct span {
+    const char* name;
+    uint64_t    start;
+    uint64_t    duration;
+} Span;
+
+// Only the owner thread writes into its ring, so a span costs a slot write and a release store
+typedef struct ring {
+    Span             spans[RING_SIZE];
+    _Atomic uint64_t head;
+    int              tid;
+    struct ring*     next;
+} Ring;
+
+static _Atomic(Ring*)       rings     = NULL;
+static atomic_int           next_tid  = 1;
+static _Thread_local Ring*  my_ring   = NULL;
+
+/**
+ * Returns the ring of the calling thread, allocating and registering it on first use
+ */
+static Ring* getRing()
+{
+    if (my_ring == NULL)
+    {
+        my_ring = (Ring*)calloc(1, sizeof(Ring));
+        if (my_ring == NULL)
+        {
+            fprintf(stderr, "\nImpossibile allocare la memoria per il tracciamento.\n");
+            exit(-1);
+        }
+        my_ring->tid = atomic_fetch_add(&next_tid, 1);
+
+        // Lock-free push on the list of rings
+        my_ring->next = atomic_load(&rings);
+        while (!atomic_compare_exchange_weak(&rings, &my_ring->next, my_ring));
+    }
+    return my_ring;
+}
+
+/**
+ * Monotonic clock in nanoseconds
+ * @return The current time
+ */
+uint64_t traceNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/**
+ * Records a span which started at the given time and ends now.
+ * Spans are stored as complete events, so nesting comes for free from their timestamps.
+ * @param name  Name of the span. It must be a string literal, since only the pointer is kept
+ * @param start Value returned by traceNow() at the beginning of the span
+ */
+void traceSpan(const char* name, uint64_t start)
+{
+    Ring*    ring = getRing();
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    Span*    span = &ring->spans[head % RING_SIZE];
+
+    span->name     = name;
+    span->start    = start;
+    span->duration = traceNow() - start;
+
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+/**
+ * Writes the spans of every thread in the Chrome trace-event format
+ * @param path The file where the trace will be written
+ */
+void traceDump(const char* path)
+{
+    FILE* fptr = fopen(path, "w");
+    if (fptr == NULL)
+    {
+        fprintf(stderr, "Errore nell'apertura del file di tracciamento.\n");
+        return;
+    }
+
+    fprintf(fptr, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    unsigned char first = 1;
+    for (Ring* r = atomic_load(&rings); r != NULL; r = r->next)
+    {
+        uint64_t head  = atomic_load_explicit(&r->head, memory_order_acquire);
+        uint64_t begin = head > RING_SIZE ? head - RING_SIZE : 0;
+
+        for (uint64_t i = begin; i < head; i++)
+        {
+            Span* span = &r->spans[i % RING_SIZE];
+            fprintf(fptr, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    first ? "" : ",\n", span->name, r->tid, span->start / 1e3, span->duration / 1e3);
+            first = 0;
+        }
+    }
+
+    fprintf(fptr, "\n]}\n");
+    fclose(fptr);
+}
+
+#endif
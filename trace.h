@@ -0,0 +1,35 @@
+/******************************************************************************/
+/*!
+ * @file   trace.h
+ * @author Antonio Strippoli
+ * @date   October, 2026
+ * @brief  Header file of trace.c
+ *
+ * Timeline tracing of a session, exported as Chrome trace-event JSON (chrome://tracing, Perfetto).
+ * Everything here is compiled only when the TRACE macro is defined
+ * (gcc -D TRACE ...), otherwise the macros below expand to nothing.
+ */
+/******************************************************************************/
+
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+#include <stdint.h>
+
+#define TRACE_FILE "GameTrace.json"
+
+#ifdef TRACE
+    uint64_t traceNow ();
+    void     traceSpan(const char*, uint64_t);
+    void     traceDump(const char*);
+
+    #define TRACE_BEGIN(var)       uint64_t var = traceNow()
+    #define TRACE_END(var, name)   traceSpan((name), (var))
+    #define TRACE_DUMP()           traceDump(TRACE_FILE)
+#else
+    #define TRACE_BEGIN(var)
+    #define TRACE_END(var, name)
+    #define TRACE_DUMP()
+#endif
+
+#endif